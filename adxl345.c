@@ -2,10 +2,17 @@
 #include <stdint.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_rom_sys.h"
 
 #include "adxl345.h"
+#include "adxl345_intr.h"
+#include "adxl345_events.h"
+#include "adxl345_priv.h"
 
 /** Resources
  * Inclination sensing: https://www.analog.com/en/app-notes/an-1057.html
@@ -13,255 +20,923 @@
 */
 
 
+/**
+ * Scale per LSB for every data format, indexed by DATA_FORMAT bits D3..D0
+ * (FULL_RES, JUSTIFY, RANGE), see ADXL345_SCALE_INDEX(). The data format lives in
+ * the register shadow, so the right entry is picked on every conversion without
+ * extra bookkeeping.
+ *   right justified, 10 bit:   1/256 g << range
+ *   right justified, full res: 1/256 g
+ *   left justified:            range / 32768
+ * 1/256 g is the 3.9 mg/LSB of the datasheet, same as ADXL345_MG2G_MULTIPLIER.
+ */
+#define ADXL345_SCALE_INDEX(dev)    (ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT) & 0x0F)
+
+// milli-g per LSB, Q16.16. raw * scale fits int32 for every format (full scale is 16000 mg)
+static const int32_t adxl345_scale_mg_q16[16] = {
+    256000, 512000, 1024000, 2048000,       // 10 bit, 2/4/8/16 g
+    4000, 8000, 16000, 32000,               // 10 bit, left justified
+    256000, 256000, 256000, 256000,         // full res
+    4000, 8000, 16000, 32000,               // full res, left justified
+};
+
+// micro-m/s2 per LSB, Q16.16
+static const int64_t adxl345_scale_um_s2_q16[16] = {
+    2510502400LL, 5021004800LL, 10042009600LL, 20084019200LL,
+    39226600LL, 78453200LL, 156906400LL, 313812800LL,
+    2510502400LL, 2510502400LL, 2510502400LL, 2510502400LL,
+    39226600LL, 78453200LL, 156906400LL, 313812800LL,
+};
+
+// m/s2 per LSB
+static const float adxl345_scale_ms2[16] = {
+    0.0383072265625F, 0.076614453125F, 0.15322890625F, 0.3064578125F,
+    0.0005985504150390625F, 0.001197100830078125F, 0.00239420166015625F, 0.0047884033203125F,
+    0.0383072265625F, 0.0383072265625F, 0.0383072265625F, 0.0383072265625F,
+    0.0005985504150390625F, 0.001197100830078125F, 0.00239420166015625F, 0.0047884033203125F,
+};
+
+
 /* prototype static functions */
 
-static uint8_t adxl345_read8(uint8_t reg_addr);
-static int16_t adxl345_read16(uint8_t reg_addr);
-static void adxl345_write(uint8_t reg_addr, uint8_t value);
-static double dsp_ema_i32(double in, double average, float alpha );
-static char *print_byte(uint8_t byte);
-static char *adxl345_return_datarate(uint8_t _data_rate);
-static char *adxl345_return_range(uint8_t _range_data);
+static esp_err_t adxl345_xfer(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t *rx, const uint8_t *tx, size_t len);
+static esp_err_t adxl345_bus_recover(adxl345_dev_t *dev);
+static esp_err_t adxl345_read8(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t *value);
+static esp_err_t adxl345_read16(adxl345_dev_t *dev, uint8_t reg_addr, int16_t *value);
+static esp_err_t adxl345_read_xyz(adxl345_dev_t *dev, int16_t *x, int16_t *y, int16_t *z);
+static esp_err_t adxl345_write(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t value);
+static char *print_byte(uint8_t byte, char buf[9]);
+static const char *adxl345_return_datarate(uint8_t _data_rate);
+static const char *adxl345_return_range(uint8_t _range_data);
 
 
 /**
- * @brief Initialize the sensor and set some basic parameters
- * @param  none
- * @return true is sucess. s
+ * @brief Create a device handle, one per sensor. Nothing is sent to the sensor yet,
+ *        call adxl345_begin() next.
+ * @param config I2C port and address of the sensor, or the transport to use
+ * @param out_dev the new handle
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
  */
-bool adxl345_begin(void)
+esp_err_t adxl345_create(const adxl345_dev_config_t *config, adxl345_dev_t **out_dev)
 {
-    esp_err_t ret = ESP_OK;
-    ret = adxl345_chipid();     // check if the sensor reposds by asking the ChipID.
+    if (config == NULL || out_dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    if (ret == ESP_OK) {
+    adxl345_dev_t *dev = calloc(1, sizeof(adxl345_dev_t));
+    if (dev == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
 
-        adxl345_set_auto_sleep(true, ADXL345_WAKE_1HZ);         // read during sleep freq: ADXL345_WAKE_8HZ. ADXL345_WAKE_4HZ, ADXL345_WAKE_2HZ, ADXL345_WAKE_1HZ
-        adxl345_set_fullres_mode(true);                         // enable highest dynamic range
-        adxl345_start_measure();                                // start measuring
+    dev->lock = xSemaphoreCreateRecursiveMutex();
+    if (dev->lock == NULL) {
+        free(dev);
+        return ESP_ERR_NO_MEM;
+    }
 
+    dev->i2c_port = config->i2c_port;
+    dev->i2c_address = config->i2c_address;
+    dev->recovery = config->recovery;
+    if (config->bus != NULL) {
+        dev->bus = *config->bus;
     } else {
-        ESP_LOGE(__func__, "Something on the knikker");
-        return false;
+        esp_err_t err = adxl345_bus_i2c_create(config->i2c_port, config->i2c_address, &dev->bus);
+        if (err != ESP_OK) {
+            vSemaphoreDelete(dev->lock);
+            free(dev);
+            return err;
+        }
+        dev->bus_owned = true;
+    }
+    ADXL345_SHADOW(dev, ADXL345_REG_BW_RATE) = ADXL345_DATARATE_100_HZ;      // power-on value, all the others are 0x00
+    dev->iir_alpha = -1.0f;
+
+    *out_dev = dev;
+    return ESP_OK;
+}
+
+/**
+ * @brief Free a device handle. A running event engine or interrupt acquisition is
+ *        stopped first, so its task and ISRs are gone before the handle is. Not from
+ *        the interrupt callback.
+ * @param dev handle from adxl345_create(), NULL is ignored
+ */
+void adxl345_destroy(adxl345_dev_t *dev)
+{
+    if (dev == NULL) {
+        return;
+    }
+    if (dev->events != NULL) {
+        adxl345_events_stop(dev);       // stops the acquisition under it too
+    } else if (dev->intr != NULL) {
+        adxl345_intr_stop(dev);
+    }
+    if (dev->bus_owned) {
+        adxl345_bus_delete(&dev->bus);
+    }
+    vSemaphoreDelete(dev->lock);
+    free(dev);
+}
+
+/**
+ * @brief Initialize the sensor and set some basic parameters.
+ *        adxl345_begin_fast() does the same in fewer transactions when boot time counts.
+ * @param dev handle from adxl345_create()
+ * @return ESP_OK, ESP_ERR_NOT_FOUND when the chip ID is wrong, or the bus error
+ */
+esp_err_t adxl345_begin(adxl345_dev_t *dev)
+{
+    esp_err_t ret = adxl345_chipid(dev);     // check if the sensor reposds by asking the ChipID.
+
+    if (ret == ESP_OK) {
+        ret = adxl345_resync_regs(dev);                                      // the sensor may have kept its registers over an MCU reset
+    }
+    if (ret == ESP_OK) {
+        ret = adxl345_set_auto_sleep(dev, true, ADXL345_WAKE_1HZ);           // read during sleep freq: ADXL345_WAKE_8HZ. ADXL345_WAKE_4HZ, ADXL345_WAKE_2HZ, ADXL345_WAKE_1HZ
+    }
+    if (ret == ESP_OK) {
+        ret = adxl345_set_fullres_mode(dev, true);                           // enable highest dynamic range
+    }
+    if (ret == ESP_OK) {
+        ret = adxl345_start_measure(dev);                                    // start measuring
     }
 
-    return true;
+    if (ret != ESP_OK) {
+        ESP_LOGE(__func__, "Something on the knikker, error: %d", ret);
+    }
+    return ret;
 }
 
 /**
  * @brief Read and compare Device ID
  * @param  n/a
- * @return ESP_OK or ESP_FAIL
+ * @return ESP_OK, ESP_ERR_NOT_FOUND when something else answers, or the bus error
  */
-esp_err_t adxl345_chipid(void)
+esp_err_t adxl345_chipid(adxl345_dev_t *dev)
 {
-    static uint8_t rx[1];
-
-    rx[0] = adxl345_read8(ADXL345_REG_DEVID);
+    uint8_t devid;
+    esp_err_t err = adxl345_read8(dev, ADXL345_REG_DEVID, &devid);
 
-    if (ADXL345_REG_RETURN_DEVID == rx[0]) {
-        ESP_LOGD(__func__, "ChipID returned: 0x%X", rx[0]);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (ADXL345_REG_RETURN_DEVID == devid) {
+        ESP_LOGD(__func__, "ChipID returned: 0x%X", devid);
         return ESP_OK;
     } else {
-        ESP_LOGE(__func__, "Invalid ChipID returned: 0x%X", rx[0]);
-        return ESP_FAIL;
+        ESP_LOGE(__func__, "Invalid ChipID returned: 0x%X", devid);
+        return ESP_ERR_NOT_FOUND;
+    }
+}
+
+/**
+ * @brief One transaction with the recovery policy of the device: retries with
+ *        exponential backoff, a bus clear by the transport after recover_after
+ *        failures in a row, and a sensor reset check once it works again (run when
+ *        the device lock is released, not in the middle of e.g. a FIFO drain).
+ *        Reads starting at INT_SOURCE..DATAZ1 (0x30 - 0x37) are not retried: the
+ *        failed attempt may already have popped the FIFO or cleared the event bits,
+ *        a retry would return the next sample instead. Call with the device lock held.
+ * @param rx read into, NULL for a write
+ * @param tx values to write, NULL for a read
+ * @return ESP_OK or the error of the last attempt
+ */
+static esp_err_t adxl345_xfer(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t *rx, const uint8_t *tx, size_t len)
+{
+    const adxl345_recovery_config_t *rc = &dev->recovery;
+    uint32_t backoff_us = rc->backoff_us;
+    esp_err_t err;
+    uint8_t attempt = 0;
+    bool destructive = tx == NULL && reg_addr >= ADXL345_REG_INT_SOURCE && reg_addr <= ADXL345_REG_DATAZ1;
+    uint8_t retries = destructive ? 0 : rc->retries;
+
+    for (;;) {
+        ADXL345_STATS_START(t0);
+        err = tx != NULL ? dev->bus.ops->write(dev->bus.ctx, reg_addr, tx, len) :
+              dev->bus.ops->read(dev->bus.ctx, reg_addr, rx, len);
+        ADXL345_STATS_BUS(dev, tx != NULL, reg_addr, len, err, t0);
+
+        if (err == ESP_OK || attempt >= retries) {
+            break;
+        }
+
+        attempt++;
+        ADXL345_STATS_ADD(dev, retries, 1);
+        if (rc->recover_after != 0 && attempt % rc->recover_after == 0) {
+            adxl345_bus_recover(dev);
+        }
+        esp_rom_delay_us(backoff_us);
+        backoff_us = backoff_us * 2 > rc->backoff_max_us ? rc->backoff_max_us : backoff_us * 2;
+    }
+
+    if (err != ESP_OK && destructive) {
+        ADXL345_STATS_ADD(dev, reads_lost, 1);
+    }
+
+    // errors then success: the sensor may have browned out in between, adxl345_unlock() checks
+    if (err == ESP_OK && attempt > 0 && rc->reapply_config && !dev->checking) {
+        dev->health_pending = true;
+    }
+
+    return err;
+}
+
+/**
+ * @brief ADXL345_LOCK(): take the device lock, counting the nesting depth
+ */
+void adxl345_lock(adxl345_dev_t *dev)
+{
+    xSemaphoreTakeRecursive(dev->lock, portMAX_DELAY);
+    dev->lock_depth++;
+}
+
+/**
+ * @brief ADXL345_UNLOCK(): release the device lock. Releasing the outermost hold runs
+ *        the sensor reset check adxl345_xfer() deferred, once the sequence it was
+ *        part of (a FIFO drain, a config) is complete.
+ */
+void adxl345_unlock(adxl345_dev_t *dev)
+{
+    if (dev->lock_depth == 1 && dev->health_pending) {
+        dev->health_pending = false;
+        adxl345_check_health(dev, NULL);
+    }
+    dev->lock_depth--;
+    xSemaphoreGiveRecursive(dev->lock);
+}
+
+/**
+ * @brief Clear the bus through the transport, if it knows how
+ */
+static esp_err_t adxl345_bus_recover(adxl345_dev_t *dev)
+{
+    if (dev->bus.ops->recover == NULL) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    esp_err_t err = dev->bus.ops->recover(dev->bus.ctx);
+
+    ADXL345_STATS_ADD(dev, bus_recoveries, 1);
+    ESP_LOGW(__func__, "%s bus of device 0x%X cleared, result: %d", dev->bus.name, dev->i2c_address, err);
+    return err;
+}
+
+/**
+ * @brief Compare BW_RATE..DATA_FORMAT on the sensor with the shadow copy. A sensor that
+ *        lost power (brownout) comes back with its power-on values and stops measuring;
+ *        with reapply_config set the whole shadow configuration is written back then.
+ *        Run it now and then (e.g. when samples stop coming), the driver also runs it
+ *        itself after a transaction that needed retries, once the device lock is released.
+ * @param reapplied set to whether the configuration was written back, NULL if not needed
+ * @return ESP_OK when the sensor has its configuration (again),
+ *         ESP_ERR_INVALID_STATE when it lost it and reapply_config is off, or the bus error
+ */
+esp_err_t adxl345_check_health(adxl345_dev_t *dev, bool *reapplied)
+{
+    uint8_t rx[ADXL345_REG_DATA_FORMAT - ADXL345_REG_BW_RATE + 1];
+    esp_err_t err;
+
+    if (reapplied != NULL) {
+        *reapplied = false;
+    }
+
+    ADXL345_LOCK(dev);
+    dev->checking = true;
+
+    err = adxl345_read_regs(dev, ADXL345_REG_BW_RATE, rx, sizeof(rx));
+    if (err == ESP_OK) {
+        bool lost = false;
+
+        for (uint8_t reg = ADXL345_REG_BW_RATE; reg <= ADXL345_REG_DATA_FORMAT; reg++) {
+            lost |= adxl345_reg_writable(reg) && rx[reg - ADXL345_REG_BW_RATE] != ADXL345_SHADOW(dev, reg);
+        }
+
+        if (lost && !dev->recovery.reapply_config) {
+            err = ESP_ERR_INVALID_STATE;
+        } else if (lost) {
+            adxl345_config_t config;
+
+            ESP_LOGW(__func__, "Device 0x%X lost its configuration, writing it back", dev->i2c_address);
+            adxl345_get_config(dev, &config);
+            err = adxl345_apply_config(dev, &config, true);
+            ADXL345_STATS_ADD(dev, config_reapplied, 1);
+            if (reapplied != NULL) {
+                *reapplied = err == ESP_OK;
+            }
+        }
     }
+
+    dev->checking = false;
+    ADXL345_UNLOCK(dev);
+
+    return err;
 }
 
 /**
  * @brief Read 1 Byte from the sensor
  * @param reg_addr The register address your want to read
- * @return value read from the register is returned as a uint8_t
+ * @param value the register value, untouched on error
+ * @return ESP_OK or the bus error
+ */
+static esp_err_t adxl345_read8(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t *value)
+{
+    return adxl345_read_regs(dev, reg_addr, value, 1);
+}
+
+/**
+ * @brief Read 2 Bytes from the sensor, low byte first
+ * @param reg_addr The register address your want to read
+ * @param value the register pair as int16_t, untouched on error
+ * @return ESP_OK or the bus error
+ */
+static esp_err_t adxl345_read16(adxl345_dev_t *dev, uint8_t reg_addr, int16_t *value)
+{
+    uint8_t rx[2];
+    esp_err_t err = adxl345_read_regs(dev, reg_addr, rx, sizeof(rx));
+
+    if (err == ESP_OK) {
+        *value = (int16_t)((uint16_t)rx[1] << 8 | (uint16_t)rx[0]);
+    }
+    return err;
+}
+
+/**
+ * @brief Read consecutive registers in one multi-byte transaction, the sensor auto-increments the address
+ * @param reg_addr first register
+ * @param rx where to store the values
+ * @param len number of registers
+ * @return ESP_OK or the bus error
  */
-static uint8_t adxl345_read8(uint8_t reg_addr)
+esp_err_t adxl345_read_regs(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t *rx, size_t len)
 {
     esp_err_t err;
-    static uint8_t rx[1];
 
-    err = i2c_manager_read(I2C_PORT, ADXL345_I2C_ADDRESS, reg_addr, rx, 1);
+    ADXL345_LOCK(dev);
+    err = adxl345_xfer(dev, reg_addr, rx, NULL, len);
+    ADXL345_UNLOCK(dev);
     if (err != ESP_OK) {
-        ESP_LOGE(__func__, "Reading sensor register 0x%x failed, error: %d", reg_addr, err);
-        return -1;
+        ESP_LOGE(__func__, "Reading %u bytes from register 0x%x failed, error: %d", (unsigned)len, reg_addr, err);
     }
 
-    return rx[0];
+    return err;
 }
 
 /**
- * @brief Read 2 Bytes from the sensor
- * @param reg_addr The register address your want to read
- * @return value read from the register is returned as a int16_t
+ * @brief Read DATAX0..DATAZ1 (0x32 - 0x37) in one multi-byte transaction.
+ *        The datasheet recommends a burst read here, reading the axes one by one
+ *        can mix values from different conversions.
+ * @param x,y,z where to store the decoded axis values
+ * @return ESP_OK or the bus error
  */
-static int16_t adxl345_read16(uint8_t reg_addr)
+static esp_err_t adxl345_read_xyz(adxl345_dev_t *dev, int16_t *x, int16_t *y, int16_t *z)
 {
     esp_err_t err;
-    static uint8_t rx[2];
+    uint8_t rx[6];
+    ADXL345_STATS_START(t0);
 
-    err = i2c_manager_read(I2C_PORT, ADXL345_I2C_ADDRESS, reg_addr, rx, 2);
+    err = adxl345_read_regs(dev, ADXL345_REG_DATAX0, rx, sizeof(rx));
     if (err != ESP_OK) {
-        ESP_LOGE(__func__, "Reading sensor register 0x%x failed, error: %d", reg_addr, err);
-        return -1;
+        return err;
     }
 
-    return (uint16_t)rx[1] << 8 | (uint16_t)rx[0];
+    *x = (int16_t)((uint16_t)rx[1] << 8 | (uint16_t)rx[0]);
+    *y = (int16_t)((uint16_t)rx[3] << 8 | (uint16_t)rx[2]);
+    *z = (int16_t)((uint16_t)rx[5] << 8 | (uint16_t)rx[4]);
+
+    ADXL345_STATS_ADD(dev, samples_read, 1);
+    ADXL345_STATS_LATENCY(dev, ADXL345_STATS_OP_XYZ, t0);
+    return ESP_OK;
 }
 
 /**
- * @brief Write to a register
+ * @brief Write to a register, on success the shadow copy is updated as well
  * @param reg_addr the register address
  * @param value the value you want to write
+ * @return ESP_OK or the bus error
+ */
+static esp_err_t adxl345_write(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t value)
+{
+    esp_err_t err;
+    const uint8_t tx[1] = { value };
+
+    ADXL345_LOCK(dev);
+    err = adxl345_xfer(dev, reg_addr, NULL, tx, 1);
+    if (err == ESP_OK && ADXL345_IS_SHADOWED(reg_addr)) {
+        ADXL345_SHADOW(dev, reg_addr) = value;
+    }
+    ADXL345_UNLOCK(dev);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(__func__, "%s write failed to register 0x%X of device 0x%X, sending value 0x%X", dev->bus.name, reg_addr, dev->i2c_address, value);
+    }
+
+    return err;
+}
+
+/**
+ * @brief Write consecutive registers in one multi-byte transaction, on success
+ *        the shadow copy of the writable ones is updated as well
+ * @param reg_addr first register
+ * @param tx values to write
+ * @param len number of registers
+ * @return ESP_OK or the bus error
  */
-static void adxl345_write(uint8_t reg_addr, uint8_t value)
+esp_err_t adxl345_write_regs(adxl345_dev_t *dev, uint8_t reg_addr, const uint8_t *tx, size_t len)
 {
     esp_err_t err;
-    static  uint8_t tx[1];
-    tx[0] = value;
 
-    err = i2c_manager_write(I2C_PORT, ADXL345_I2C_ADDRESS, reg_addr, tx, 1);
+    ADXL345_LOCK(dev);
+    err = adxl345_xfer(dev, reg_addr, NULL, tx, len);
+    for (size_t i = 0; err == ESP_OK && i < len; i++) {
+        if (adxl345_reg_writable(reg_addr + i)) {
+            ADXL345_SHADOW(dev, reg_addr + i) = tx[i];
+        }
+    }
+    ADXL345_UNLOCK(dev);
 
     if (err != ESP_OK) {
-        ESP_LOGE(__func__, "I2C Write failed to register 0x%X , sendign value 0x%X", ADXL345_I2C_ADDRESS, tx[0]);
+        ESP_LOGE(__func__, "Writing %u bytes to register 0x%X of device 0x%X failed, error: %d", (unsigned)len, reg_addr, dev->i2c_address, err);
+    }
+
+    return err;
+}
+
+/**
+ * @brief Change some bits of a register without reading it first, the shadow copy
+ *        holds the current value so this costs exactly one write.
+ * @param reg_addr a writable register between 0x1D and 0x38
+ * @param mask the bits to change
+ * @param value new value for the bits in mask
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_update_reg(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t mask, uint8_t value)
+{
+    esp_err_t err;
+
+    ADXL345_LOCK(dev);
+    uint8_t reg = ADXL345_SHADOW(dev, reg_addr);
+
+    reg &= ~mask;
+    reg |= value & mask;
+    err = adxl345_write(dev, reg_addr, reg);
+    ADXL345_UNLOCK(dev);
+
+    return err;
+}
+
+/**
+ * @brief Registers we keep a shadow copy of and can write back.
+ *        ACT_TAP_STATUS (0x2B), INT_SOURCE (0x30) and the data registers are read-only.
+ */
+bool adxl345_reg_writable(uint8_t reg_addr)
+{
+    return (reg_addr >= ADXL345_REG_THRESH_TAP && reg_addr <= ADXL345_REG_TAP_AXES) ||
+           (reg_addr >= ADXL345_REG_BW_RATE && reg_addr <= ADXL345_REG_INT_MAP) ||
+           reg_addr == ADXL345_REG_DATA_FORMAT ||
+           reg_addr == ADXL345_REG_FIFO_CTL;
+}
+
+/**
+ * @brief Wait at least roughly us: whole ticks asleep, the rest spinning. Callers
+ *        poll the sensor afterwards, so a tick that ends early does no harm.
+ */
+void adxl345_wait_us(uint32_t us)
+{
+    const uint32_t tick_us = portTICK_PERIOD_MS * 1000;
+
+    if (us >= tick_us) {
+        vTaskDelay(us / tick_us);
+    }
+    if (us % tick_us != 0) {
+        esp_rom_delay_us(us % tick_us);
+    }
+}
+
+/**
+ * @brief Reload the shadow copy from the sensor: one burst for 0x1D - 0x31 and one read of FIFO_CTL.
+ *        Use it after something else touched the sensor, the setters never read back.
+ * @return ESP_OK or the bus error, the shadow is untouched on error
+ */
+esp_err_t adxl345_resync_regs(adxl345_dev_t *dev)
+{
+    esp_err_t err;
+    uint8_t rx[ADXL345_REG_DATA_FORMAT - ADXL345_REG_THRESH_TAP + 1];
+    uint8_t fifo_ctl;
+
+    ADXL345_LOCK(dev);
+    err = adxl345_read_regs(dev, ADXL345_REG_THRESH_TAP, rx, sizeof(rx));
+    if (err == ESP_OK) {
+        err = adxl345_read_regs(dev, ADXL345_REG_FIFO_CTL, &fifo_ctl, 1);
+    }
+    if (err == ESP_OK) {
+        memcpy(&ADXL345_SHADOW(dev, ADXL345_REG_THRESH_TAP), rx, sizeof(rx));
+        ADXL345_SHADOW(dev, ADXL345_REG_FIFO_CTL) = fifo_ctl;
     }
+    ADXL345_UNLOCK(dev);
+
+    return err;
 }
 
 /**
- * @brief Read Bandwidth rate from sensor
+ * @brief Read the writable registers back and compare them with the shadow copy
+ * @return ESP_OK when they match, ESP_ERR_INVALID_STATE on a mismatch, or the bus error
+ */
+esp_err_t adxl345_verify_regs(adxl345_dev_t *dev)
+{
+    esp_err_t err;
+    uint8_t rx[ADXL345_REG_DATA_FORMAT - ADXL345_REG_THRESH_TAP + 1];
+    uint8_t fifo_ctl;
+
+    ADXL345_LOCK(dev);
+    err = adxl345_read_regs(dev, ADXL345_REG_THRESH_TAP, rx, sizeof(rx));
+    if (err == ESP_OK) {
+        err = adxl345_read_regs(dev, ADXL345_REG_FIFO_CTL, &fifo_ctl, 1);
+    }
+
+    for (uint8_t reg = ADXL345_REG_THRESH_TAP; err == ESP_OK && reg <= ADXL345_REG_FIFO_CTL; reg++) {
+        uint8_t actual = (reg == ADXL345_REG_FIFO_CTL) ? fifo_ctl :
+                         (reg <= ADXL345_REG_DATA_FORMAT) ? rx[reg - ADXL345_REG_THRESH_TAP] : 0;
+
+        if (adxl345_reg_writable(reg) && actual != ADXL345_SHADOW(dev, reg)) {
+            ESP_LOGE(__func__, "Register 0x%X reads 0x%X, expected 0x%X", reg, actual, ADXL345_SHADOW(dev, reg));
+            err = ESP_ERR_INVALID_STATE;
+        }
+    }
+    ADXL345_UNLOCK(dev);
+
+    return err;
+}
+
+/**
+ * @brief Program the whole configuration with auto-increment burst writes:
+ *          1. THRESH_TAP - TAP_AXES (0x1D - 0x2A), 14 bytes
+ *          2. FIFO_CTL (0x38)
+ *          3. BW_RATE - DATA_FORMAT (0x2C - 0x31), 6 bytes. INT_SOURCE (0x30) is
+ *             read-only, the sensor ignores the byte written to it.
+ *        When the config starts measuring, step 3 is written in standby with the
+ *        interrupts disabled and a last 2 byte write of POWER_CTL + INT_ENABLE
+ *        starts it, as the datasheet recommends. No logging, no readback unless asked.
+ * @param config register values to apply
+ * @param verify read everything back afterwards (2 extra reads)
+ * @return ESP_OK, ESP_ERR_INVALID_STATE when verify finds a mismatch, or the bus error
+ */
+esp_err_t adxl345_apply_config(adxl345_dev_t *dev, const adxl345_config_t *config, bool verify)
+{
+    esp_err_t err;
+    bool measure = (config->power_ctl & 0x08) != 0;
+    const uint8_t block1[] = {
+        config->thresh_tap, (uint8_t)config->ofsx, (uint8_t)config->ofsy, (uint8_t)config->ofsz,
+        config->dur, config->latent, config->window, config->thresh_act, config->thresh_inact,
+        config->time_inact, config->act_inact_ctl, config->thresh_ff, config->time_ff, config->tap_axes,
+    };
+    ADXL345_LOCK(dev);
+
+    const uint8_t block2[] = {
+        config->bw_rate,
+        measure ? (uint8_t)(config->power_ctl & ~0x08) : config->power_ctl,
+        measure ? 0x00 : config->int_enable,
+        config->int_map,
+        ADXL345_SHADOW(dev, ADXL345_REG_INT_SOURCE),
+        config->data_format,
+    };
+
+    err = adxl345_write_regs(dev, ADXL345_REG_THRESH_TAP, block1, sizeof(block1));
+    if (err == ESP_OK) {
+        err = adxl345_write(dev, ADXL345_REG_FIFO_CTL, config->fifo_ctl);
+    }
+    if (err == ESP_OK) {
+        err = adxl345_write_regs(dev, ADXL345_REG_BW_RATE, block2, sizeof(block2));
+    }
+    if (err == ESP_OK && measure) {
+        const uint8_t start[] = { config->power_ctl, config->int_enable };
+        err = adxl345_write_regs(dev, ADXL345_REG_POWER_CTL, start, sizeof(start));
+    }
+    if (err == ESP_OK && verify) {
+        err = adxl345_verify_regs(dev);
+    }
+    ADXL345_UNLOCK(dev);
+
+    return err;
+}
+
+/**
+ * @brief Current configuration, from the shadow copy
+ * @param config where to store the register values
+ */
+void adxl345_get_config(adxl345_dev_t *dev, adxl345_config_t *config)
+{
+    ADXL345_LOCK(dev);
+    *config = (adxl345_config_t) {
+        .thresh_tap = ADXL345_SHADOW(dev, ADXL345_REG_THRESH_TAP),
+        .ofsx = (int8_t)ADXL345_SHADOW(dev, ADXL345_REG_OFSX),
+        .ofsy = (int8_t)ADXL345_SHADOW(dev, ADXL345_REG_OFSY),
+        .ofsz = (int8_t)ADXL345_SHADOW(dev, ADXL345_REG_OFSZ),
+        .dur = ADXL345_SHADOW(dev, ADXL345_REG_DUR),
+        .latent = ADXL345_SHADOW(dev, ADXL345_REG_LATENT),
+        .window = ADXL345_SHADOW(dev, ADXL345_REG_WINDOW),
+        .thresh_act = ADXL345_SHADOW(dev, ADXL345_REG_THRESH_ACT),
+        .thresh_inact = ADXL345_SHADOW(dev, ADXL345_REG_THRESH_INACT),
+        .time_inact = ADXL345_SHADOW(dev, ADXL345_REG_TIME_INACT),
+        .act_inact_ctl = ADXL345_SHADOW(dev, ADXL345_REG_ACT_INACT_CTL),
+        .thresh_ff = ADXL345_SHADOW(dev, ADXL345_REG_THRESH_FF),
+        .time_ff = ADXL345_SHADOW(dev, ADXL345_REG_TIME_FF),
+        .tap_axes = ADXL345_SHADOW(dev, ADXL345_REG_TAP_AXES),
+        .bw_rate = ADXL345_SHADOW(dev, ADXL345_REG_BW_RATE),
+        .power_ctl = ADXL345_SHADOW(dev, ADXL345_REG_POWER_CTL),
+        .int_enable = ADXL345_SHADOW(dev, ADXL345_REG_INT_ENABLE),
+        .int_map = ADXL345_SHADOW(dev, ADXL345_REG_INT_MAP),
+        .data_format = ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT),
+        .fifo_ctl = ADXL345_SHADOW(dev, ADXL345_REG_FIFO_CTL),
+    };
+    ADXL345_UNLOCK(dev);
+}
+
+/**
+ * @brief Bandwidth rate, from the shadow copy. adxl345_resync_regs() reloads it from the sensor.
  * @return return data rate
  */
-char *adxl345_get_datarate(void)
+const char *adxl345_get_datarate(adxl345_dev_t *dev)
 {
-    static uint8_t data_rate_v = 0;
-    data_rate_v = (adxl345_read8(ADXL345_REG_BW_RATE) & 0x0F);
+    return adxl345_return_datarate(ADXL345_SHADOW(dev, ADXL345_REG_BW_RATE) & 0x0F);
+}
+
 
-    return adxl345_return_datarate(data_rate_v);
+/**
+ * @brief set the data rate, the LOW_POWER bit is left alone
+ * @param data_rate the data rate to set
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_set_datarate(adxl345_dev_t *dev, adxl345_datarate_t data_rate)
+{
+    return adxl345_update_reg(dev, ADXL345_REG_BW_RATE, 0x0F, data_rate);
 }
 
+/**
+ * @brief LOW_POWER bit (D4) of BW_RATE. Saves current between 12.5 and 400 Hz
+ *        at the cost of somewhat more noise, no effect at the other rates.
+ * @param enable low power on/off
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_set_low_power(adxl345_dev_t *dev, bool enable)
+{
+    return adxl345_update_reg(dev, ADXL345_REG_BW_RATE, 0x10, enable ? 0x10 : 0x00);
+}
 
 /**
- * @brief set the data rate
+ * @brief Data rate and LOW_POWER in a single write of BW_RATE
  * @param data_rate the data rate to set
+ * @param low_power LOW_POWER bit, see adxl345_set_low_power()
+ * @return ESP_OK or the bus error
  */
-void adxl345_set_datarate(adxl345_datarate_t data_rate)
+esp_err_t adxl345_set_bw_rate(adxl345_dev_t *dev, adxl345_datarate_t data_rate, bool low_power)
 {
-    adxl345_write(ADXL345_REG_BW_RATE, data_rate);
+    return adxl345_write(dev, ADXL345_REG_BW_RATE, (low_power ? 0x10 : 0x00) | (data_rate & 0x0F));
 }
 
 
 /**
- * @brief Get range value in G's
- * @return return range in G, default is 2G (0b00)
+ * @brief Time between two samples at the current data rate, from the shadow copy.
+ *        3200 Hz is 312.5 us, every step down in the rate code doubles it.
+ * @return sample period in ns
  */
-char *adxl345_get_range(void)
+uint64_t adxl345_get_sample_period_ns(adxl345_dev_t *dev)
 {
-    static uint8_t data_range_v = 0;
-    data_range_v = (adxl345_read8(ADXL345_REG_DATA_FORMAT) & 0x03);
+    uint8_t rate_code = ADXL345_SHADOW(dev, ADXL345_REG_BW_RATE) & 0x0F;
 
-    return adxl345_return_range(data_range_v);
+    return 312500ULL << (ADXL345_DATARATE_3200_HZ - rate_code);
+}
+
+
+/**
+ * @brief Get range value in G's, from the shadow copy
+ * @return return range in G, default is 2G (0b00)
+ */
+const char *adxl345_get_range(adxl345_dev_t *dev)
+{
+    return adxl345_return_range(ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT) & 0x03);
 }
 
 
 /**
  * @brief Set the g range ( 2g, 4g, 8g, 16g )
  * @param range G's
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or the bus error
  */
-void adxl345_set_range(uint8_t range)
+esp_err_t adxl345_set_range(adxl345_dev_t *dev, uint8_t range)
 {
-    // Read the DATA_FORMAT register current values, so we can flip our bits only and leave the rest
-    uint8_t data_format_reg = adxl345_read8(ADXL345_REG_DATA_FORMAT);
+    uint8_t range_bits;
+    esp_err_t err;
 
     switch (range) {
     case 2:
-        data_format_reg |= ADXL345_RANGE_2_G;
+        range_bits = ADXL345_RANGE_2_G;
         break;
     case 4:
-        data_format_reg |= ADXL345_RANGE_4_G;
+        range_bits = ADXL345_RANGE_4_G;
         break;
     case 8:
-        data_format_reg |= ADXL345_RANGE_8_G;
+        range_bits = ADXL345_RANGE_8_G;
         break;
     case 16:
-        data_format_reg |= ADXL345_RANGE_16_G;
+        range_bits = ADXL345_RANGE_16_G;
         break;
     default:
         ESP_LOGE(__func__, "Not a valid range value");
-        break;
+        return ESP_ERR_INVALID_ARG;
     }
-    //data_format_reg &= ~0x0F;       // select only the bits we're interested in " 0b000 (000)" .
-    //data_format_reg |= range;       // flip the bits to set the new range: "0b000(00xx)".
 
-    // and while we're here set FULL_RES mode as well.
-    //  data_format_reg |= 0x08;        // 0x08 = 0b1000 => 0b000 (X000);
-    ESP_LOGI(__func__, "Set data range:\t0x%X = 0b%s", data_format_reg, print_byte(data_format_reg));
-    // write new value to the register
-    adxl345_write(ADXL345_REG_DATA_FORMAT, data_format_reg);
+    // only flip the range bits D1 - D0, the rest of DATA_FORMAT comes from the shadow copy
+    err = adxl345_update_reg(dev, ADXL345_REG_DATA_FORMAT, 0x03, range_bits);
+    ESP_LOGD(__func__, "Set data range:\t0x%X = 0b%s", ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT),
+             print_byte(ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT), (char[9]) { 0 }));
+    return err;
 }
 
 
 /**
- * @brief
+ * @brief Enable/Disable FULL_RES (D3 of DATA_FORMAT), 4mg/LSB in every range when enabled
  * @param onoff
+ * @return ESP_OK or the bus error
  */
-void adxl345_set_fullres_mode(bool onoff)
+esp_err_t adxl345_set_fullres_mode(adxl345_dev_t *dev, bool onoff)
 {
-    uint8_t full_res_mode = 0;
-    full_res_mode = adxl345_read8(ADXL345_REG_DATA_FORMAT);
-    ESP_LOGI(__func__, "Current reg vals: \t0x%X = 0b%s", full_res_mode, print_byte(full_res_mode));
+    esp_err_t err = adxl345_update_reg(dev, ADXL345_REG_DATA_FORMAT, 0x08, onoff ? 0x08 : 0x00);
 
-    if (onoff) {
-        full_res_mode |= 0x08;          // flip fullres bit on
-    } else {
-        full_res_mode ^= 0x08;          // flip fullress bit off
+    ESP_LOGD(__func__, "DATA_FORMAT: \t0x%X = 0b%s", ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT),
+             print_byte(ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT), (char[9]) { 0 }));
+    return err;
+}
+
+/**
+ * @brief Read one axis from its data registers
+ * @param x raw value, untouched on a bus error
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_x(adxl345_dev_t *dev, int16_t *x)
+{
+    return adxl345_read16(dev, ADXL345_REG_DATAX0, x);
+}
+
+/**
+ * @brief Read one axis from its data registers
+ * @param y raw value, untouched on a bus error
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_y(adxl345_dev_t *dev, int16_t *y)
+{
+    return adxl345_read16(dev, ADXL345_REG_DATAY0, y);
+}
+
+/**
+ * @brief Read one axis from its data registers
+ * @param z raw value, untouched on a bus error
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_z(adxl345_dev_t *dev, int16_t *z)
+{
+    return adxl345_read16(dev, ADXL345_REG_DATAZ0, z);
+}
+
+
+/**
+ * @brief Read x,y,z in one burst and return value tru struct
+ *        m/s2 follows the current range, FULL_RES and JUSTIFY setting.
+ *        On a bus error the struct is left untouched.
+ * @param accel
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_accel(adxl345_dev_t *dev, adxl345_xyz_t *accel)
+{
+    adxl345_raw_xyz_t raw;
+    esp_err_t err = adxl345_read_xyz(dev, &raw.x, &raw.y, &raw.z);
+
+    if (err != ESP_OK) {
+        return err;
     }
 
-    adxl345_write(ADXL345_REG_DATA_FORMAT, full_res_mode);
-    //sanitytititiies
-    full_res_mode = adxl345_read8(ADXL345_REG_DATA_FORMAT);
-    ESP_LOGI(__func__, "After write: \t0x%X = 0b%s", full_res_mode, print_byte(full_res_mode));
+    float scale = adxl345_scale_ms2[ADXL345_SCALE_INDEX(dev)];
+
+    accel->x = raw.x;
+    accel->y = raw.y;
+    accel->z = raw.z;
+    accel->x_ms = accel->x * scale;
+    accel->y_ms = accel->y * scale;
+    accel->z_ms = accel->z * scale;
+    return ESP_OK;
+}
+
+/**
+ * @brief Read x,y,z in one burst, in milli-g. Integer only, correct for every
+ *        range, FULL_RES and JUSTIFY setting.
+ * @param mg result, untouched on a bus error
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_accel_mg(adxl345_dev_t *dev, adxl345_xyz_i32_t *mg)
+{
+    adxl345_raw_xyz_t raw;
+    esp_err_t err = adxl345_read_xyz(dev, &raw.x, &raw.y, &raw.z);
+
+    if (err == ESP_OK) {
+        adxl345_convert_mg(dev, &raw, mg, 1);
+    }
+    return err;
 }
 
 /**
- * @brief Read x,y,z data from registers
- * @param  void
- * @return bits and bytes and blops
+ * @brief Read x,y,z in one burst, in micro-m/s2. Integer only, see adxl345_get_accel_mg()
+ * @param um_s2 result, untouched on a bus error
+ * @return ESP_OK or the bus error
  */
-int16_t adxl345_get_x(void)
+esp_err_t adxl345_get_accel_um_s2(adxl345_dev_t *dev, adxl345_xyz_i32_t *um_s2)
 {
-    return adxl345_read16(ADXL345_REG_DATAX0);
+    adxl345_raw_xyz_t raw;
+    esp_err_t err = adxl345_read_xyz(dev, &raw.x, &raw.y, &raw.z);
+
+    if (err == ESP_OK) {
+        adxl345_convert_um_s2(dev, &raw, um_s2, 1);
+    }
+    return err;
 }
 
 /**
- * @brief Read x,y,z data from registers
- * @param  void
- * @return bits and bytes and blops
+ * @brief Convert raw samples (e.g. a FIFO drain) to milli-g, rounded, with the
+ *        current data format. One multiply per axis.
+ * @param raw samples as read
+ * @param mg result
+ * @param count number of samples
  */
-int16_t adxl345_get_y(void)
+void adxl345_convert_mg(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, adxl345_xyz_i32_t *mg, size_t count)
 {
-    return adxl345_read16(ADXL345_REG_DATAY0);
+    int32_t scale = adxl345_scale_mg_q16[ADXL345_SCALE_INDEX(dev)];
+
+    for (size_t i = 0; i < count; i++) {
+        mg[i].x = (raw[i].x * scale + 32768) >> 16;
+        mg[i].y = (raw[i].y * scale + 32768) >> 16;
+        mg[i].z = (raw[i].z * scale + 32768) >> 16;
+    }
 }
 
 /**
- * @brief Read x,y,z data from registers
- * @param  void
- * @return bits and bytes and blops
+ * @brief Convert raw samples to micro-m/s2, rounded, with the current data format
+ * @param raw samples as read
+ * @param um_s2 result
+ * @param count number of samples
  */
-int16_t adxl345_get_z(void)
+void adxl345_convert_um_s2(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, adxl345_xyz_i32_t *um_s2, size_t count)
 {
-    return adxl345_read16(ADXL345_REG_DATAZ0);
+    int64_t scale = adxl345_scale_um_s2_q16[ADXL345_SCALE_INDEX(dev)];
+
+    for (size_t i = 0; i < count; i++) {
+        um_s2[i].x = (int32_t)((raw[i].x * scale + 32768) >> 16);
+        um_s2[i].y = (int32_t)((raw[i].y * scale + 32768) >> 16);
+        um_s2[i].z = (int32_t)((raw[i].z * scale + 32768) >> 16);
+    }
 }
 
+/**
+ * @brief Block version of adxl345_convert_mg() for FIFO batches, structure of
+ *        arrays out. The scale is looked up once and the loop has no calls or
+ *        branches, so the compiler can vectorize it (-O2/-O3).
+ * @param raw samples as read, oldest first
+ * @param count number of samples
+ * @param x,y,z count values each, in milli-g, must not overlap raw or each other
+ */
+void adxl345_convert_block_mg(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, size_t count,
+                              int32_t *restrict x, int32_t *restrict y, int32_t *restrict z)
+{
+    const int32_t scale = adxl345_scale_mg_q16[ADXL345_SCALE_INDEX(dev)];
+
+    for (size_t i = 0; i < count; i++) {
+        x[i] = (raw[i].x * scale + 32768) >> 16;
+        y[i] = (raw[i].y * scale + 32768) >> 16;
+        z[i] = (raw[i].z * scale + 32768) >> 16;
+    }
+}
 
 /**
- * @brief 3 Accel functions combined and return value tru struct
- * @param accel
+ * @brief Block conversion to m/s2, structure of arrays out, see adxl345_convert_block_mg()
+ * @param raw samples as read, oldest first
+ * @param count number of samples
+ * @param x,y,z count values each, in m/s2, must not overlap raw or each other
+ */
+void adxl345_convert_block_ms2(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, size_t count,
+                               float *restrict x, float *restrict y, float *restrict z)
+{
+    const float scale = adxl345_scale_ms2[ADXL345_SCALE_INDEX(dev)];
+
+    for (size_t i = 0; i < count; i++) {
+        x[i] = raw[i].x * scale;
+        y[i] = raw[i].y * scale;
+        z[i] = raw[i].z * scale;
+    }
+}
+
+/**
+ * @brief m/s2 per LSB for the current data format, raw * scale = m/s2
  */
-void adxl345_get_accel(adxl345_xyz_t *accel)
+float adxl345_get_scale_ms2(adxl345_dev_t *dev)
 {
-    accel->x = adxl345_get_x();
-    accel->y = adxl345_get_y();
-    accel->z = adxl345_get_z();
-    accel->x_ms = (accel->x * ADXL345_MG2G_MULTIPLIER * GRAVITY);
-    accel->y_ms = (accel->y * ADXL345_MG2G_MULTIPLIER * GRAVITY);
-    accel->z_ms = (accel->z * ADXL345_MG2G_MULTIPLIER * GRAVITY);
+    return adxl345_scale_ms2[ADXL345_SCALE_INDEX(dev)];
 }
 
 /**
@@ -301,96 +976,83 @@ void adxl345_flush_accel_struct(adxl345_xyz_t *accel)
         | 1  |  1 |  1
         ---------------------
  * @param enable auto_Sleep
+ * @return ESP_OK or the bus error
  */
-void adxl345_set_auto_sleep(bool flip, adxl345_autosleep_readhz_t freq)
+esp_err_t adxl345_set_auto_sleep(adxl345_dev_t *dev, bool flip, adxl345_autosleep_readhz_t freq)
 {
-
-    static uint8_t power_ctl_reg = 0;
-
-    power_ctl_reg = adxl345_read8(ADXL345_REG_POWER_CTL);
-    ESP_LOGI(__func__, "Read Reg: ADXL345_REG_POWER_CTL:\t0x%X = 0b%s", power_ctl_reg, print_byte(power_ctl_reg));
+    esp_err_t err;
 
     if (flip) {
-        power_ctl_reg = 0x10 | freq;                         // 16 = 0001 0000 | 0000 0011
-        adxl345_write(ADXL345_REG_POWER_CTL, power_ctl_reg);
-
-        power_ctl_reg = adxl345_read8(ADXL345_REG_POWER_CTL);
-        ESP_LOGI(__func__, "After write: ADXL345_REG_POWER_CTL:\t0x%X = 0b%s", power_ctl_reg, print_byte(power_ctl_reg));
-
+        err = adxl345_update_reg(dev, ADXL345_REG_POWER_CTL, 0x13, 0x10 | freq);    // 16 = 0001 0000 | 0000 0011
     } else {
-
-        adxl345_write(ADXL345_REG_POWER_CTL, 0x0);
-
-        power_ctl_reg = adxl345_read8(ADXL345_REG_POWER_CTL);
-        ESP_LOGI(__func__, "After write: ADXL345_REG_POWER_CTL:\t0x%X = 0b%s", power_ctl_reg, print_byte(power_ctl_reg));
-
+        err = adxl345_update_reg(dev, ADXL345_REG_POWER_CTL, 0x13, 0x00);
     }
+
+    ESP_LOGD(__func__, "ADXL345_REG_POWER_CTL:\t0x%X = 0b%s", ADXL345_SHADOW(dev, ADXL345_REG_POWER_CTL),
+             print_byte(ADXL345_SHADOW(dev, ADXL345_REG_POWER_CTL), (char[9]) { 0 }));
+    return err;
 }
 
 /**
  * @brief Start measuring
+ * @return ESP_OK or the bus error
  */
-void adxl345_start_measure(void)
+esp_err_t adxl345_start_measure(adxl345_dev_t *dev)
 {
-    static uint8_t power_ctl_reg = 0;
+    esp_err_t err = adxl345_update_reg(dev, ADXL345_REG_POWER_CTL, 0x08, 0x08);           // 0b 0000 (1000)      Start Measuring
 
-    power_ctl_reg = adxl345_read8(ADXL345_REG_POWER_CTL);
-    ESP_LOGI(__func__, "Read Reg: ADXL345_REG_POWER_CTL:\t0x%X = 0b%s", power_ctl_reg, print_byte(power_ctl_reg));
-
-    power_ctl_reg |= 0x8;                            // 0b 0000 (1000)      Start Measuring
-    adxl345_write(ADXL345_REG_POWER_CTL, power_ctl_reg);
-
-    power_ctl_reg = adxl345_read8(ADXL345_REG_POWER_CTL);
-    ESP_LOGI(__func__, "After write: ADXL345_REG_POWER_CTL:\t0x%X = 0b%s", power_ctl_reg, print_byte(power_ctl_reg));
+    ESP_LOGD(__func__, "ADXL345_REG_POWER_CTL:\t0x%X = 0b%s", ADXL345_SHADOW(dev, ADXL345_REG_POWER_CTL),
+             print_byte(ADXL345_SHADOW(dev, ADXL345_REG_POWER_CTL), (char[9]) { 0 }));
+    return err;
 }
 
 
 
 /**
- * @brief Exponential moving averaing filter - IIR - Low pass
- *          https://blog.stratifylabs.co/device/2013-10-04-An-Easy-to-Use-Digital-Filter/
- * @param in    - Input value from sensor
- * @param average - Previous avg value
- * @param alpha   - the smoothing factor
+ * @brief Identical as adxl345_get_accel() but with an IIR low pass filter added
+ *        both on raw data and coverted to m/s2 data.
+ *        Exponential moving average in fixed point (adxl345_filter.h), the state
+ *        lives in the device handle at full precision so small alphas don't get stuck.
+ *        It starts settled on the first sample and restarts when alpha changes.
+ * @param out - Struct that contains the values
+ * @param alpha - Smoothing factor, between 0 and 1.
+ * @return ESP_OK or the bus error, out and the filter state are untouched on error
  */
-/* int32_t dsp_ema_i32(int32_t in, int32_t average, uint16_t alpha )
+esp_err_t adxl345_get_accel_iir(adxl345_dev_t *dev, adxl345_xyz_iir_t *out, float alpha)
 {
-    if ( alpha == 65535 ) {
-        return in;
-    }
+    int16_t xyz[3];
+    int32_t q16[3];
 
-    int64_t tmp0;
-    tmp0 = (int64_t)in * (alpha + 1) + average * (65536 - alpha);
-    return (int32_t)((tmp0 + 32768) / 65536);
-} */
-static double IRAM_ATTR dsp_ema_i32(double in, double average, float alpha )
-{
-    if (alpha > 1.0f) {
-        alpha = 1.0f;
-    } else if (alpha < 0.0f) {
-        alpha = 0.0f;
+    ADXL345_LOCK(dev);                      // the filter state is per device too
+    esp_err_t err = adxl345_read_xyz(dev, &xyz[0], &xyz[1], &xyz[2]);
+    if (err != ESP_OK) {
+        ADXL345_UNLOCK(dev);
+        return err;
     }
 
-    return (double)(in * (alpha) + (average * (1 - alpha)));
-}
+    if (alpha != dev->iir_alpha) {
+        adxl345_biquad_coef_t ema;
+        float a = alpha > 1.0f ? 1.0f : (alpha < 0.0f ? 0.0f : alpha);
 
+        adxl345_filter_ema((uint16_t)(a * 32768.0f + 0.5f), &ema);
+        adxl345_filter_init(&dev->iir, 3, &ema, 1);
+        adxl345_filter_reset(&dev->iir, xyz);
+        dev->iir_alpha = alpha;
+    }
 
+    adxl345_filter_process(&dev->iir, xyz, q16);
+    ADXL345_UNLOCK(dev);
 
-/**
- * @brief Identical as adxl345_get_accel() but with an IIR low pass filter added
- *        both on raw data and coverted to m/s2 data.
-  * @param out - Struct that contains the values
- * @param alpha - Smoothing factor, between 0 and 1.
- */
-void adxl345_get_accel_iir(adxl345_xyz_iir_t *out, float alpha)
-{
-    out->x = dsp_ema_i32(adxl345_get_x(), out->x, (alpha));
-    out->y = dsp_ema_i32(adxl345_get_y(), out->y, (alpha));
-    out->z = dsp_ema_i32(adxl345_get_z(), out->z, (alpha));
+    out->x = (int16_t)((q16[0] + 32768) >> 16);
+    out->y = (int16_t)((q16[1] + 32768) >> 16);
+    out->z = (int16_t)((q16[2] + 32768) >> 16);
+
+    float scale = adxl345_scale_ms2[ADXL345_SCALE_INDEX(dev)] / 65536.0f;
 
-    out->x_ms = (out->x * ADXL345_MG2G_MULTIPLIER * GRAVITY);
-    out->y_ms = (out->y * ADXL345_MG2G_MULTIPLIER * GRAVITY);
-    out->z_ms = (out->z * ADXL345_MG2G_MULTIPLIER * GRAVITY);
+    out->x_ms = q16[0] * scale;
+    out->y_ms = q16[1] * scale;
+    out->z_ms = q16[2] * scale;
+    return ESP_OK;
 }
 
 
@@ -407,20 +1069,70 @@ void adxl345_get_accel_iir(adxl345_xyz_iir_t *out, float alpha)
 
         Enable SELF_TEST: set D7 to 1
 
+ *      Only the bit, adxl345_selftest_run() does the whole test with limits.
  * @param _selftest  yes/no
+ * @return ESP_OK or the bus error
  */
-void adxl345_start_selftest(bool _selftest)
+esp_err_t adxl345_start_selftest(adxl345_dev_t *dev, bool _selftest)
 {
-    static uint8_t set_selftest = 0;
-    set_selftest = adxl345_read8(ADXL345_REG_DATA_FORMAT);
+    return adxl345_update_reg(dev, ADXL345_REG_DATA_FORMAT, 0x80, _selftest ? 0x80 : 0x00);
+}
 
-    if (_selftest) {
-        set_selftest |= 0x80;
-    } else {
-        set_selftest ^= 0x80;
+/**
+ * @brief Enable interrupts, writes the whole INT_ENABLE register.
+ *        Map the interrupts with adxl345_set_int_map() before enabling them.
+ * @param int_mask ADXL345_INT_* bits to enable, 0 disables all
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_set_int_enable(adxl345_dev_t *dev, uint8_t int_mask)
+{
+    return adxl345_write(dev, ADXL345_REG_INT_ENABLE, int_mask);
+}
+
+/**
+ * @brief Route interrupts to INT1 or INT2, bits not in int_mask keep their mapping
+ * @param int_mask ADXL345_INT_* bits to route
+ * @param pin ADXL345_INT1 or ADXL345_INT2
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_set_int_map(adxl345_dev_t *dev, uint8_t int_mask, adxl345_int_pin_t pin)
+{
+    // 1 = INT2, 0 = INT1
+    return adxl345_update_reg(dev, ADXL345_REG_INT_MAP, int_mask, pin == ADXL345_INT2 ? 0xFF : 0x00);
+}
+
+/**
+ * @brief Read INT_SOURCE. This read clears the tap, activity and free-fall bits,
+ *        DATA_READY, WATERMARK and OVERRUN only clear once the data is read.
+ * @param int_source ADXL345_INT_* bits that are set
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_int_source(adxl345_dev_t *dev, uint8_t *int_source)
+{
+    esp_err_t err;
+    uint8_t rx[1];
+
+    err = adxl345_read_regs(dev, ADXL345_REG_INT_SOURCE, rx, 1);
+    if (err != ESP_OK) {
+        return err;
     }
 
-    adxl345_write(ADXL345_REG_DATA_FORMAT, set_selftest);
+    *int_source = rx[0];
+    ADXL345_STATS_ADD(dev, fifo_overruns, (rx[0] & ADXL345_INT_OVERRUN) ? 1 : 0);
+    ADXL345_STATS_ADD(dev, watermark_hits, (rx[0] & ADXL345_INT_WATERMARK) ? 1 : 0);
+    return ESP_OK;
+}
+
+
+/**
+ * @brief Read ACT_TAP_STATUS, the axes that caused the last tap/activity event and the Asleep bit.
+ *        The bits are not cleared by reading, the next tap/activity event overwrites them.
+ * @param status ACT_X/Y/Z (D6-D4), Asleep (D3), TAP_X/Y/Z (D2-D0)
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_act_tap_status(adxl345_dev_t *dev, uint8_t *status)
+{
+    return adxl345_read_regs(dev, ADXL345_REG_ACT_TAP_STATUS, status, 1);
 }
 
 /* <=====================================================================================> */
@@ -431,115 +1143,62 @@ void adxl345_start_selftest(bool _selftest)
 */
 
 // binary values lookup table
-const char *bit_rep[16] = {
+static const char *const bit_rep[16] = {
     [ 0] = "0000", [ 1] = "0001", [ 2] = "0010", [ 3] = "0011",
     [ 4] = "0100", [ 5] = "0101", [ 6] = "0110", [ 7] = "0111",
     [ 8] = "1000", [ 9] = "1001", [10] = "1010", [11] = "1011",
     [12] = "1100", [13] = "1101", [14] = "1110", [15] = "1111",
 };
 
-static char *print_byte(uint8_t byte)
+/**
+ * @brief Byte as 8 binary digits, into the caller's buffer so tasks don't share one
+ * @param buf at least 9 chars
+ * @return buf
+ */
+static char *print_byte(uint8_t byte, char buf[9])
 {
-    static char binbyte[8];
-    snprintf(binbyte, sizeof(binbyte) + 1, "%s%s", bit_rep[byte >> 4], bit_rep[byte & 0x0F]);
-    return binbyte;
+    snprintf(buf, 9, "%s%s", bit_rep[byte >> 4], bit_rep[byte & 0x0F]);
+    return buf;
 }
 
 
 /**
- * @brief
- * @param _range_data
+ * @brief Range name, a string constant
+ * @param _range_data DATA_FORMAT D1..D0
  * @return
  */
-static char *adxl345_return_range(uint8_t _range_data)
+static const char *adxl345_return_range(uint8_t _range_data)
 {
-    static char return_range[20];
-
     switch (_range_data) {
     case 0:
-        snprintf(return_range, sizeof(return_range) + 1, "ADXL345_RANGE_2_G");
-        break;
+        return "ADXL345_RANGE_2_G";
     case 1:
-        snprintf(return_range, sizeof(return_range) + 1, "ADXL345_RANGE_4_G");
-        break;
+        return "ADXL345_RANGE_4_G";
     case 2:
-        snprintf(return_range, sizeof(return_range) + 1, "ADXL345_RANGE_8_G");
-        break;
+        return "ADXL345_RANGE_8_G";
     case 3:
-        snprintf(return_range, sizeof(return_range) + 1, "ADXL345_RANGE_16_G");
-        break;
+        return "ADXL345_RANGE_16_G";
     default:
-        snprintf(return_range, sizeof(return_range) + 1, "ADXL345_RANGE_ERROR");
-        break;
+        return "ADXL345_RANGE_ERROR";
     }
-    return return_range;
 }
 
 
 /**
- * @brief Return data rate in text format
+ * @brief Return data rate in text format, a string constant
  * @param _data_rate
  * @return
  */
-static char *adxl345_return_datarate(uint8_t _data_rate)
+static const char *adxl345_return_datarate(uint8_t _data_rate)
 {
-    static char return_data_rate[25];
-
-    switch (_data_rate) {
-    case 0:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_0_10_HZ");
-        break;
-    case 1:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_0_20_HZ");
-        break;
-    case 2:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_0_39_HZ");
-        break;
-    case 3:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_0_78_HZ");
-        break;
-    case 4:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1,  "ADXL345_DATARATE_1_56_HZ");
-        break;
-    case 5:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_3_13_HZ");
-        break;
-    case 6:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1,  "ADXL345_DATARATE_6_25HZ");
-        break;
-    case 7:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_12_5_HZ");
-        break;
-    case 8:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_25_HZ");
-        break;
-    case 9:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_50_HZ");
-        break;
-    case 10:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1,  "ADXL345_DATARATE_100_HZ");
-        break;
-    case 11:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_200_HZ");
-        break;
-    case 12:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_400_HZ");
-        break;
-    case 13:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_800_HZ");
-        break;
-    case 14:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_1600_HZ");
-        break;
-    case 15:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_3200_HZ");
-        break;
-    default:
-        snprintf(return_data_rate, sizeof(return_data_rate) + 1, "ADXL345_DATARATE_ERROR");
-        break;
-    }
-
-    return return_data_rate;
+    static const char *const names[16] = {
+        "ADXL345_DATARATE_0_10_HZ", "ADXL345_DATARATE_0_20_HZ", "ADXL345_DATARATE_0_39_HZ", "ADXL345_DATARATE_0_78_HZ",
+        "ADXL345_DATARATE_1_56_HZ", "ADXL345_DATARATE_3_13_HZ", "ADXL345_DATARATE_6_25HZ", "ADXL345_DATARATE_12_5_HZ",
+        "ADXL345_DATARATE_25_HZ", "ADXL345_DATARATE_50_HZ", "ADXL345_DATARATE_100_HZ", "ADXL345_DATARATE_200_HZ",
+        "ADXL345_DATARATE_400_HZ", "ADXL345_DATARATE_800_HZ", "ADXL345_DATARATE_1600_HZ", "ADXL345_DATARATE_3200_HZ",
+    };
+
+    return _data_rate < 16 ? names[_data_rate] : "ADXL345_DATARATE_ERROR";
 }
 
 
@@ -575,9 +1234,9 @@ Binary  Hex
 */
 
 
-/* void adxl345_set_fifo(adxl345_fifo_mode_t mode)
-{
-
+/**
+ * @brief Set the FIFO mode
+ *
         Register FIFO_CTL 0x38
         -------------------------------------------------------
         | D7  |  D6  |  D5  |  D4  | D3  |  D2  |  D1  |  D0  |
@@ -585,29 +1244,124 @@ Binary  Hex
         | FIFO_MODE  | TRIG |       SAMPLES                   |
         -------------------------------------------------------
         we focus on D7 - D6
+ * @param mode bypass, fifo, stream or trigger
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_set_fifo(adxl345_dev_t *dev, adxl345_fifo_mode_t mode)
+{
+    switch (mode) {
+    case ADXL345_FIFO_BYPASS:
+    case ADXL345_FIFO_FIFO:
+    case ADXL345_FIFO_STREAM:
+    case ADXL345_FIFO_TRIGGER:
+        break;
+    default:
+        ESP_LOGE(__func__, "Wrong fifo mode ??");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return adxl345_update_reg(dev, ADXL345_REG_FIFO_CTL, 0xC0, (uint8_t)mode << 6);
+}
+
+/**
+ * @brief Set the FIFO watermark (SAMPLES bits D4 - D0 of FIFO_CTL).
+ *        In fifo and stream mode the WATERMARK interrupt fires once this many
+ *        samples are stored, in trigger mode it is the number of samples kept
+ *        from before the trigger event.
+ * @param samples 0 - 31
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or the bus error
+ */
+esp_err_t adxl345_set_fifo_watermark(adxl345_dev_t *dev, uint8_t samples)
+{
+    if (samples > 0x1F) {
+        ESP_LOGE(__func__, "Watermark %u out of range (0 - 31)", samples);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    return adxl345_update_reg(dev, ADXL345_REG_FIFO_CTL, 0x1F, samples);
+}
+
+/**
+ * @brief Select the interrupt pin linked to the trigger event in trigger mode (D5 of FIFO_CTL)
+ * @param int2 true for INT2, false for INT1
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_set_fifo_trigger_int2(adxl345_dev_t *dev, bool int2)
+{
+    return adxl345_update_reg(dev, ADXL345_REG_FIFO_CTL, 0x20, int2 ? 0x20 : 0x00);
+}
 
-static uint8_t fifo_ctl_reg = 0;
-fifo_ctl_reg = adxl345_read8(ADXL345_REG_FIFO_CTL);
-
-fifo_ctl_reg &= ~0xF0;      // mask left part 0b (0000) 0000
-
-switch (mode)
-{
-case bypass:
-    fifo_ctl_reg |= bypass;
-    break;
-case fifo:
-    fifo_ctl_reg |= fifo;
-    break;
-case stream:
-    fifo_ctl_reg |= stream;
-    break;
-case trigger:
-    fifo_ctl_reg |= trigger;
-    break;
-default:
-    ESP_LOGE(__func__, "Wrong fifo mode ??");
-    break;
-}
-adxl345_write(ADXL345_REG_FIFO_CTL, fifo_ctl_reg);
-} */
\ No newline at end of file
+/**
+ * @brief Read the number of samples waiting in the FIFO
+ *
+        Register FIFO_STATUS 0x39
+        -------------------------------------------------------
+        | D7  |  D6  |  D5  |  D4  | D3  |  D2  |  D1  |  D0  |
+        -------------------------------------------------------
+        | FIFO_TRIG | 0 |             ENTRIES                 |
+        -------------------------------------------------------
+ * @param entries number of stored samples, 0 - 32 (33 when the output registers hold one as well)
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_get_fifo_entries(adxl345_dev_t *dev, uint8_t *entries)
+{
+    esp_err_t err;
+    uint8_t rx[1];
+
+    err = adxl345_read_regs(dev, ADXL345_REG_FIFO_STATUS, rx, 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    *entries = rx[0] & 0x3F;
+    return ESP_OK;
+}
+
+/**
+ * @brief Drain the FIFO into a caller provided array.
+ *        Reads the entry count once, then pops every sample with a 6-byte burst
+ *        of DATAX0..DATAZ1. The datasheet wants 5 us from the end of a pop to the
+ *        next FIFO or FIFO_STATUS read: an I2C transaction is longer than that by
+ *        itself, SPI above 1.6 MHz is not, so the transport's fifo_gap_us is waited
+ *        after every pop. In bypass mode the sample in the data registers is read.
+ * @param samples where to store the samples, oldest first
+ * @param max_samples size of the samples array
+ * @param count number of samples stored
+ * @return ESP_OK or the bus error, count holds the samples read before the error
+ */
+esp_err_t adxl345_read_fifo(adxl345_dev_t *dev, adxl345_raw_xyz_t *samples, size_t max_samples, size_t *count)
+{
+    esp_err_t err = ESP_OK;
+    uint8_t entries = 0;
+    ADXL345_STATS_START(t0);
+
+    *count = 0;
+
+    // one drain at a time, and no FIFO_CTL change half way through it
+    ADXL345_LOCK(dev);
+    if ((ADXL345_SHADOW(dev, ADXL345_REG_FIFO_CTL) & 0xC0) == (ADXL345_FIFO_BYPASS << 6)) {
+        entries = 1;                        // no FIFO, just the sample in the data registers
+    } else {
+        err = adxl345_get_fifo_entries(dev, &entries);
+    }
+
+    if (entries > max_samples) {
+        entries = max_samples;
+    }
+
+    for (size_t i = 0; err == ESP_OK && i < entries; i++) {
+        err = adxl345_read_xyz(dev, &samples[i].x, &samples[i].y, &samples[i].z);
+        if (err == ESP_OK) {
+            *count = i + 1;
+        }
+        if (dev->bus.fifo_gap_us != 0) {
+            esp_rom_delay_us(dev->bus.fifo_gap_us);
+        }
+    }
+    ADXL345_UNLOCK(dev);
+
+    if (err == ESP_OK) {
+        ADXL345_STATS_LATENCY(dev, ADXL345_STATS_OP_FIFO, t0);
+    }
+    return err;
+}
@@ -8,8 +8,10 @@ extern "C" {
 #endif
 
 
+#include <stddef.h>
 #include "i2c_manager.h"
 #include "sdkconfig.h"
+#include "adxl345_bus.h"
 
 
 /*=========================================================================
@@ -18,12 +20,14 @@ extern "C" {
 
 #ifdef CONFIG_ADXL345_SENSOR_ENABLED
 #define ADXL345_DEFAULT_ADDRESS CONFIG_ADXL345_I2C_ADDRESS_0            // set assigned I2C Address
+#define ADXL345_DEFAULT_I2C_PORT CONFIG_ADXL345_I2C_PORT_0              // set assigned I2C Port
 #else
 #define ADXL345_DEFAULT_ADDRESS (0x53)                                  ///< Assumes ALT address pin low, when pin high (0x1D)
+#define ADXL345_DEFAULT_I2C_PORT I2C_NUM_0                              // I2C_NUM_1 is also an option :-)
 #endif
 
-#define ADXL345_I2C_ADDRESS     ADXL345_DEFAULT_ADDRESS
-#define I2C_PORT I2C_NUM_0      // I2C Port assignment, I2C_NUM_1 is also an option :-)
+#define ADXL345_ADDRESS_ALT_LOW     (0x53)      ///< ALT address pin low
+#define ADXL345_ADDRESS_ALT_HIGH    (0x1D)      ///< ALT address pin high
 
 
 /*=========================================================================
@@ -130,12 +134,67 @@ typedef struct {
     float z_ms;
 } adxl345_xyz_iir_t;
 
-/* typedef enum {
-    bypass = 0x00,
-    fifo = 0x01,
-    stream = 0x02,
-    trigger = 0x03,
-} adxl345_fifo_mode_t; */
+/**
+ * @brief Raw x,y,z sample, as read from DATAX0..DATAZ1 or popped from the FIFO
+ */
+typedef struct {
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} adxl345_raw_xyz_t;
+
+/**
+ * @brief x,y,z in integer units, milli-g or micro-m/s2
+ */
+typedef struct {
+    int32_t x;
+    int32_t y;
+    int32_t z;
+} adxl345_xyz_i32_t;
+
+/**
+ * @brief Raw sample with the time it was taken
+ */
+typedef struct {
+    int64_t timestamp_us;       ///< esp_timer_get_time() time base
+    int16_t x;
+    int16_t y;
+    int16_t z;
+} adxl345_sample_t;
+
+/**
+ * @brief Used with register 0x38 (ADXL345_REG_FIFO_CTL) bits D7-D6 to set the FIFO mode
+ */
+typedef enum {
+    ADXL345_FIFO_BYPASS = 0x00,     ///< FIFO bypassed (default value)
+    ADXL345_FIFO_FIFO = 0x01,       ///< Collect up to 32 samples, then stop
+    ADXL345_FIFO_STREAM = 0x02,     ///< Hold the latest 32 samples, oldest are overwritten
+    ADXL345_FIFO_TRIGGER = 0x03,    ///< Stream until the trigger event, then hold
+} adxl345_fifo_mode_t;
+
+#define ADXL345_FIFO_SIZE (32)      ///< Number of samples the FIFO can hold
+
+/**
+ * @brief Interrupt bits, same layout in INT_ENABLE (0x2E), INT_MAP (0x2F) and INT_SOURCE (0x30)
+ */
+typedef enum {
+    ADXL345_INT_DATA_READY = 0x80,  ///< New data available
+    ADXL345_INT_SINGLE_TAP = 0x40,  ///< Single tap detected
+    ADXL345_INT_DOUBLE_TAP = 0x20,  ///< Double tap detected
+    ADXL345_INT_ACTIVITY = 0x10,    ///< Activity detected
+    ADXL345_INT_INACTIVITY = 0x08,  ///< Inactivity detected
+    ADXL345_INT_FREE_FALL = 0x04,   ///< Free-fall detected
+    ADXL345_INT_WATERMARK = 0x02,   ///< FIFO holds at least watermark samples
+    ADXL345_INT_OVERRUN = 0x01      ///< Samples were lost
+} adxl345_int_t;
+
+/**
+ * @brief Interrupt output pins
+ */
+typedef enum {
+    ADXL345_INT1 = 0x00,
+    ADXL345_INT2 = 0x01
+} adxl345_int_pin_t;
 
 /**
  * @brief Read freq during sleep;
@@ -148,28 +207,131 @@ typedef enum {
 } adxl345_autosleep_readhz_t;
 
 
+/**
+ * @brief Device handle, one per sensor. Create with adxl345_create().
+ */
+typedef struct adxl345_dev_t adxl345_dev_t;
+
+/**
+ * @brief What to do when a transaction fails. Retries wait backoff_us, doubling up to
+ *        backoff_max_us; every recover_after failed attempts in a row the transport
+ *        clears the bus (9 SCL pulses + STOP for I2C). Once a transaction works again
+ *        after errors the driver checks whether the sensor was reset (brownout) and
+ *        writes its configuration back, see adxl345_check_health().
+ *        The defaults give up after ~1 ms.
+ */
+typedef struct {
+    uint8_t retries;            ///< extra attempts per transaction, 0 fails right away
+    uint16_t backoff_us;        ///< wait before the first retry
+    uint16_t backoff_max_us;    ///< longest wait between retries
+    uint8_t recover_after;      ///< failed attempts before a bus clear, 0 never
+    bool reapply_config;        ///< write the configuration back after a sensor reset
+} adxl345_recovery_config_t;
+
+#define ADXL345_RECOVERY_CONFIG_DEFAULT() {     \
+    .retries = 3,                               \
+    .backoff_us = 100,                          \
+    .backoff_max_us = 1000,                     \
+    .recover_after = 2,                         \
+    .reapply_config = true,                     \
+}
+
+/**
+ * @brief Where to find the sensor
+ */
+typedef struct {
+    i2c_port_t i2c_port;        ///< I2C_NUM_0 or I2C_NUM_1
+    uint8_t i2c_address;        ///< ADXL345_ADDRESS_ALT_LOW or ADXL345_ADDRESS_ALT_HIGH
+    const adxl345_bus_t *bus;   ///< NULL: I2C on i2c_port/i2c_address, else this transport (copied, you keep ownership)
+    adxl345_recovery_config_t recovery;
+} adxl345_dev_config_t;
+
+#define ADXL345_DEV_CONFIG_DEFAULT() {              \
+    .i2c_port = ADXL345_DEFAULT_I2C_PORT,           \
+    .i2c_address = ADXL345_DEFAULT_ADDRESS,         \
+    .bus = NULL,                                    \
+    .recovery = ADXL345_RECOVERY_CONFIG_DEFAULT(),  \
+}
+
+/**
+ * @brief Complete device configuration as raw register values, see adxl345_apply_config()
+ */
+typedef struct {
+    uint8_t thresh_tap;         ///< 0x1D THRESH_TAP, 62.5 mg/LSB
+    int8_t ofsx;                ///< 0x1E OFSX, 15.6 mg/LSB
+    int8_t ofsy;                ///< 0x1F OFSY, 15.6 mg/LSB
+    int8_t ofsz;                ///< 0x20 OFSZ, 15.6 mg/LSB
+    uint8_t dur;                ///< 0x21 DUR, 625 us/LSB
+    uint8_t latent;             ///< 0x22 LATENT, 1.25 ms/LSB
+    uint8_t window;             ///< 0x23 WINDOW, 1.25 ms/LSB
+    uint8_t thresh_act;         ///< 0x24 THRESH_ACT, 62.5 mg/LSB
+    uint8_t thresh_inact;       ///< 0x25 THRESH_INACT, 62.5 mg/LSB
+    uint8_t time_inact;         ///< 0x26 TIME_INACT, 1 s/LSB
+    uint8_t act_inact_ctl;      ///< 0x27 ACT_INACT_CTL
+    uint8_t thresh_ff;          ///< 0x28 THRESH_FF, 62.5 mg/LSB
+    uint8_t time_ff;            ///< 0x29 TIME_FF, 5 ms/LSB
+    uint8_t tap_axes;           ///< 0x2A TAP_AXES
+    uint8_t bw_rate;            ///< 0x2C BW_RATE, LOW_POWER (D4) | adxl345_datarate_t
+    uint8_t power_ctl;          ///< 0x2D POWER_CTL
+    uint8_t int_enable;         ///< 0x2E INT_ENABLE, ADXL345_INT_* bits
+    uint8_t int_map;            ///< 0x2F INT_MAP, ADXL345_INT_* bits routed to INT2
+    uint8_t data_format;        ///< 0x31 DATA_FORMAT
+    uint8_t fifo_ctl;           ///< 0x38 FIFO_CTL
+} adxl345_config_t;
+
+/**
+ * @brief Power-on register values
+ */
+#define ADXL345_CONFIG_DEFAULT() {              \
+    .bw_rate = ADXL345_DATARATE_100_HZ,         \
+}
+
 /**
  * Function prototyping
  * 
  */
-esp_err_t adxl345_chipid(void);
-char *adxl345_get_datarate(void);
-void adxl345_set_datarate(adxl345_datarate_t data_rate);
-char *adxl345_get_range(void);
-void adxl345_set_range(uint8_t range);
-bool adxl345_begin(void);
-int16_t adxl345_get_x(void);
-int16_t adxl345_get_y(void);
-int16_t adxl345_get_z(void);
-void adxl345_get_accel(adxl345_xyz_t *accel);
-void adxl345_set_auto_sleep(bool flip, adxl345_autosleep_readhz_t freq);
-void adxl345_start_measure(void);
-// void adxl345_set_fifo(adxl345_fifo_mode_t mode);
+esp_err_t adxl345_create(const adxl345_dev_config_t *config, adxl345_dev_t **out_dev);
+void adxl345_destroy(adxl345_dev_t *dev);
+esp_err_t adxl345_chipid(adxl345_dev_t *dev);
+const char *adxl345_get_datarate(adxl345_dev_t *dev);
+esp_err_t adxl345_set_datarate(adxl345_dev_t *dev, adxl345_datarate_t data_rate);
+esp_err_t adxl345_set_low_power(adxl345_dev_t *dev, bool enable);
+esp_err_t adxl345_set_bw_rate(adxl345_dev_t *dev, adxl345_datarate_t data_rate, bool low_power);
+uint64_t adxl345_get_sample_period_ns(adxl345_dev_t *dev);
+const char *adxl345_get_range(adxl345_dev_t *dev);
+esp_err_t adxl345_set_range(adxl345_dev_t *dev, uint8_t range);
+esp_err_t adxl345_begin(adxl345_dev_t *dev);
+esp_err_t adxl345_check_health(adxl345_dev_t *dev, bool *reapplied);
+esp_err_t adxl345_resync_regs(adxl345_dev_t *dev);
+esp_err_t adxl345_verify_regs(adxl345_dev_t *dev);
+esp_err_t adxl345_apply_config(adxl345_dev_t *dev, const adxl345_config_t *config, bool verify);
+void adxl345_get_config(adxl345_dev_t *dev, adxl345_config_t *config);
+esp_err_t adxl345_get_x(adxl345_dev_t *dev, int16_t *x);
+esp_err_t adxl345_get_y(adxl345_dev_t *dev, int16_t *y);
+esp_err_t adxl345_get_z(adxl345_dev_t *dev, int16_t *z);
+esp_err_t adxl345_get_accel(adxl345_dev_t *dev, adxl345_xyz_t *accel);
+esp_err_t adxl345_set_auto_sleep(adxl345_dev_t *dev, bool flip, adxl345_autosleep_readhz_t freq);
+esp_err_t adxl345_start_measure(adxl345_dev_t *dev);
+esp_err_t adxl345_set_fifo(adxl345_dev_t *dev, adxl345_fifo_mode_t mode);
+esp_err_t adxl345_set_fifo_watermark(adxl345_dev_t *dev, uint8_t samples);
+esp_err_t adxl345_set_fifo_trigger_int2(adxl345_dev_t *dev, bool int2);
+esp_err_t adxl345_get_fifo_entries(adxl345_dev_t *dev, uint8_t *entries);
+esp_err_t adxl345_read_fifo(adxl345_dev_t *dev, adxl345_raw_xyz_t *samples, size_t max_samples, size_t *count);
+esp_err_t adxl345_set_int_enable(adxl345_dev_t *dev, uint8_t int_mask);
+esp_err_t adxl345_set_int_map(adxl345_dev_t *dev, uint8_t int_mask, adxl345_int_pin_t pin);
+esp_err_t adxl345_get_int_source(adxl345_dev_t *dev, uint8_t *int_source);
+esp_err_t adxl345_get_act_tap_status(adxl345_dev_t *dev, uint8_t *status);
 void adxl345_flush_accel_struct(adxl345_xyz_t *accel);
-void adxl345_get_accel_iir(adxl345_xyz_iir_t *out, float alpha);
-void adxl345_set_fullres_mode(bool onoff);
-void adxl345_start_selftest(bool _selftest);
-
+esp_err_t adxl345_get_accel_iir(adxl345_dev_t *dev, adxl345_xyz_iir_t *out, float alpha);
+esp_err_t adxl345_get_accel_mg(adxl345_dev_t *dev, adxl345_xyz_i32_t *mg);
+esp_err_t adxl345_get_accel_um_s2(adxl345_dev_t *dev, adxl345_xyz_i32_t *um_s2);
+void adxl345_convert_mg(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, adxl345_xyz_i32_t *mg, size_t count);
+void adxl345_convert_um_s2(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, adxl345_xyz_i32_t *um_s2, size_t count);
+float adxl345_get_scale_ms2(adxl345_dev_t *dev);
+void adxl345_convert_block_mg(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, size_t count, int32_t *x, int32_t *y, int32_t *z);
+void adxl345_convert_block_ms2(adxl345_dev_t *dev, const adxl345_raw_xyz_t *raw, size_t count, float *x, float *y, float *z);
+esp_err_t adxl345_set_fullres_mode(adxl345_dev_t *dev, bool onoff);
+esp_err_t adxl345_start_selftest(adxl345_dev_t *dev, bool _selftest);
 
 #ifdef __cplusplus
 }
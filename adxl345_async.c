@@ -0,0 +1,332 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_async.h"
+#include "adxl345_priv.h"
+
+
+/* a queued job, writes carry their values */
+typedef struct {
+    adxl345_async_job_t job;
+    bool stop;                          // destroy() asks the worker to exit
+    uint8_t data[ADXL345_ASYNC_MAX_WRITE];
+} async_item_t;
+
+struct adxl345_async_t {
+    QueueHandle_t queue;
+    TaskHandle_t task;                  // NULL without a worker, adxl345_async_poll() runs the jobs
+    SemaphoreHandle_t stopped;          // given by the worker when it reached the stop item
+    uint8_t max_merge;
+    adxl345_async_stats_t stats;
+    async_item_t merged[ADXL345_ASYNC_MAX_MERGE - 1];   // reads riding along with the current one
+    uint8_t burst[ADXL345_ASYNC_MAX_BURST];
+};
+
+
+/* prototype static functions */
+
+static void adxl345_async_task(void *vParm);
+static void adxl345_async_run(adxl345_async_t *async, async_item_t *first);
+static void adxl345_async_complete(adxl345_async_t *async, async_item_t *item, esp_err_t err);
+static bool adxl345_async_mergeable(const adxl345_async_job_t *last, const adxl345_async_job_t *next, size_t burst_len);
+
+
+/**
+ * @brief Create a worker with its queue and task
+ * @param config queue depth, merging and task parameters
+ * @param out_async the new worker
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ */
+esp_err_t adxl345_async_create(const adxl345_async_config_t *config, adxl345_async_t **out_async)
+{
+    if (config == NULL || out_async == NULL || config->queue_depth == 0 ||
+            config->max_merge == 0 || config->max_merge > ADXL345_ASYNC_MAX_MERGE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    adxl345_async_t *async = calloc(1, sizeof(adxl345_async_t));
+    if (async == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    async->max_merge = config->max_merge;
+    async->queue = xQueueCreate(config->queue_depth + 1, sizeof(async_item_t));    // + 1 keeps room for the stop item
+    if (async->queue == NULL) {
+        free(async);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (!config->worker) {
+        *out_async = async;
+        return ESP_OK;
+    }
+
+    async->stopped = xSemaphoreCreateBinary();
+    if (async->stopped == NULL) {
+        vQueueDelete(async->queue);
+        free(async);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreate(adxl345_async_task, "adxl345_async", config->task_stack, async,
+                    config->task_priority, &async->task) != pdPASS) {
+        vSemaphoreDelete(async->stopped);
+        vQueueDelete(async->queue);
+        free(async);
+        return ESP_ERR_NO_MEM;
+    }
+
+    *out_async = async;
+    return ESP_OK;
+}
+
+/**
+ * @brief Finish the queued jobs, stop the worker and free it.
+ *        Not from a completion callback, that runs on the worker.
+ * @param async NULL is ignored
+ */
+void adxl345_async_destroy(adxl345_async_t *async)
+{
+    if (async == NULL) {
+        return;
+    }
+
+    if (async->task != NULL) {
+        const async_item_t stop = { .stop = true };
+
+        // own semaphore: job notifications to the caller must not end the wait early
+        xQueueSend(async->queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(async->stopped, portMAX_DELAY);
+        vSemaphoreDelete(async->stopped);
+    } else {
+        adxl345_async_poll(async, SIZE_MAX);
+    }
+
+    vQueueDelete(async->queue);
+    free(async);
+}
+
+/**
+ * @brief Queue a job
+ * @param job copied, the write values too
+ * @param wait ticks to wait for room in the queue, 0 to fail right away
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_TIMEOUT when the queue stayed full
+ */
+esp_err_t adxl345_async_submit(adxl345_async_t *async, const adxl345_async_job_t *job, TickType_t wait)
+{
+    async_item_t item = { .stop = false };
+
+    if (async == NULL || job == NULL || job->dev == NULL || job->buf == NULL || job->len == 0 ||
+            job->len > (job->op == ADXL345_ASYNC_WRITE ? ADXL345_ASYNC_MAX_WRITE : ADXL345_ASYNC_MAX_BURST)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    item.job = *job;
+    if (job->op == ADXL345_ASYNC_WRITE) {
+        memcpy(item.data, job->buf, job->len);
+    }
+
+    if (xQueueSend(async->queue, &item, wait) != pdPASS) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+/**
+ * @brief Queue a read of len registers from reg on, no waiting for room
+ * @param buf destination, valid until the callback
+ * @return see adxl345_async_submit()
+ */
+esp_err_t adxl345_async_read(adxl345_async_t *async, adxl345_dev_t *dev, uint8_t reg, uint8_t *buf, uint8_t len,
+                             adxl345_async_cb_t callback, void *arg)
+{
+    const adxl345_async_job_t job = {
+        .dev = dev,
+        .op = ADXL345_ASYNC_READ,
+        .reg = reg,
+        .len = len,
+        .buf = buf,
+        .callback = callback,
+        .arg = arg,
+    };
+
+    return adxl345_async_submit(async, &job, 0);
+}
+
+/**
+ * @brief Queue a write of len registers from reg on, no waiting for room
+ * @param values copied, can be reused right away
+ * @return see adxl345_async_submit()
+ */
+esp_err_t adxl345_async_write(adxl345_async_t *async, adxl345_dev_t *dev, uint8_t reg, const uint8_t *values, uint8_t len,
+                              adxl345_async_cb_t callback, void *arg)
+{
+    const adxl345_async_job_t job = {
+        .dev = dev,
+        .op = ADXL345_ASYNC_WRITE,
+        .reg = reg,
+        .len = len,
+        .buf = (uint8_t *)values,
+        .callback = callback,
+        .arg = arg,
+    };
+
+    return adxl345_async_submit(async, &job, 0);
+}
+
+/**
+ * @brief Run queued jobs in the calling task. Only for a queue created without a
+ *        worker (config->worker false), e.g. the host build or a task that owns the bus;
+ *        the job scratch is not shared with a running worker.
+ * @param max_jobs stop after this many queue entries
+ * @return queue entries handled, merged ones count once; 0 when there is a worker
+ */
+size_t adxl345_async_poll(adxl345_async_t *async, size_t max_jobs)
+{
+    async_item_t item;
+    size_t done = 0;
+
+    if (async->task != NULL) {
+        ESP_LOGE(__func__, "The worker task runs the jobs, create without worker to poll");
+        return 0;
+    }
+
+    while (done < max_jobs && xQueuePeek(async->queue, &item, 0) == pdTRUE && !item.stop) {
+        xQueueReceive(async->queue, &item, 0);
+        adxl345_async_run(async, &item);
+        done++;
+    }
+
+    return done;
+}
+
+/**
+ * @brief Counters since create
+ */
+void adxl345_async_get_stats(adxl345_async_t *async, adxl345_async_stats_t *stats)
+{
+    *stats = async->stats;
+}
+
+/**
+ * @brief Worker: one job at a time, exits on the stop item
+ */
+static void adxl345_async_task(void *vParm)
+{
+    adxl345_async_t *async = vParm;
+    async_item_t item;
+
+    for (;;) {
+        if (xQueueReceive(async->queue, &item, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (item.stop) {
+            break;
+        }
+        adxl345_async_run(async, &item);
+    }
+
+    xSemaphoreGive(async->stopped);     // async belongs to destroy() from here on
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief next reads the registers right after last, same sensor, and the burst stays in range
+ */
+static bool adxl345_async_mergeable(const adxl345_async_job_t *last, const adxl345_async_job_t *next, size_t burst_len)
+{
+    return next->op == ADXL345_ASYNC_READ && next->dev == last->dev &&
+           next->reg == (uint8_t)(last->reg + last->len) &&
+           burst_len + next->len <= ADXL345_ASYNC_MAX_BURST;
+}
+
+/**
+ * @brief Execute one job, plus the reads waiting behind it that continue it
+ */
+static void adxl345_async_run(adxl345_async_t *async, async_item_t *first)
+{
+    adxl345_async_job_t *job = &first->job;
+    esp_err_t err;
+
+    if (job->op == ADXL345_ASYNC_WRITE) {
+        err = adxl345_write_regs(job->dev, job->reg, first->data, job->len);
+        async->stats.transactions++;
+        adxl345_async_complete(async, first, err);
+        return;
+    }
+
+    async_item_t *merged = async->merged;
+    size_t count = 0;
+    size_t burst_len = job->len;
+    const adxl345_async_job_t *last = job;
+
+    while (count + 1 < async->max_merge &&
+            xQueuePeek(async->queue, &merged[count], 0) == pdTRUE &&
+            !merged[count].stop && adxl345_async_mergeable(last, &merged[count].job, burst_len)) {
+        xQueueReceive(async->queue, &merged[count], 0);
+        burst_len += merged[count].job.len;
+        last = &merged[count].job;
+        count++;
+    }
+
+    if (count == 0) {
+        err = adxl345_read_regs(job->dev, job->reg, job->buf, job->len);
+        async->stats.transactions++;
+        adxl345_async_complete(async, first, err);
+        return;
+    }
+
+    err = adxl345_read_regs(job->dev, job->reg, async->burst, burst_len);
+    async->stats.transactions++;
+    async->stats.merged += count;
+
+    size_t offset = job->len;
+
+    if (err == ESP_OK) {
+        memcpy(job->buf, async->burst, job->len);
+    }
+    adxl345_async_complete(async, first, err);
+
+    for (size_t i = 0; i < count; i++) {
+        adxl345_async_job_t *m = &merged[i].job;
+
+        if (err == ESP_OK) {
+            memcpy(m->buf, &async->burst[offset], m->len);
+        }
+        offset += m->len;
+        adxl345_async_complete(async, &merged[i], err);
+    }
+}
+
+/**
+ * @brief Report a finished job: result, callback, notification
+ */
+static void adxl345_async_complete(adxl345_async_t *async, async_item_t *item, esp_err_t err)
+{
+    adxl345_async_job_t *job = &item->job;
+
+    async->stats.jobs++;
+    if (err != ESP_OK) {
+        async->stats.errors++;
+    }
+
+    if (job->result != NULL) {
+        *job->result = err;
+    }
+    if (job->callback != NULL) {
+        job->callback(job, err);
+    }
+    if (job->notify != NULL) {
+        xTaskNotifyGive(job->notify);
+    }
+}
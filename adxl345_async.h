@@ -0,0 +1,94 @@
+/**
+ * Asynchronous register access. Jobs (read or write of consecutive registers) are
+ * queued to a bus worker task and the caller continues right away; the worker runs
+ * them back to back and reports through a callback and/or a task notification.
+ * One worker per physical bus, shared by all sensors on it, so polling several
+ * sensors becomes a pipeline instead of blocking every task in turn.
+ *
+ * Queued reads of the same sensor that continue each other (0x32..0x33, then
+ * 0x34..0x37) are merged into one burst when they are waiting together.
+ *
+ * Writes are copied at submit (up to ADXL345_ASYNC_MAX_WRITE bytes), read buffers
+ * have to stay valid until the job completes. The shadow copy is kept up to date
+ * like for the blocking calls.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_ASYNC_MAX_WRITE     16      ///< THRESH_TAP..TAP_AXES fits
+#define ADXL345_ASYNC_MAX_BURST     64      ///< longest merged read
+#define ADXL345_ASYNC_MAX_MERGE     8       ///< most jobs in one merged read
+
+typedef struct adxl345_async_t adxl345_async_t;
+
+typedef enum {
+    ADXL345_ASYNC_READ = 0,
+    ADXL345_ASYNC_WRITE,
+} adxl345_async_op_t;
+
+typedef struct adxl345_async_job_t adxl345_async_job_t;
+
+/**
+ * @brief Completion, called from the worker task. Keep it short, the next job waits.
+ */
+typedef void (*adxl345_async_cb_t)(const adxl345_async_job_t *job, esp_err_t err);
+
+struct adxl345_async_job_t {
+    adxl345_dev_t *dev;
+    adxl345_async_op_t op;
+    uint8_t reg;                        ///< first register
+    uint8_t len;                        ///< registers, 1..ADXL345_ASYNC_MAX_BURST (writes: ADXL345_ASYNC_MAX_WRITE)
+    uint8_t *buf;                       ///< read: destination, write: values (copied at submit)
+    adxl345_async_cb_t callback;        ///< NULL for none
+    void *arg;                          ///< for the callback
+    TaskHandle_t notify;                ///< gets xTaskNotifyGive() when done, NULL for none
+    esp_err_t *result;                  ///< set before callback/notify, NULL for none
+};
+
+typedef struct {
+    uint16_t queue_depth;               ///< jobs that can wait
+    uint8_t max_merge;                  ///< jobs merged into one read, 1..ADXL345_ASYNC_MAX_MERGE, 1 disables merging
+    bool worker;                        ///< run the jobs on a worker task, false: adxl345_async_poll() runs them
+    uint32_t task_stack;                ///< worker stack size
+    uint32_t task_priority;             ///< worker priority
+} adxl345_async_config_t;
+
+#define ADXL345_ASYNC_CONFIG_DEFAULT() {    \
+    .queue_depth = 16,                      \
+    .max_merge = 8,                         \
+    .worker = true,                         \
+    .task_stack = 3072,                     \
+    .task_priority = 9,                     \
+}
+
+typedef struct {
+    uint32_t jobs;                      ///< jobs completed
+    uint32_t transactions;              ///< bus transactions they took
+    uint32_t merged;                    ///< jobs that rode along in another job's read
+    uint32_t errors;                    ///< jobs completed with an error
+} adxl345_async_stats_t;
+
+esp_err_t adxl345_async_create(const adxl345_async_config_t *config, adxl345_async_t **out_async);
+void adxl345_async_destroy(adxl345_async_t *async);
+esp_err_t adxl345_async_submit(adxl345_async_t *async, const adxl345_async_job_t *job, TickType_t wait);
+esp_err_t adxl345_async_read(adxl345_async_t *async, adxl345_dev_t *dev, uint8_t reg, uint8_t *buf, uint8_t len,
+                             adxl345_async_cb_t callback, void *arg);
+esp_err_t adxl345_async_write(adxl345_async_t *async, adxl345_dev_t *dev, uint8_t reg, const uint8_t *values, uint8_t len,
+                              adxl345_async_cb_t callback, void *arg);
+size_t adxl345_async_poll(adxl345_async_t *async, size_t max_jobs);
+void adxl345_async_get_stats(adxl345_async_t *async, adxl345_async_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,211 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "adxl345.h"
+#include "adxl345_boot.h"
+#include "adxl345_priv.h"
+
+
+#define BOOT_MERGE_GAP      3       // registers a burst may run through rather than start a new transaction
+#define BOOT_MAX_RUNS       ADXL345_SHADOW_SIZE
+#define BOOT_TURN_ON_US     1100    // datasheet: first sample 1.1 ms + 1 / ODR after measure is set
+#define BOOT_POLL_MIN_US    50
+#define BOOT_TIMEOUT_PERIODS 4      // sample periods past the turn-on time before giving up
+
+
+typedef struct {
+    uint8_t reg;
+    uint8_t len;
+} boot_run_t;
+
+
+/* prototype static functions */
+
+static void boot_image(const adxl345_config_t *config, uint8_t image[ADXL345_SHADOW_SIZE]);
+static bool boot_bridgeable(uint8_t reg);
+static esp_err_t boot_first_sample(adxl345_dev_t *dev, adxl345_boot_report_t *report);
+
+
+/**
+ * @brief Config as register values, indexed like the shadow copy. The read-only
+ *        registers in between are 0x00.
+ */
+static void boot_image(const adxl345_config_t *config, uint8_t image[ADXL345_SHADOW_SIZE])
+{
+    memset(image, 0, ADXL345_SHADOW_SIZE);
+
+#define BOOT_REG(reg)   image[(reg) - ADXL345_SHADOW_FIRST]
+    BOOT_REG(ADXL345_REG_THRESH_TAP) = config->thresh_tap;
+    BOOT_REG(ADXL345_REG_OFSX) = (uint8_t)config->ofsx;
+    BOOT_REG(ADXL345_REG_OFSY) = (uint8_t)config->ofsy;
+    BOOT_REG(ADXL345_REG_OFSZ) = (uint8_t)config->ofsz;
+    BOOT_REG(ADXL345_REG_DUR) = config->dur;
+    BOOT_REG(ADXL345_REG_LATENT) = config->latent;
+    BOOT_REG(ADXL345_REG_WINDOW) = config->window;
+    BOOT_REG(ADXL345_REG_THRESH_ACT) = config->thresh_act;
+    BOOT_REG(ADXL345_REG_THRESH_INACT) = config->thresh_inact;
+    BOOT_REG(ADXL345_REG_TIME_INACT) = config->time_inact;
+    BOOT_REG(ADXL345_REG_ACT_INACT_CTL) = config->act_inact_ctl;
+    BOOT_REG(ADXL345_REG_THRESH_FF) = config->thresh_ff;
+    BOOT_REG(ADXL345_REG_TIME_FF) = config->time_ff;
+    BOOT_REG(ADXL345_REG_TAP_AXES) = config->tap_axes;
+    BOOT_REG(ADXL345_REG_BW_RATE) = config->bw_rate;
+    BOOT_REG(ADXL345_REG_POWER_CTL) = config->power_ctl;
+    BOOT_REG(ADXL345_REG_INT_ENABLE) = config->int_enable;
+    BOOT_REG(ADXL345_REG_INT_MAP) = config->int_map;
+    BOOT_REG(ADXL345_REG_DATA_FORMAT) = config->data_format;
+    BOOT_REG(ADXL345_REG_FIFO_CTL) = config->fifo_ctl;
+#undef BOOT_REG
+}
+
+/**
+ * @brief A burst may run through writable registers and the two status registers,
+ *        the sensor ignores bytes written to those. Not through the data registers.
+ */
+static bool boot_bridgeable(uint8_t reg)
+{
+    return adxl345_reg_writable(reg) || reg == ADXL345_REG_ACT_TAP_STATUS || reg == ADXL345_REG_INT_SOURCE;
+}
+
+/**
+ * @brief Start the sensor with a complete configuration in the fewest transactions.
+ *        The registers to write are grouped into bursts, short gaps are written
+ *        through. The burst with POWER_CTL goes last: registers after it in the same
+ *        burst land a few hundred us before the first conversion (1.1 ms at the
+ *        earliest), the others before measuring starts. No readback, no logging
+ *        unless something fails; adxl345_verify_regs() is there when you want it.
+ *        Reading the first sample clears INT_SOURCE and pops one FIFO entry.
+ * @param config registers and options, NULL for ADXL345_BOOT_CONFIG_DEFAULT()
+ * @param report timing and transaction count, may be NULL
+ * @return ESP_OK, ESP_ERR_NOT_FOUND when the chip ID is wrong, ESP_ERR_TIMEOUT when
+ *         no sample shows up, or the bus error
+ */
+esp_err_t adxl345_begin_fast(adxl345_dev_t *dev, const adxl345_boot_config_t *config, adxl345_boot_report_t *report)
+{
+    adxl345_boot_config_t cfg = ADXL345_BOOT_CONFIG_DEFAULT();
+    adxl345_boot_report_t rep = { .start_us = esp_timer_get_time() };
+    uint8_t image[ADXL345_SHADOW_SIZE];
+    boot_run_t runs[BOOT_MAX_RUNS];
+    size_t n_runs = 0;
+    size_t measure_run = BOOT_MAX_RUNS;     // the burst with POWER_CTL
+    esp_err_t err = ESP_OK;
+
+    if (dev == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (config != NULL) {
+        cfg = *config;
+    }
+    boot_image(&cfg.regs, image);
+
+    for (uint8_t reg = ADXL345_SHADOW_FIRST; reg <= ADXL345_SHADOW_LAST; reg++) {
+        uint8_t reset = reg == ADXL345_REG_BW_RATE ? ADXL345_DATARATE_100_HZ : 0x00;
+
+        if (!adxl345_reg_writable(reg) || (cfg.from_reset && image[reg - ADXL345_SHADOW_FIRST] == reset)) {
+            continue;
+        }
+
+        bool merge = false;
+
+        if (n_runs > 0) {
+            boot_run_t *run = &runs[n_runs - 1];
+
+            merge = reg - (run->reg + run->len) <= BOOT_MERGE_GAP;
+            for (uint8_t gap = run->reg + run->len; merge && gap < reg; gap++) {
+                merge = boot_bridgeable(gap);
+            }
+            if (merge) {
+                run->len = reg - run->reg + 1;
+            }
+        }
+        if (!merge) {
+            runs[n_runs++] = (boot_run_t) { .reg = reg, .len = 1 };
+        }
+        if (reg == ADXL345_REG_POWER_CTL) {
+            measure_run = n_runs - 1;
+        }
+    }
+
+    ADXL345_LOCK(dev);
+    if (cfg.check_id) {
+        err = adxl345_chipid(dev);
+        rep.transactions++;
+    }
+
+    // every burst but the one that starts measuring, then that one
+    for (size_t i = 0; err == ESP_OK && i <= n_runs; i++) {
+        size_t r = i < n_runs ? i : measure_run;
+
+        if ((i < n_runs && i == measure_run) || r >= n_runs) {
+            continue;
+        }
+        err = adxl345_write_regs(dev, runs[r].reg, &image[runs[r].reg - ADXL345_SHADOW_FIRST], runs[r].len);
+        rep.transactions++;
+        rep.bytes_written += runs[r].len;
+    }
+
+    if (err == ESP_OK) {
+        // what was not written is at its reset value, same as in the image
+        for (uint8_t reg = ADXL345_SHADOW_FIRST; reg <= ADXL345_SHADOW_LAST; reg++) {
+            if (adxl345_reg_writable(reg)) {
+                ADXL345_SHADOW(dev, reg) = image[reg - ADXL345_SHADOW_FIRST];
+            }
+        }
+    }
+    rep.config_us = (uint32_t)(esp_timer_get_time() - rep.start_us);
+
+    if (err == ESP_OK && cfg.wait_sample && (cfg.regs.power_ctl & 0x08)) {
+        err = boot_first_sample(dev, &rep);
+    }
+    ADXL345_UNLOCK(dev);
+
+    if (report != NULL) {
+        *report = rep;
+    }
+    return err;
+}
+
+/**
+ * @brief Wait out the turn-on time, then poll INT_SOURCE together with the data
+ *        registers in one 8 byte burst until DATA_READY comes with a sample
+ */
+static esp_err_t boot_first_sample(adxl345_dev_t *dev, adxl345_boot_report_t *report)
+{
+    uint32_t period_us = (uint32_t)(adxl345_get_sample_period_ns(dev) / 1000);
+    uint32_t poll_us = period_us / 8 > BOOT_POLL_MIN_US ? period_us / 8 : BOOT_POLL_MIN_US;
+    int64_t measure_us = esp_timer_get_time();
+    int64_t deadline = measure_us + BOOT_TURN_ON_US + (int64_t)BOOT_TIMEOUT_PERIODS * period_us;
+    uint8_t rx[8];      // INT_SOURCE, DATA_FORMAT, DATAX0..DATAZ1
+    esp_err_t err;
+
+    adxl345_wait_us(BOOT_TURN_ON_US + period_us);
+
+    for (;;) {
+        err = adxl345_read_regs(dev, ADXL345_REG_INT_SOURCE, rx, sizeof(rx));
+        report->transactions++;
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (rx[0] & ADXL345_INT_DATA_READY) {
+            break;
+        }
+        if (esp_timer_get_time() > deadline) {
+            ESP_LOGE(__func__, "No sample from device 0x%X", dev->i2c_address);
+            return ESP_ERR_TIMEOUT;
+        }
+        adxl345_wait_us(poll_us);
+    }
+
+    report->sample.x = (int16_t)(rx[2] | (rx[3] << 8));
+    report->sample.y = (int16_t)(rx[4] | (rx[5] << 8));
+    report->sample.z = (int16_t)(rx[6] | (rx[7] << 8));
+    report->first_sample_us = (uint32_t)(esp_timer_get_time() - report->start_us);
+    report->boot_to_sample_us = report->start_us + report->first_sample_us;
+
+    return ESP_OK;
+}
@@ -0,0 +1,59 @@
+/**
+ * Cold start in as few transactions as possible, for nodes that wake up often.
+ * The whole configuration comes in up front and goes out in a couple of burst
+ * writes: no readbacks in between, no logging. Right after power-up only the
+ * registers that differ from their reset values are sent. Optionally the first
+ * sample is waited for, and the report says how long it took from boot.
+ *
+ * adxl345_begin() takes six transactions (chip ID, a resync of two reads, three
+ * writes); adxl345_begin_fast() with the defaults takes two, the chip ID read and
+ * one 5 byte write, plus one read per poll for the first sample.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+typedef struct {
+    adxl345_config_t regs;      ///< everything the sensor should run with, POWER_CTL measure bit included
+    bool check_id;              ///< read DEVID first, one more transaction
+    bool from_reset;            ///< sensor just powered up: registers at their reset value are not written
+    bool wait_sample;           ///< wait for the first sample and read it, for the report
+} adxl345_boot_config_t;
+
+/* What adxl345_begin() sets up: 100 Hz, FULL_RES, AUTO_SLEEP with 1 Hz wake-up, measuring */
+#define ADXL345_BOOT_CONFIG_DEFAULT() {         \
+    .regs = {                                   \
+        .bw_rate = ADXL345_DATARATE_100_HZ,     \
+        .power_ctl = 0x1B,                      \
+        .data_format = 0x08,                    \
+    },                                          \
+    .check_id = true,                           \
+    .from_reset = true,                         \
+    .wait_sample = true,                        \
+}
+
+/**
+ * @brief How the start went, esp_timer_get_time() time base (us since boot)
+ */
+typedef struct {
+    int64_t start_us;               ///< adxl345_begin_fast() entered
+    uint32_t config_us;             ///< ID check and register writes
+    uint32_t first_sample_us;       ///< entry to the first sample in hand, 0 without wait_sample
+    int64_t boot_to_sample_us;      ///< boot to the first sample, start_us + first_sample_us
+    uint8_t transactions;           ///< bus transactions, retries not counted
+    uint8_t bytes_written;          ///< register bytes written
+    adxl345_raw_xyz_t sample;       ///< the first sample
+} adxl345_boot_report_t;
+
+esp_err_t adxl345_begin_fast(adxl345_dev_t *dev, const adxl345_boot_config_t *config, adxl345_boot_report_t *report);
+
+#ifdef __cplusplus
+}
+#endif
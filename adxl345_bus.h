@@ -0,0 +1,69 @@
+/**
+ * Transport between the driver and the sensor. Every device handle talks through
+ * an adxl345_bus_t: a read and a write of consecutive registers. A burst (len > 1)
+ * is one transaction, the sensor auto-increments the register address.
+ *
+ * Backends:
+ *  - I2C through i2c_manager, what adxl345_create() uses when no bus is given. 400 kHz
+ *    tops out around 1.6 kHz of 6 byte samples, not enough for 3200 Hz streaming.
+ *  - 4-wire SPI through the ESP-IDF spi_master driver, up to 5 MHz (mode 3, multi-byte
+ *    bit for bursts). Plenty for 3200 Hz with room to spare.
+ *  - The host simulator has its own, see adxl345_sim_bus() in host/adxl345_sim.h.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "i2c_manager.h"
+
+#define ADXL345_SPI_MAX_HZ          5000000     ///< datasheet maximum SCLK
+#define ADXL345_SPI_READ            0x80        ///< first byte, R/W bit
+#define ADXL345_SPI_MULTI_BYTE      0x40        ///< first byte, MB bit: auto-increment for bursts
+#define ADXL345_SPI_FIFO_GAP_HZ     1600000     ///< above this SCLK the address byte no longer covers the FIFO gap
+#define ADXL345_FIFO_GAP_US         5           ///< datasheet: end of a data read to the next FIFO / FIFO_STATUS read
+
+/**
+ * @brief Transport functions. Return ESP_OK or an esp_err_t, never log in the
+ *        hot path, the driver does that.
+ */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint8_t reg, uint8_t *rx, size_t len);         ///< len registers from reg on
+    esp_err_t (*write)(void *ctx, uint8_t reg, const uint8_t *tx, size_t len);  ///< len registers from reg on
+    void (*del)(void *ctx);                                                     ///< free ctx, NULL when nothing to free
+    esp_err_t (*recover)(void *ctx);                                            ///< clear a stuck bus, NULL when there is nothing to do
+} adxl345_bus_ops_t;
+
+typedef struct {
+    const adxl345_bus_ops_t *ops;
+    void *ctx;                          ///< backend state, handed to every op
+    const char *name;                   ///< for logs and benchmarks, e.g. "i2c" or "spi"
+    uint16_t fifo_gap_us;               ///< wait after every FIFO pop, 0 when a transaction takes long enough by itself
+} adxl345_bus_t;
+
+/**
+ * @brief 4-wire SPI wiring, the bus itself (spi_bus_initialize()) is set up by the application
+ */
+typedef struct {
+    int host;                           ///< spi_host_device_t, e.g. SPI2_HOST
+    int cs_gpio;                        ///< chip select
+    uint32_t clock_hz;                  ///< SCLK, up to ADXL345_SPI_MAX_HZ
+} adxl345_bus_spi_config_t;
+
+#define ADXL345_BUS_SPI_CONFIG_DEFAULT() {  \
+    .host = 1,                              \
+    .cs_gpio = -1,                          \
+    .clock_hz = ADXL345_SPI_MAX_HZ,         \
+}
+
+esp_err_t adxl345_bus_i2c_create(i2c_port_t i2c_port, uint8_t i2c_address, adxl345_bus_t *out_bus);
+esp_err_t adxl345_bus_spi_create(const adxl345_bus_spi_config_t *config, adxl345_bus_t *out_bus);
+void adxl345_bus_delete(adxl345_bus_t *bus);
+
+#ifdef __cplusplus
+}
+#endif
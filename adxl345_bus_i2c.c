@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+#include "i2c_manager.h"
+
+#include "adxl345_bus.h"
+
+/* bus clear needs the pins, i2c_manager has them in menuconfig */
+#if defined(CONFIG_I2C_MANAGER_0_ENABLED) || defined(CONFIG_I2C_MANAGER_1_ENABLED)
+#define BUS_I2C_CAN_CLEAR   1
+#include "driver/i2c.h"
+#include "driver/gpio.h"
+#include "esp_rom_sys.h"
+#define BUS_I2C_HALF_CLOCK_US   5       // 100 kHz, slow enough for any slave
+#endif
+
+
+/* prototype static functions */
+
+static esp_err_t bus_i2c_read(void *ctx, uint8_t reg, uint8_t *rx, size_t len);
+static esp_err_t bus_i2c_write(void *ctx, uint8_t reg, const uint8_t *tx, size_t len);
+static void bus_i2c_del(void *ctx);
+static esp_err_t bus_i2c_recover(void *ctx);
+
+
+typedef struct {
+    i2c_port_t port;
+    uint8_t address;
+} bus_i2c_t;
+
+static const adxl345_bus_ops_t bus_i2c_ops = {
+    .read = bus_i2c_read,
+    .write = bus_i2c_write,
+    .del = bus_i2c_del,
+    .recover = bus_i2c_recover,
+};
+
+
+/**
+ * @brief I2C transport over i2c_manager, the port is set up in menuconfig
+ * @param i2c_port I2C_NUM_0 or I2C_NUM_1
+ * @param i2c_address ADXL345_ADDRESS_ALT_LOW or ADXL345_ADDRESS_ALT_HIGH
+ * @param out_bus the new transport, free with adxl345_bus_delete()
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ */
+esp_err_t adxl345_bus_i2c_create(i2c_port_t i2c_port, uint8_t i2c_address, adxl345_bus_t *out_bus)
+{
+    if (out_bus == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    bus_i2c_t *i2c = calloc(1, sizeof(bus_i2c_t));
+    if (i2c == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    i2c->port = i2c_port;
+    i2c->address = i2c_address;
+
+    *out_bus = (adxl345_bus_t) {
+        .ops = &bus_i2c_ops,
+        .ctx = i2c,
+        .name = "i2c",
+        .fifo_gap_us = 0,               // START + address byte alone take longer than 5 us
+    };
+    return ESP_OK;
+}
+
+/**
+ * @brief Free the backend state of a transport
+ * @param bus from one of the adxl345_bus_*_create() functions, NULL is ignored
+ */
+void adxl345_bus_delete(adxl345_bus_t *bus)
+{
+    if (bus == NULL || bus->ops == NULL) {
+        return;
+    }
+    if (bus->ops->del != NULL) {
+        bus->ops->del(bus->ctx);
+    }
+    bus->ops = NULL;
+    bus->ctx = NULL;
+}
+
+static esp_err_t bus_i2c_read(void *ctx, uint8_t reg, uint8_t *rx, size_t len)
+{
+    bus_i2c_t *i2c = ctx;
+
+    return i2c_manager_read(i2c->port, i2c->address, reg, rx, len);
+}
+
+static esp_err_t bus_i2c_write(void *ctx, uint8_t reg, const uint8_t *tx, size_t len)
+{
+    bus_i2c_t *i2c = ctx;
+
+    return i2c_manager_write(i2c->port, i2c->address, reg, tx, len);
+}
+
+static void bus_i2c_del(void *ctx)
+{
+    free(ctx);
+}
+
+/**
+ * @brief Bus clear (I2C spec 3.1.16): a slave that lost clocks in the middle of a read
+ *        (brownout, glitch) holds SDA low and blocks the bus for everybody. Take the
+ *        pins from the controller, clock SCL until SDA is released (9 pulses at most),
+ *        send a STOP and hand the pins back. All of it under the i2c_manager port lock,
+ *        so no other driver on the port is in the middle of a transaction meanwhile.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE when SDA stays low, ESP_ERR_TIMEOUT when the
+ *         port lock can't be had, or ESP_ERR_NOT_SUPPORTED when the port is not set up
+ *         through i2c_manager
+ */
+static esp_err_t bus_i2c_recover(void *ctx)
+{
+#ifdef BUS_I2C_CAN_CLEAR
+    bus_i2c_t *i2c = ctx;
+    gpio_num_t sda;
+    gpio_num_t scl;
+    bool pullup;
+
+    switch (i2c->port) {
+#ifdef CONFIG_I2C_MANAGER_0_ENABLED
+    case I2C_NUM_0:
+        sda = CONFIG_I2C_MANAGER_0_SDA;
+        scl = CONFIG_I2C_MANAGER_0_SCL;
+#ifdef CONFIG_I2C_MANAGER_0_PULLUPS
+        pullup = true;
+#else
+        pullup = false;
+#endif
+        break;
+#endif
+#ifdef CONFIG_I2C_MANAGER_1_ENABLED
+    case I2C_NUM_1:
+        sda = CONFIG_I2C_MANAGER_1_SDA;
+        scl = CONFIG_I2C_MANAGER_1_SCL;
+#ifdef CONFIG_I2C_MANAGER_1_PULLUPS
+        pullup = true;
+#else
+        pullup = false;
+#endif
+        break;
+#endif
+    default:
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    if (i2c_manager_lock(i2c->port) != ESP_OK) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    gpio_set_level(sda, 1);
+    gpio_set_level(scl, 1);
+    gpio_set_direction(sda, GPIO_MODE_INPUT_OUTPUT_OD);
+    gpio_set_direction(scl, GPIO_MODE_INPUT_OUTPUT_OD);
+    esp_rom_delay_us(BUS_I2C_HALF_CLOCK_US);
+
+    for (int i = 0; i < 9 && gpio_get_level(sda) == 0; i++) {
+        gpio_set_level(scl, 0);
+        esp_rom_delay_us(BUS_I2C_HALF_CLOCK_US);
+        gpio_set_level(scl, 1);
+        esp_rom_delay_us(BUS_I2C_HALF_CLOCK_US);
+    }
+
+    // STOP: SDA low to high while SCL is high
+    gpio_set_level(scl, 0);
+    esp_rom_delay_us(BUS_I2C_HALF_CLOCK_US);
+    gpio_set_level(sda, 0);
+    esp_rom_delay_us(BUS_I2C_HALF_CLOCK_US);
+    gpio_set_level(scl, 1);
+    esp_rom_delay_us(BUS_I2C_HALF_CLOCK_US);
+    gpio_set_level(sda, 1);
+    esp_rom_delay_us(BUS_I2C_HALF_CLOCK_US);
+
+    bool released = gpio_get_level(sda) == 1;
+
+    i2c_reset_tx_fifo(i2c->port);
+    i2c_reset_rx_fifo(i2c->port);
+    esp_err_t err = i2c_set_pin(i2c->port, sda, scl, pullup, pullup, I2C_MODE_MASTER);
+
+    i2c_manager_unlock(i2c->port);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return released ? ESP_OK : ESP_ERR_INVALID_STATE;
+#else
+    (void)ctx;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
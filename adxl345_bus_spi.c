@@ -0,0 +1,121 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "driver/spi_master.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345_bus.h"
+
+/**
+ * 4-wire SPI transport. The first byte is the address phase of the transaction:
+ * R/W (D7), MB (D6) and the register (D5-D0), then len data bytes. SPI mode 3.
+ * DATA_FORMAT SPI (D6) has to stay 0 (4-wire), which is the power-on value.
+ * Transfers up to 4 bytes go through the transaction's own tx/rx_data, no buffer
+ * requirements then; longer ones (FIFO drains) use the caller's buffer.
+ */
+
+#define BUS_SPI_INLINE_MAX  4
+
+
+/* prototype static functions */
+
+static esp_err_t bus_spi_read(void *ctx, uint8_t reg, uint8_t *rx, size_t len);
+static esp_err_t bus_spi_write(void *ctx, uint8_t reg, const uint8_t *tx, size_t len);
+static void bus_spi_del(void *ctx);
+
+
+static const adxl345_bus_ops_t bus_spi_ops = {
+    .read = bus_spi_read,
+    .write = bus_spi_write,
+    .del = bus_spi_del,
+    .recover = NULL,                    // CS framing restarts every transaction, nothing can hang
+};
+
+
+/**
+ * @brief SPI transport: adds the sensor to an initialized SPI bus
+ * @param config host, CS pin and clock
+ * @param out_bus the new transport, free with adxl345_bus_delete()
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or the spi_bus_add_device() error
+ */
+esp_err_t adxl345_bus_spi_create(const adxl345_bus_spi_config_t *config, adxl345_bus_t *out_bus)
+{
+    esp_err_t err;
+    spi_device_handle_t spi;
+
+    if (config == NULL || out_bus == NULL || config->clock_hz == 0 || config->clock_hz > ADXL345_SPI_MAX_HZ) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    spi_device_interface_config_t dev_config = {
+        .command_bits = 0,
+        .address_bits = 8,
+        .dummy_bits = 0,
+        .mode = 3,                                  // CPOL = 1, CPHA = 1
+        .clock_speed_hz = (int)config->clock_hz,
+        .spics_io_num = config->cs_gpio,
+        .queue_size = 1,
+    };
+
+    err = spi_bus_add_device((spi_host_device_t)config->host, &dev_config, &spi);
+    if (err != ESP_OK) {
+        ESP_LOGE(__func__, "Adding the sensor to SPI host %d failed, error: %d", config->host, err);
+        return err;
+    }
+
+    *out_bus = (adxl345_bus_t) {
+        .ops = &bus_spi_ops,
+        .ctx = spi,
+        .name = "spi",
+        // at <= 1.6 MHz the 8 bit address phase of the next read is 5 us already
+        .fifo_gap_us = config->clock_hz > ADXL345_SPI_FIFO_GAP_HZ ? ADXL345_FIFO_GAP_US : 0,
+    };
+    return ESP_OK;
+}
+
+static esp_err_t bus_spi_read(void *ctx, uint8_t reg, uint8_t *rx, size_t len)
+{
+    esp_err_t err;
+    spi_transaction_t t = {
+        .addr = ADXL345_SPI_READ | (len > 1 ? ADXL345_SPI_MULTI_BYTE : 0) | (reg & 0x3F),
+        .length = 8 * len,
+        .rxlength = 8 * len,
+    };
+
+    if (len <= BUS_SPI_INLINE_MAX) {
+        t.flags = SPI_TRANS_USE_RXDATA;
+    } else {
+        t.rx_buffer = rx;
+    }
+
+    err = spi_device_polling_transmit((spi_device_handle_t)ctx, &t);
+    if (err == ESP_OK && len <= BUS_SPI_INLINE_MAX) {
+        memcpy(rx, t.rx_data, len);
+    }
+
+    return err;
+}
+
+static esp_err_t bus_spi_write(void *ctx, uint8_t reg, const uint8_t *tx, size_t len)
+{
+    spi_transaction_t t = {
+        .addr = (len > 1 ? ADXL345_SPI_MULTI_BYTE : 0) | (reg & 0x3F),
+        .length = 8 * len,
+    };
+
+    if (len <= BUS_SPI_INLINE_MAX) {
+        t.flags = SPI_TRANS_USE_TXDATA;
+        memcpy(t.tx_data, tx, len);
+    } else {
+        t.tx_buffer = tx;
+    }
+
+    return spi_device_polling_transmit((spi_device_handle_t)ctx, &t);
+}
+
+static void bus_spi_del(void *ctx)
+{
+    spi_bus_remove_device((spi_device_handle_t)ctx);
+}
@@ -0,0 +1,277 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_calib.h"
+#include "adxl345_stream.h"
+#include "adxl345_priv.h"
+
+
+#define CALIB_LSB_PER_G         256     // FULL_RES, 3.9 mg/LSB in every range
+#define CALIB_LSB_PER_OFS       4       // one OFSx step is 15.6 mg = 4 LSB
+#define CALIB_EMPTY_READS_MAX   3       // empty FIFO reads in a row before giving up
+#define CALIB_MAX_ERROR_LSB     (CALIB_LSB_PER_G / 2)   // 0 g offsets are +-150 / 250 mg worst case, more is not an offset
+
+
+/* prototype static functions */
+
+static int32_t div_round(int32_t num, int32_t den);
+
+
+/* +1 g in LSB per orientation, x, y, z */
+static const int16_t calib_gravity[][3] = {
+    [ADXL345_CALIB_Z_UP] = { 0, 0, CALIB_LSB_PER_G },
+    [ADXL345_CALIB_Z_DOWN] = { 0, 0, -CALIB_LSB_PER_G },
+    [ADXL345_CALIB_X_UP] = { CALIB_LSB_PER_G, 0, 0 },
+    [ADXL345_CALIB_X_DOWN] = { -CALIB_LSB_PER_G, 0, 0 },
+    [ADXL345_CALIB_Y_UP] = { 0, CALIB_LSB_PER_G, 0 },
+    [ADXL345_CALIB_Y_DOWN] = { 0, -CALIB_LSB_PER_G, 0 },
+};
+
+
+/**
+ * @brief Rounded to nearest, halves away from zero
+ */
+static int32_t div_round(int32_t num, int32_t den)
+{
+    return (num >= 0 ? num + den / 2 : num - den / 2) / den;
+}
+
+/**
+ * @brief Mean of the next samples out of the FIFO, in LSB at the current data format.
+ *        The sensor has to be measuring with the FIFO in stream mode. What the FIFO
+ *        holds on entry is dropped, then discard more samples to let a new setting settle.
+ *        Shared with the self-test.
+ * @param samples number to average
+ * @param discard fresh samples skipped before averaging
+ * @param avg per axis mean, rounded
+ * @return ESP_OK, ESP_ERR_TIMEOUT when no samples arrive, or the bus error
+ */
+esp_err_t adxl345_fifo_average(adxl345_dev_t *dev, uint16_t samples, uint8_t discard, adxl345_xyz_i32_t *avg)
+{
+    adxl345_raw_xyz_t batch[ADXL345_FIFO_SIZE];
+    uint32_t period_us = (uint32_t)(adxl345_get_sample_period_ns(dev) / 1000) + 1;
+    int32_t sum[3] = { 0 };
+    uint32_t got = 0;
+    uint32_t skip = discard;
+    uint8_t empty = 0;
+    size_t count;
+    esp_err_t err;
+
+    if (samples == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ADXL345_LOCK(dev);
+    err = adxl345_read_fifo(dev, batch, ADXL345_FIFO_SIZE, &count);     // stale samples
+
+    while (err == ESP_OK && got < samples) {
+        uint32_t wanted = samples - got + skip;
+
+        // leave the FIFO some room, stream mode would drop the oldest
+        adxl345_wait_us((wanted < ADXL345_FIFO_SIZE - 2 ? wanted : ADXL345_FIFO_SIZE - 2) * period_us);
+
+        err = adxl345_read_fifo(dev, batch, ADXL345_FIFO_SIZE, &count);
+        if (err != ESP_OK) {
+            break;
+        }
+        if (count == 0 && ++empty >= CALIB_EMPTY_READS_MAX) {
+            ESP_LOGE(__func__, "No samples, is the sensor measuring?");
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (count > 0) {
+            empty = 0;
+        }
+
+        for (size_t i = 0; i < count && got < samples; i++) {
+            if (skip > 0) {
+                skip--;
+                continue;
+            }
+            sum[0] += batch[i].x;
+            sum[1] += batch[i].y;
+            sum[2] += batch[i].z;
+            got++;
+        }
+    }
+    ADXL345_UNLOCK(dev);
+
+    if (err == ESP_OK) {
+        avg->x = div_round(sum[0], samples);
+        avg->y = div_round(sum[1], samples);
+        avg->z = div_round(sum[2], samples);
+    }
+    return err;
+}
+
+/**
+ * @brief Calibrate the offsets. Keep the board still in config->orientation.
+ *        The offsets are zeroed, a batch is averaged at FULL_RES / 16 g / data_rate
+ *        from the FIFO, and the trims are written together with the configuration
+ *        from before, which is restored also when the run fails.
+ *        The sensor is locked for the whole run (~samples / rate).
+ * @param config orientation, rate and batch size, NULL for ADXL345_CALIB_CONFIG_DEFAULT()
+ * @param calib the new trims, to save with adxl345_calib_export()
+ * @param offset_mg offset that was measured before trimming, may be NULL
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_STATE when an axis is off by more
+ *         than 0.5 g (wrong orientation, board moved), ESP_ERR_TIMEOUT or the bus error
+ */
+esp_err_t adxl345_calib_run(adxl345_dev_t *dev, const adxl345_calib_config_t *config,
+                            adxl345_calib_t *calib, adxl345_xyz_i32_t *offset_mg)
+{
+    adxl345_calib_config_t cfg = ADXL345_CALIB_CONFIG_DEFAULT();
+    adxl345_config_t saved;
+    adxl345_config_t measure;
+    adxl345_xyz_i32_t avg;
+    int32_t error[3];
+    int32_t trim[3];
+    esp_err_t err;
+
+    if (config != NULL) {
+        cfg = *config;
+    }
+    if (dev == NULL || calib == NULL || cfg.orientation > ADXL345_CALIB_Y_DOWN ||
+            cfg.samples == 0 || cfg.samples > 1024) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ADXL345_LOCK(dev);
+    adxl345_get_config(dev, &saved);
+
+    measure = saved;
+    measure.ofsx = 0;
+    measure.ofsy = 0;
+    measure.ofsz = 0;
+    measure.bw_rate = cfg.data_rate & 0x0F;                             // normal power, less noise
+    measure.power_ctl = 0x08;                                           // measuring, no sleep
+    measure.int_enable = 0x00;                                          // keep the interrupt task out of the FIFO
+    measure.data_format = (saved.data_format & 0x60) | 0x08 | ADXL345_RANGE_16_G;   // keep SPI / INT_INVERT
+    measure.fifo_ctl = ADXL345_FIFO_STREAM << 6;
+
+    err = adxl345_apply_config(dev, &measure, false);
+    if (err == ESP_OK) {
+        err = adxl345_fifo_average(dev, cfg.samples, 2, &avg);
+    }
+
+    if (err == ESP_OK) {
+        error[0] = avg.x - calib_gravity[cfg.orientation][0];
+        error[1] = avg.y - calib_gravity[cfg.orientation][1];
+        error[2] = avg.z - calib_gravity[cfg.orientation][2];
+
+        for (int i = 0; i < 3; i++) {
+            trim[i] = -div_round(error[i], CALIB_LSB_PER_OFS);
+            if (error[i] > CALIB_MAX_ERROR_LSB || error[i] < -CALIB_MAX_ERROR_LSB) {
+                ESP_LOGE(__func__, "Offset of %ld LSB on axis %c, wrong orientation or moving?", (long)error[i], 'x' + i);
+                err = ESP_ERR_INVALID_STATE;
+            }
+        }
+    }
+
+    if (err == ESP_OK) {
+        saved.ofsx = (int8_t)trim[0];
+        saved.ofsy = (int8_t)trim[1];
+        saved.ofsz = (int8_t)trim[2];
+
+        *calib = (adxl345_calib_t) {
+            .ofsx = saved.ofsx,
+            .ofsy = saved.ofsy,
+            .ofsz = saved.ofsz,
+            .orientation = (uint8_t)cfg.orientation,
+        };
+        if (offset_mg != NULL) {
+            offset_mg->x = div_round(error[0] * 1000, CALIB_LSB_PER_G);
+            offset_mg->y = div_round(error[1] * 1000, CALIB_LSB_PER_G);
+            offset_mg->z = div_round(error[2] * 1000, CALIB_LSB_PER_G);
+        }
+    }
+
+    // back to where we were, with the new trims when there are any
+    esp_err_t restore = adxl345_apply_config(dev, &saved, true);
+    ADXL345_UNLOCK(dev);
+
+    if (err == ESP_OK) {
+        err = restore;
+        ESP_LOGI(__func__, "Offsets x: %d y: %d z: %d (15.6 mg/LSB)", calib->ofsx, calib->ofsy, calib->ofsz);
+    }
+    return err;
+}
+
+/**
+ * @brief Write trims, e.g. loaded from NVS at boot. One 3 byte write.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or the bus error
+ */
+esp_err_t adxl345_calib_set(adxl345_dev_t *dev, const adxl345_calib_t *calib)
+{
+    if (dev == NULL || calib == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const uint8_t ofs[] = { (uint8_t)calib->ofsx, (uint8_t)calib->ofsy, (uint8_t)calib->ofsz };
+
+    return adxl345_write_regs(dev, ADXL345_REG_OFSX, ofs, sizeof(ofs));
+}
+
+/**
+ * @brief Trims the sensor has, from the shadow copy
+ */
+void adxl345_calib_get(adxl345_dev_t *dev, adxl345_calib_t *calib)
+{
+    ADXL345_LOCK(dev);
+    calib->ofsx = (int8_t)ADXL345_SHADOW(dev, ADXL345_REG_OFSX);
+    calib->ofsy = (int8_t)ADXL345_SHADOW(dev, ADXL345_REG_OFSY);
+    calib->ofsz = (int8_t)ADXL345_SHADOW(dev, ADXL345_REG_OFSZ);
+    calib->orientation = ADXL345_CALIB_Z_UP;
+    ADXL345_UNLOCK(dev);
+}
+
+/**
+ * @brief Trims as a blob for NVS or a file, see ADXL345_CALIB_BLOB_LEN for the layout
+ */
+void adxl345_calib_export(const adxl345_calib_t *calib, uint8_t blob[ADXL345_CALIB_BLOB_LEN])
+{
+    blob[0] = ADXL345_CALIB_BLOB_MAGIC;
+    blob[1] = ADXL345_CALIB_BLOB_VERSION;
+    blob[2] = (uint8_t)calib->ofsx;
+    blob[3] = (uint8_t)calib->ofsy;
+    blob[4] = (uint8_t)calib->ofsz;
+    blob[5] = calib->orientation;
+
+    uint16_t crc = adxl345_stream_crc16(blob, ADXL345_CALIB_BLOB_LEN - 2);
+
+    blob[6] = (uint8_t)crc;
+    blob[7] = (uint8_t)(crc >> 8);
+}
+
+/**
+ * @brief Trims from a blob written by adxl345_calib_export(), apply with adxl345_calib_set()
+ * @param len blob size as stored
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_INVALID_SIZE, ESP_ERR_INVALID_VERSION
+ *         or ESP_ERR_INVALID_CRC
+ */
+esp_err_t adxl345_calib_import(const uint8_t *blob, size_t len, adxl345_calib_t *calib)
+{
+    if (blob == NULL || calib == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (len != ADXL345_CALIB_BLOB_LEN || blob[0] != ADXL345_CALIB_BLOB_MAGIC) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (blob[1] != ADXL345_CALIB_BLOB_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (adxl345_stream_crc16(blob, ADXL345_CALIB_BLOB_LEN - 2) != (uint16_t)(blob[6] | (blob[7] << 8))) {
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    *calib = (adxl345_calib_t) {
+        .ofsx = (int8_t)blob[2],
+        .ofsy = (int8_t)blob[3],
+        .ofsz = (int8_t)blob[4],
+        .orientation = blob[5],
+    };
+    return ESP_OK;
+}
@@ -0,0 +1,69 @@
+/**
+ * Offset calibration in the sensor itself. With the board held still in a known
+ * orientation a FIFO averaged batch is taken, the difference to the ideal 0 g / 1 g
+ * goes into OFSX/OFSY/OFSZ (15.6 mg/LSB) and the sensor subtracts it from every
+ * sample from then on: no correction per sample on the MCU.
+ * The trims come out as an 8 byte blob to keep in NVS and load again at boot,
+ * no need to calibrate every time.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_OFS_UMG_PER_LSB         15600   ///< OFSX/Y/Z, 15.6 mg, independent of range
+#define ADXL345_CALIB_BLOB_MAGIC        0xC5
+#define ADXL345_CALIB_BLOB_VERSION      1
+#define ADXL345_CALIB_BLOB_LEN          8       ///< magic, version, OFSX, OFSY, OFSZ, orientation, CRC-16 LE
+
+/**
+ * @brief Which axis points up (sees +1 g) while calibrating
+ */
+typedef enum {
+    ADXL345_CALIB_Z_UP = 0,         ///< lying flat, component side up
+    ADXL345_CALIB_Z_DOWN,
+    ADXL345_CALIB_X_UP,
+    ADXL345_CALIB_X_DOWN,
+    ADXL345_CALIB_Y_UP,
+    ADXL345_CALIB_Y_DOWN,
+} adxl345_calib_orientation_t;
+
+typedef struct {
+    adxl345_calib_orientation_t orientation;
+    adxl345_datarate_t data_rate;   ///< rate while averaging, low rates have less noise
+    uint16_t samples;               ///< averaged per axis, 1..1024
+} adxl345_calib_config_t;
+
+/* 64 samples at 100 Hz: ~0.7 s, noise averaged to well below one 15.6 mg step */
+#define ADXL345_CALIB_CONFIG_DEFAULT() {        \
+    .orientation = ADXL345_CALIB_Z_UP,          \
+    .data_rate = ADXL345_DATARATE_100_HZ,       \
+    .samples = 64,                              \
+}
+
+/**
+ * @brief Offset trims as written to the sensor
+ */
+typedef struct {
+    int8_t ofsx;                    ///< OFSX, 15.6 mg/LSB
+    int8_t ofsy;                    ///< OFSY, 15.6 mg/LSB
+    int8_t ofsz;                    ///< OFSZ, 15.6 mg/LSB
+    uint8_t orientation;            ///< adxl345_calib_orientation_t they were taken in, informational
+} adxl345_calib_t;
+
+esp_err_t adxl345_calib_run(adxl345_dev_t *dev, const adxl345_calib_config_t *config,
+                            adxl345_calib_t *calib, adxl345_xyz_i32_t *offset_mg);
+esp_err_t adxl345_calib_set(adxl345_dev_t *dev, const adxl345_calib_t *calib);
+void adxl345_calib_get(adxl345_dev_t *dev, adxl345_calib_t *calib);
+void adxl345_calib_export(const adxl345_calib_t *calib, uint8_t blob[ADXL345_CALIB_BLOB_LEN]);
+esp_err_t adxl345_calib_import(const uint8_t *blob, size_t len, adxl345_calib_t *calib);
+
+#ifdef __cplusplus
+}
+#endif
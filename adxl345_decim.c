@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_decim.h"
+
+#define DECIM_AXES          3
+#define DECIM_DESIGN_STEPS  256         // integration steps of the FIR design
+#define DECIM_PASS_EDGE     0.4f        // FIR cutoff is this / D of the CIC output rate, 80% of the final Nyquist
+#define DECIM_MAX_COMP      8.0f        // cap on the droop compensation
+
+
+typedef struct {
+    uint64_t integ[ADXL345_DECIM_MAX_CIC_ORDER];    // integrators, wrap around
+    uint64_t comb[ADXL345_DECIM_MAX_CIC_ORDER];     // previous input of every comb
+    int32_t line[2 * ADXL345_DECIM_MAX_TAPS];       // FIR delay line, Q16.16, doubled so the taps never wrap
+} decim_axis_t;
+
+struct adxl345_decim_t {
+    uint16_t cic_ratio;
+    uint8_t cic_order;
+    uint8_t fir_ratio;
+    uint8_t taps;
+    uint64_t cic_gain;                              // R^N
+    uint16_t cic_phase;                             // inputs since the last CIC output
+    uint8_t fir_phase;                              // CIC outputs since the last FIR output
+    uint8_t line_pos;                               // newest sample in line[line_pos] and line[line_pos + taps]
+    int32_t coef[ADXL345_DECIM_MAX_TAPS];           // Q15, may exceed 1.0 for the compensator
+    decim_axis_t axis[DECIM_AXES];
+};
+
+
+/* prototype static functions */
+
+static void adxl345_decim_design(adxl345_decim_t *decim);
+static int32_t adxl345_decim_cic(adxl345_decim_t *decim, decim_axis_t *ax, int16_t x, bool dump);
+static int32_t adxl345_decim_fir(adxl345_decim_t *decim, decim_axis_t *ax);
+static int16_t adxl345_decim_round(int32_t q16);
+static int32_t adxl345_decim_sat32(int64_t v);
+
+
+/**
+ * @brief Allocate a decimator
+ * @param config ratios, order and FIR taps
+ * @param out_decim the new decimator
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ */
+esp_err_t adxl345_decim_create(const adxl345_decim_config_t *config, adxl345_decim_t **out_decim)
+{
+    if (config == NULL || out_decim == NULL ||
+            config->cic_ratio == 0 || config->cic_ratio > ADXL345_DECIM_MAX_CIC_RATIO ||
+            config->cic_order == 0 || config->cic_order > ADXL345_DECIM_MAX_CIC_ORDER ||
+            config->fir_ratio == 0 || config->fir_ratio > ADXL345_DECIM_MAX_FIR_RATIO ||
+            config->fir_taps == 0 || config->fir_taps > ADXL345_DECIM_MAX_TAPS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    adxl345_decim_t *decim = calloc(1, sizeof(adxl345_decim_t));
+    if (decim == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    decim->cic_ratio = config->cic_ratio;
+    decim->cic_order = config->cic_order;
+    decim->fir_ratio = config->fir_ratio;
+    decim->taps = config->fir_taps;
+
+    decim->cic_gain = 1;
+    for (uint8_t i = 0; i < decim->cic_order; i++) {
+        decim->cic_gain *= decim->cic_ratio;            // 256^5 = 2^40, fits
+    }
+
+    if (config->fir_coef != NULL) {
+        for (uint8_t i = 0; i < decim->taps; i++) {
+            decim->coef[i] = config->fir_coef[i];
+        }
+    } else {
+        adxl345_decim_design(decim);
+    }
+
+    *out_decim = decim;
+    return ESP_OK;
+}
+
+/**
+ * @brief Free a decimator
+ * @param decim NULL is ignored
+ */
+void adxl345_decim_destroy(adxl345_decim_t *decim)
+{
+    free(decim);
+}
+
+/**
+ * @brief Clear the state, e.g. after a gap in the input or an ODR change
+ */
+void adxl345_decim_reset(adxl345_decim_t *decim)
+{
+    memset(decim->axis, 0, sizeof(decim->axis));
+    decim->cic_phase = 0;
+    decim->fir_phase = 0;
+    decim->line_pos = 0;
+}
+
+/**
+ * @brief Total decimation ratio R * D, output rate = input rate / ratio
+ */
+uint32_t adxl345_decim_ratio(adxl345_decim_t *decim)
+{
+    return (uint32_t)decim->cic_ratio * decim->fir_ratio;
+}
+
+/**
+ * @brief Feed a batch of samples, e.g. a FIFO drain, and collect the decimated output.
+ *        Batches do not have to line up with the ratio, the phase carries over.
+ * @param in samples at the input rate, oldest first
+ * @param count number of input samples
+ * @param out decimated samples, counts at the input scale
+ * @param max_out size of out, at least count / ratio + 1
+ * @param out_count number of samples written to out
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_SIZE when out may be too small
+ */
+esp_err_t adxl345_decim_process(adxl345_decim_t *decim, const adxl345_raw_xyz_t *in, size_t count,
+                                adxl345_raw_xyz_t *out, size_t max_out, size_t *out_count)
+{
+    size_t n = 0;
+
+    if (decim == NULL || (in == NULL && count > 0) || out == NULL || out_count == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (max_out < count / adxl345_decim_ratio(decim) + 1) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        bool dump = ++decim->cic_phase == decim->cic_ratio;
+        int32_t q16[DECIM_AXES];
+
+        q16[0] = adxl345_decim_cic(decim, &decim->axis[0], in[i].x, dump);
+        q16[1] = adxl345_decim_cic(decim, &decim->axis[1], in[i].y, dump);
+        q16[2] = adxl345_decim_cic(decim, &decim->axis[2], in[i].z, dump);
+
+        if (!dump) {
+            continue;
+        }
+        decim->cic_phase = 0;
+
+        // push the CIC output into the FIR delay lines, newest first
+        decim->line_pos = decim->line_pos == 0 ? decim->taps - 1 : decim->line_pos - 1;
+        for (int a = 0; a < DECIM_AXES; a++) {
+            decim->axis[a].line[decim->line_pos] = q16[a];
+            decim->axis[a].line[decim->line_pos + decim->taps] = q16[a];
+        }
+
+        // polyphase: only the outputs that are kept get computed
+        if (++decim->fir_phase < decim->fir_ratio) {
+            continue;
+        }
+        decim->fir_phase = 0;
+
+        out[n].x = adxl345_decim_round(adxl345_decim_fir(decim, &decim->axis[0]));
+        out[n].y = adxl345_decim_round(adxl345_decim_fir(decim, &decim->axis[1]));
+        out[n].z = adxl345_decim_round(adxl345_decim_fir(decim, &decim->axis[2]));
+        n++;
+    }
+
+    *out_count = n;
+    return ESP_OK;
+}
+
+/**
+ * @brief One input sample through the integrators, and through the combs when
+ *        dump is set. Unsigned arithmetic so the wrap is defined.
+ * @return the CIC output normalised to the input scale, Q16.16, only valid when dump is set
+ */
+static int32_t IRAM_ATTR adxl345_decim_cic(adxl345_decim_t *decim, decim_axis_t *ax, int16_t x, bool dump)
+{
+    uint64_t v = (uint64_t)(int64_t)x;
+
+    for (uint8_t k = 0; k < decim->cic_order; k++) {
+        ax->integ[k] += v;
+        v = ax->integ[k];
+    }
+
+    if (!dump) {
+        return 0;
+    }
+
+    for (uint8_t k = 0; k < decim->cic_order; k++) {
+        uint64_t prev = ax->comb[k];
+
+        ax->comb[k] = v;
+        v -= prev;
+    }
+
+    // v = sum * R^N, |sum| < 2^15, split so the Q16 scaling never overflows
+    int64_t s = (int64_t)v;
+    int64_t g = (int64_t)decim->cic_gain;
+    int64_t q = s / g;
+    int64_t r = s % g;
+
+    return (int32_t)(q * 65536 + (r * 65536) / g);
+}
+
+/**
+ * @brief FIR output for the current delay line, Q16.16
+ */
+static int32_t IRAM_ATTR adxl345_decim_fir(adxl345_decim_t *decim, decim_axis_t *ax)
+{
+    const int32_t *x = &ax->line[decim->line_pos];
+    int64_t acc = 0;
+
+    for (uint8_t k = 0; k < decim->taps; k++) {
+        acc += (int64_t)decim->coef[k] * x[k];
+    }
+
+    // the overshoot of a full scale step goes past Q16.16, clamp instead of wrapping
+    return adxl345_decim_sat32((acc + (1 << 14)) >> 15);
+}
+
+/**
+ * @brief Design the FIR at the CIC output rate: low pass at DECIM_PASS_EDGE / D with the
+ *        inverse of the CIC droop in the passband, Blackman window, Q15 with a DC gain
+ *        of exactly 1. Float at create time only, the taps may differ in the last bit
+ *        between host and target; pass fir_coef when that matters.
+ */
+static void adxl345_decim_design(adxl345_decim_t *decim)
+{
+    const float fc = DECIM_PASS_EDGE / decim->fir_ratio;
+    const float center = (decim->taps - 1) / 2.0f;
+    const float df = fc / DECIM_DESIGN_STEPS;
+    float h[ADXL345_DECIM_MAX_TAPS];
+    int32_t sum = 0;
+
+    for (uint8_t n = 0; n < decim->taps; n++) {
+        float acc = 0.0f;
+
+        // h[n] = 2 * integral 0..fc of comp(f) * cos(2 pi f (n - center)) df, midpoint rule
+        for (int i = 0; i < DECIM_DESIGN_STEPS; i++) {
+            float f = (i + 0.5f) * df;
+            float comp = 1.0f;
+
+            if (decim->cic_ratio > 1) {
+                float droop = sinf((float)M_PI * f) / (decim->cic_ratio * sinf((float)M_PI * f / decim->cic_ratio));
+
+                comp = powf(droop, -(float)decim->cic_order);
+                if (comp > DECIM_MAX_COMP) {
+                    comp = DECIM_MAX_COMP;
+                }
+            }
+            acc += comp * cosf(2.0f * (float)M_PI * f * (n - center));
+        }
+
+        float w = decim->taps > 1 ? 0.42f - 0.5f * cosf(2.0f * (float)M_PI * n / (decim->taps - 1))
+                  + 0.08f * cosf(4.0f * (float)M_PI * n / (decim->taps - 1)) : 1.0f;
+        h[n] = 2.0f * acc * df * w;
+    }
+
+    float total = 0.0f;
+    for (uint8_t n = 0; n < decim->taps; n++) {
+        total += h[n];
+    }
+
+    for (uint8_t n = 0; n < decim->taps; n++) {
+        decim->coef[n] = (int32_t)lrintf(h[n] / total * 32768.0f);
+        sum += decim->coef[n];
+    }
+
+    // rounding leftovers go to the center tap, DC gain is exactly 1.0
+    decim->coef[decim->taps / 2] += 32768 - sum;
+}
+
+/**
+ * @brief Q16.16 to counts, rounded and saturated
+ */
+static int16_t adxl345_decim_round(int32_t q16)
+{
+    int32_t v = (int32_t)(((int64_t)q16 + 32768) >> 16);
+
+    if (v > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+/**
+ * @brief Clamp to the Q16.16 range
+ */
+static int32_t IRAM_ATTR adxl345_decim_sat32(int64_t v)
+{
+    if (v > INT32_MAX) {
+        return INT32_MAX;
+    }
+    if (v < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (int32_t)v;
+}
@@ -0,0 +1,56 @@
+/**
+ * Streaming decimation for high ODR batches, e.g. 3200 Hz down to 100 Hz.
+ * A CIC decimator (ratio R, order N) does the bulk of the rate reduction without
+ * a single multiply, a polyphase FIR (ratio D) then flattens the CIC passband droop
+ * and removes what would alias at the final rate. Total ratio is R * D.
+ *
+ * Fixed point per axis: the CIC registers are 64 bit and wrap on purpose (that is
+ * how a CIC works, the comb stage cancels the wrap), the FIR runs on Q16.16 with
+ * Q15 taps. Output samples are counts at the input scale, so the adxl345_convert_*
+ * functions work on them.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_DECIM_MAX_CIC_RATIO     256
+#define ADXL345_DECIM_MAX_CIC_ORDER     5
+#define ADXL345_DECIM_MAX_FIR_RATIO     8
+#define ADXL345_DECIM_MAX_TAPS          64
+
+typedef struct adxl345_decim_t adxl345_decim_t;
+
+typedef struct {
+    uint16_t cic_ratio;         ///< R, 1 skips the CIC
+    uint8_t cic_order;          ///< N, 1..5, more is steeper and droops more
+    uint8_t fir_ratio;          ///< D, 1..8
+    uint8_t fir_taps;           ///< FIR length, up to ADXL345_DECIM_MAX_TAPS
+    const int16_t *fir_coef;    ///< Q15 taps, NULL designs a CIC compensating low pass at create
+} adxl345_decim_config_t;
+
+/* 3200 Hz in, 200 Hz out */
+#define ADXL345_DECIM_CONFIG_DEFAULT() {    \
+    .cic_ratio = 8,                         \
+    .cic_order = 4,                         \
+    .fir_ratio = 2,                         \
+    .fir_taps = 32,                         \
+    .fir_coef = NULL,                       \
+}
+
+esp_err_t adxl345_decim_create(const adxl345_decim_config_t *config, adxl345_decim_t **out_decim);
+void adxl345_decim_destroy(adxl345_decim_t *decim);
+void adxl345_decim_reset(adxl345_decim_t *decim);
+uint32_t adxl345_decim_ratio(adxl345_decim_t *decim);
+esp_err_t adxl345_decim_process(adxl345_decim_t *decim, const adxl345_raw_xyz_t *in, size_t count,
+                                adxl345_raw_xyz_t *out, size_t max_out, size_t *out_count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,250 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_intr.h"
+#include "adxl345_events.h"
+#include "adxl345_priv.h"
+
+
+/* prototype static functions */
+
+static uint8_t to_lsb(uint32_t value, uint32_t per_lsb);
+static void adxl345_events_intr_cb(adxl345_dev_t *dev, uint8_t int_source, int64_t timestamp_us, void *arg);
+
+
+struct adxl345_events_ctx {
+    adxl345_event_cb_t callback;
+    void *arg;
+    adxl345_intr_cb_t intr_callback;    // non event sources, may be NULL
+    void *intr_arg;
+};
+
+/* delivery order, the time critical ones first */
+static const adxl345_int_t adxl345_event_order[] = {
+    ADXL345_INT_FREE_FALL, ADXL345_INT_ACTIVITY, ADXL345_INT_INACTIVITY,
+    ADXL345_INT_SINGLE_TAP, ADXL345_INT_DOUBLE_TAP,
+};
+
+
+/**
+ * @brief Unit value to register LSBs, rounded to nearest and clamped to the 8 bit register
+ */
+static uint8_t to_lsb(uint32_t value, uint32_t per_lsb)
+{
+    uint32_t lsb = (value + per_lsb / 2) / per_lsb;
+
+    return lsb > 255 ? 255 : (uint8_t)lsb;
+}
+
+/**
+ * @brief Write the tap, activity, inactivity and free-fall registers, route the
+ *        enabled events to INT1/INT2 and enable them. The other interrupt sources
+ *        and their mapping are left alone, and so are the rate, power mode and FIFO:
+ *        THRESH_TAP..TAP_AXES in one burst, then INT_MAP and INT_ENABLE, 3 writes.
+ * @param dev device handle
+ * @param config thresholds and times in physical units, see adxl345_events_config_t
+ * @return ESP_OK, ESP_ERR_INVALID_ARG for event bits outside ADXL345_EVENTS_MASK or
+ *         double tap with a zero window, or the bus error
+ */
+esp_err_t adxl345_events_configure(adxl345_dev_t *dev, const adxl345_events_config_t *config)
+{
+    if (dev == NULL || config == NULL || (config->events & ~ADXL345_EVENTS_MASK) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if ((config->events & ADXL345_INT_DOUBLE_TAP) && config->tap_window_ms == 0) {
+        ESP_LOGE(__func__, "Double tap needs a tap window");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t err;
+    adxl345_config_t regs;
+
+    ADXL345_LOCK(dev);                  // the offsets in the middle of the block come from the shadow
+    adxl345_get_config(dev, &regs);
+
+    regs.thresh_tap = to_lsb(config->tap_threshold_mg * 10u, ADXL345_THRESH_MG_PER_LSB_X10);
+    regs.dur = to_lsb(config->tap_duration_us, ADXL345_DUR_US_PER_LSB);
+    regs.latent = to_lsb(config->tap_latency_ms * 1000u, ADXL345_LATENT_US_PER_LSB);
+    regs.window = to_lsb(config->tap_window_ms * 1000u, ADXL345_LATENT_US_PER_LSB);
+    regs.tap_axes = (config->tap_suppress ? 0x08 : 0x00) | (config->tap_axes & ADXL345_AXIS_ALL);
+
+    regs.thresh_act = to_lsb(config->act_threshold_mg * 10u, ADXL345_THRESH_MG_PER_LSB_X10);
+    regs.thresh_inact = to_lsb(config->inact_threshold_mg * 10u, ADXL345_THRESH_MG_PER_LSB_X10);
+    regs.time_inact = config->inact_time_s;
+    regs.act_inact_ctl = (config->act_ac_coupled ? 0x80 : 0x00) | ((config->act_axes & ADXL345_AXIS_ALL) << 4) |
+                         (config->inact_ac_coupled ? 0x08 : 0x00) | (config->inact_axes & ADXL345_AXIS_ALL);
+
+    regs.thresh_ff = to_lsb(config->ff_threshold_mg * 10u, ADXL345_THRESH_MG_PER_LSB_X10);
+    regs.time_ff = to_lsb(config->ff_time_ms, ADXL345_TIME_FF_MS_PER_LSB);
+
+    const uint8_t block[] = {
+        regs.thresh_tap, (uint8_t)regs.ofsx, (uint8_t)regs.ofsy, (uint8_t)regs.ofsz,
+        regs.dur, regs.latent, regs.window, regs.thresh_act, regs.thresh_inact,
+        regs.time_inact, regs.act_inact_ctl, regs.thresh_ff, regs.time_ff, regs.tap_axes,
+    };
+
+    err = adxl345_write_regs(dev, ADXL345_REG_THRESH_TAP, block, sizeof(block));
+    if (err == ESP_OK) {
+        // map before enable, so an event never shows up on the old pin
+        err = adxl345_update_reg(dev, ADXL345_REG_INT_MAP, ADXL345_EVENTS_MASK, config->int2_map);
+    }
+    if (err == ESP_OK) {
+        err = adxl345_update_reg(dev, ADXL345_REG_INT_ENABLE, ADXL345_EVENTS_MASK, config->events);
+    }
+    ADXL345_UNLOCK(dev);
+
+    return err;
+}
+
+/**
+ * @brief Turn an INT_SOURCE value into events, one callback per event bit set.
+ *        Reads ACT_TAP_STATUS once for the source axes when an event bit is set.
+ *        Use it from your own adxl345_intr_cb_t when not using adxl345_events_start().
+ * @param int_source INT_SOURCE as handed to the interrupt callback
+ * @param timestamp_us ISR timestamp as handed to the interrupt callback
+ * @param callback called for free-fall, activity, inactivity, single and double tap, in that order
+ * @return ESP_OK or the bus error, the events are still delivered without axes then
+ */
+esp_err_t adxl345_events_decode(adxl345_dev_t *dev, uint8_t int_source, int64_t timestamp_us,
+                                adxl345_event_cb_t callback, void *arg)
+{
+    esp_err_t err = ESP_OK;
+    uint8_t status = 0;
+
+    if ((int_source & ADXL345_EVENTS_MASK) == 0) {
+        return ESP_OK;
+    }
+
+    err = adxl345_get_act_tap_status(dev, &status);
+    if (err != ESP_OK) {
+        status = 0;
+    }
+
+    for (size_t i = 0; i < sizeof(adxl345_event_order) / sizeof(adxl345_event_order[0]); i++) {
+        adxl345_int_t type = adxl345_event_order[i];
+        adxl345_event_t event = {
+            .type = type,
+            .axes = 0,
+            .asleep = (status & 0x08) != 0,
+            .timestamp_us = timestamp_us,
+        };
+
+        if ((int_source & type) == 0) {
+            continue;
+        }
+        if (type == ADXL345_INT_ACTIVITY) {
+            event.axes = (status >> 4) & ADXL345_AXIS_ALL;
+        } else if (type == ADXL345_INT_SINGLE_TAP || type == ADXL345_INT_DOUBLE_TAP) {
+            event.axes = status & ADXL345_AXIS_ALL;
+        }
+        callback(dev, &event, arg);
+    }
+
+    return err;
+}
+
+/**
+ * @brief Interrupt callback installed by adxl345_events_start()
+ */
+static void adxl345_events_intr_cb(adxl345_dev_t *dev, uint8_t int_source, int64_t timestamp_us, void *arg)
+{
+    struct adxl345_events_ctx *ctx = arg;
+    uint8_t others = int_source & ~ADXL345_EVENTS_MASK;
+    adxl345_intr_cb_t intr_callback = ctx->intr_callback;   // the event callback may stop the engine
+    void *intr_arg = ctx->intr_arg;
+
+    adxl345_events_decode(dev, int_source, timestamp_us, ctx->callback, ctx->arg);
+
+    if (others != 0 && intr_callback != NULL) {
+        intr_callback(dev, others, timestamp_us, intr_arg);
+    }
+}
+
+/**
+ * @brief Configure the events and start interrupt acquisition delivering them decoded.
+ *        Data ready / watermark / overrun can run alongside: enable them in intr_config
+ *        and they go to intr_config->callback as usual, without the event bits.
+ * @param dev device handle
+ * @param config events, thresholds and routing
+ * @param intr_config GPIOs, task and the non event sources, NULL for ADXL345_INTR_CONFIG_DEFAULT()
+ *        with only the events enabled and no GPIO (adxl345_intr_service() polling)
+ * @param callback event handler, called from the acquisition task
+ * @return ESP_OK, ESP_ERR_INVALID_STATE when already running, or the error of the failing step
+ */
+esp_err_t adxl345_events_start(adxl345_dev_t *dev, const adxl345_events_config_t *config,
+                               const adxl345_intr_config_t *intr_config, adxl345_event_cb_t callback, void *arg)
+{
+    esp_err_t err;
+    struct adxl345_events_ctx *ctx;
+    adxl345_intr_config_t intr = ADXL345_INTR_CONFIG_DEFAULT();
+
+    if (dev == NULL || config == NULL || callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dev->events != NULL) {
+        ESP_LOGE(__func__, "Event engine already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (intr_config != NULL) {
+        intr = *intr_config;
+    } else {
+        intr.int_enable = 0;
+        intr.callback = NULL;
+    }
+
+    ctx = calloc(1, sizeof(struct adxl345_events_ctx));
+    if (ctx == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    ctx->callback = callback;
+    ctx->arg = arg;
+    ctx->intr_callback = intr.callback;
+    ctx->intr_arg = intr.arg;
+
+    err = adxl345_events_configure(dev, config);
+    if (err != ESP_OK) {
+        free(ctx);
+        return err;
+    }
+
+    intr.int_enable = (intr.int_enable & ~ADXL345_EVENTS_MASK) | config->events;
+    intr.int2_map = (intr.int2_map & ~ADXL345_EVENTS_MASK) | (config->int2_map & ADXL345_EVENTS_MASK);
+    intr.callback = adxl345_events_intr_cb;
+    intr.arg = ctx;
+
+    dev->events = ctx;
+    err = adxl345_intr_start(dev, &intr);
+    if (err != ESP_OK) {
+        dev->events = NULL;
+        free(ctx);
+    }
+
+    return err;
+}
+
+/**
+ * @brief Stop interrupt acquisition and the event engine. The event registers keep their values.
+ * @param dev device handle
+ * @return ESP_OK, ESP_ERR_INVALID_STATE when not started, or the adxl345_intr_stop() error
+ */
+esp_err_t adxl345_events_stop(adxl345_dev_t *dev)
+{
+    struct adxl345_events_ctx *ctx = dev->events;
+
+    if (ctx == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = adxl345_intr_stop(dev);
+
+    dev->events = NULL;
+    free(ctx);
+
+    return err;
+}
@@ -0,0 +1,100 @@
+/**
+ * Tap, double tap, activity, inactivity and free-fall detection on the sensor itself.
+ * Thresholds and times go in as mg / us / ms / s and are converted to register LSBs,
+ * the events come back decoded, with the axis that caused them, from the interrupt
+ * acquisition task (adxl345_intr.h). The MCU can sleep until something happens.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "adxl345.h"
+#include "adxl345_intr.h"
+
+/* axis bits, same layout as TAP_AXES and the low nibbles of ACT_INACT_CTL */
+#define ADXL345_AXIS_X      0x04
+#define ADXL345_AXIS_Y      0x02
+#define ADXL345_AXIS_Z      0x01
+#define ADXL345_AXIS_ALL    (ADXL345_AXIS_X | ADXL345_AXIS_Y | ADXL345_AXIS_Z)
+
+#define ADXL345_EVENTS_MASK (ADXL345_INT_SINGLE_TAP | ADXL345_INT_DOUBLE_TAP | ADXL345_INT_ACTIVITY | \
+                             ADXL345_INT_INACTIVITY | ADXL345_INT_FREE_FALL)
+
+/* register LSB sizes from the datasheet */
+#define ADXL345_THRESH_MG_PER_LSB_X10   625     ///< THRESH_TAP/ACT/INACT/FF, 62.5 mg
+#define ADXL345_DUR_US_PER_LSB          625     ///< DUR
+#define ADXL345_LATENT_US_PER_LSB       1250    ///< LATENT and WINDOW
+#define ADXL345_TIME_FF_MS_PER_LSB      5       ///< TIME_FF
+
+typedef struct {
+    uint8_t events;                 ///< ADXL345_INT_SINGLE_TAP ... ADXL345_INT_FREE_FALL to enable
+    uint8_t int2_map;               ///< which of those go to INT2, the rest go to INT1
+
+    uint16_t tap_threshold_mg;      ///< acceleration a tap has to exceed, 62.5 mg steps, max 15937
+    uint32_t tap_duration_us;       ///< longest time above the threshold that still counts as a tap, 625 us steps, max 159375
+    uint16_t tap_latency_ms;        ///< wait after a tap before the double tap window opens, 1.25 ms steps, max 318
+    uint16_t tap_window_ms;         ///< time the second tap may start in, 1.25 ms steps, max 318, 0 disables double tap
+    uint8_t tap_axes;               ///< ADXL345_AXIS_* taking part in tap detection
+    bool tap_suppress;              ///< suppress double tap when the acceleration stays high between taps
+
+    uint16_t act_threshold_mg;      ///< activity threshold, 62.5 mg steps
+    uint8_t act_axes;               ///< ADXL345_AXIS_* taking part in activity detection
+    bool act_ac_coupled;            ///< compare against the acceleration at the start of activity instead of 0 g
+
+    uint16_t inact_threshold_mg;    ///< inactivity threshold, 62.5 mg steps
+    uint8_t inact_time_s;           ///< time below the threshold before inactivity, 1 s steps
+    uint8_t inact_axes;             ///< ADXL345_AXIS_* taking part in inactivity detection
+    bool inact_ac_coupled;          ///< compare against a reference taken at the start instead of 0 g
+
+    uint16_t ff_threshold_mg;       ///< all axes below this is free fall, 62.5 mg steps, 300..600 mg recommended
+    uint16_t ff_time_ms;            ///< time all axes have to stay below, 5 ms steps, 100..350 ms recommended
+} adxl345_events_config_t;
+
+/* Starting points from the datasheet and AN-1077, tune for the mechanics at hand */
+#define ADXL345_EVENTS_CONFIG_DEFAULT() {               \
+    .events = 0,                                        \
+    .int2_map = 0,                                      \
+    .tap_threshold_mg = 3000,                           \
+    .tap_duration_us = 10000,                           \
+    .tap_latency_ms = 20,                               \
+    .tap_window_ms = 200,                               \
+    .tap_axes = ADXL345_AXIS_ALL,                       \
+    .tap_suppress = false,                              \
+    .act_threshold_mg = 250,                            \
+    .act_axes = ADXL345_AXIS_ALL,                       \
+    .act_ac_coupled = true,                             \
+    .inact_threshold_mg = 190,                          \
+    .inact_time_s = 5,                                  \
+    .inact_axes = ADXL345_AXIS_ALL,                     \
+    .inact_ac_coupled = true,                           \
+    .ff_threshold_mg = 440,                             \
+    .ff_time_ms = 200,                                  \
+}
+
+/**
+ * @brief One detected event
+ */
+typedef struct {
+    adxl345_int_t type;             ///< one of ADXL345_INT_SINGLE_TAP ... ADXL345_INT_FREE_FALL
+    uint8_t axes;                   ///< ADXL345_AXIS_* that caused it, tap and activity only, 0 otherwise
+    bool asleep;                    ///< the sensor was in sleep mode (ACT_TAP_STATUS Asleep)
+    int64_t timestamp_us;           ///< ISR timestamp
+} adxl345_event_t;
+
+typedef void (*adxl345_event_cb_t)(adxl345_dev_t *dev, const adxl345_event_t *event, void *arg);
+
+esp_err_t adxl345_events_configure(adxl345_dev_t *dev, const adxl345_events_config_t *config);
+esp_err_t adxl345_events_decode(adxl345_dev_t *dev, uint8_t int_source, int64_t timestamp_us,
+                                adxl345_event_cb_t callback, void *arg);
+esp_err_t adxl345_events_start(adxl345_dev_t *dev, const adxl345_events_config_t *config,
+                               const adxl345_intr_config_t *intr_config, adxl345_event_cb_t callback, void *arg);
+esp_err_t adxl345_events_stop(adxl345_dev_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
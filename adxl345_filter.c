@@ -0,0 +1,304 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_filter.h"
+
+/**
+ * Butterworth sections by the bilinear transform with prewarping, rounded to Q2.30
+ * offline. b1 absorbs the rounding so the DC gain is exactly 1 (low pass) or
+ * exactly 0 (high pass).
+ */
+static const adxl345_biquad_coef_t adxl345_filter_table[4][ADXL345_FILTER_CUTOFF_MAX] = {
+    [ADXL345_FILTER_LOWPASS_1] = {
+        {  16606804,   16606804, 0, -1040528216, 0 },
+        {  32715568,   32715568, 0, -1008310688, 0 },
+        {  63555534,   63555535, 0,  -946630755, 0 },
+        { 146811362,  146811363, 0,  -780119099, 0 },
+        { 263321519,  263321519, 0,  -547098786, 0 },
+        { 451838913,  451838913, 0,  -170063998, 0 },
+    },
+    [ADXL345_FILTER_HIGHPASS_1] = {
+        { 1057135020, -1057135020, 0, -1040528216, 0 },
+        { 1041026256, -1041026256, 0, -1008310688, 0 },
+        { 1010186290, -1010186290, 0,  -946630755, 0 },
+        {  926930462,  -926930462, 0,  -780119099, 0 },
+        {  810420305,  -810420305, 0,  -547098786, 0 },
+        {  621902911,  -621902911, 0,  -170063998, 0 },
+    },
+    [ADXL345_FILTER_LOWPASS_2] = {
+        {    259157,    518315,    259157, -2099786147, 1027080952 },
+        {   1014355,   2028711,   1014355, -2052132225,  982447822 },
+        {   3888751,   7777501,   3888751, -1957103774,  898916953 },
+        {  21564350,  43128698,  21564350, -1676130396,  688645970 },
+        {  72429549, 144859097,  72429549, -1227265970,  443242341 },
+        { 221805086, 443610172, 221805086,  -396777000,  210255520 },
+    },
+    [ADXL345_FILTER_HIGHPASS_2] = {
+        { 1050152231, -2100304462, 1050152231, -2099786147, 1027080952 },
+        { 1027080468, -2054160936, 1027080468, -2052132225,  982447822 },
+        {  982440638, -1964881276,  982440638, -1957103774,  898916953 },
+        {  859629548, -1719259096,  859629548, -1676130396,  688645970 },
+        {  686062534, -1372125068,  686062534, -1227265970,  443242341 },
+        {  420193586,  -840387172,  420193586,  -396777000,  210255520 },
+    },
+};
+
+
+/* prototype static functions */
+
+static int32_t adxl345_filter_section(const adxl345_biquad_coef_t *c, adxl345_biquad_state_t *s, int32_t x);
+static int32_t adxl345_filter_dc(const adxl345_biquad_coef_t *c, int32_t x);
+static int16_t adxl345_filter_round(int32_t q16);
+static int32_t adxl345_filter_sat32(int64_t v);
+
+
+/**
+ * @brief Precomputed coefficients, no float involved so host and target get the same bits
+ * @param type low/high pass, first/second order
+ * @param cutoff cutoff as a fraction of the ODR
+ * @param out the section
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t adxl345_filter_coef(adxl345_filter_type_t type, adxl345_filter_cutoff_t cutoff, adxl345_biquad_coef_t *out)
+{
+    if (out == NULL || (unsigned)type > ADXL345_FILTER_HIGHPASS_2 || (unsigned)cutoff >= ADXL345_FILTER_CUTOFF_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *out = adxl345_filter_table[type][cutoff];
+    return ESP_OK;
+}
+
+/**
+ * @brief Design a section for any cutoff. Uses float once, at setup: the result
+ *        may differ in the last bit between host and target libm, use
+ *        adxl345_filter_coef() when that matters.
+ * @param type low/high pass, first/second order
+ * @param cutoff_hz -3dB frequency
+ * @param odr_hz sample rate
+ * @param out the section
+ * @return ESP_OK or ESP_ERR_INVALID_ARG when the cutoff is not below odr/2
+ */
+esp_err_t adxl345_filter_design(adxl345_filter_type_t type, float cutoff_hz, float odr_hz, adxl345_biquad_coef_t *out)
+{
+    float b0, b2 = 0.0f, a1, a2 = 0.0f;
+
+    if (out == NULL || (unsigned)type > ADXL345_FILTER_HIGHPASS_2 || !(cutoff_hz > 0.0f) || !(cutoff_hz < odr_hz / 2.0f)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    float k = tanf((float)M_PI * cutoff_hz / odr_hz);
+
+    if (type == ADXL345_FILTER_LOWPASS_1 || type == ADXL345_FILTER_HIGHPASS_1) {
+        a1 = (k - 1.0f) / (k + 1.0f);
+        b0 = (type == ADXL345_FILTER_LOWPASS_1) ? k / (k + 1.0f) : 1.0f / (k + 1.0f);
+    } else {
+        float n = 1.0f / (1.0f + (float)M_SQRT2 * k + k * k);
+
+        a1 = 2.0f * (k * k - 1.0f) * n;
+        a2 = (1.0f - (float)M_SQRT2 * k + k * k) * n;
+        b0 = (type == ADXL345_FILTER_LOWPASS_2) ? k * k * n : n;
+        b2 = b0;
+    }
+
+    out->b0 = (int32_t)lrintf(b0 * ADXL345_FILTER_COEF_ONE);
+    out->b2 = (int32_t)lrintf(b2 * ADXL345_FILTER_COEF_ONE);
+    out->a1 = (int32_t)lrintf(a1 * ADXL345_FILTER_COEF_ONE);
+    out->a2 = (int32_t)lrintf(a2 * ADXL345_FILTER_COEF_ONE);
+
+    // b1 = +-2*b0 (+-b0 first order), derived like the table so the rounding error ends up there and the DC gain is exact
+    if (type == ADXL345_FILTER_LOWPASS_1 || type == ADXL345_FILTER_LOWPASS_2) {
+        out->b1 = ADXL345_FILTER_COEF_ONE + out->a1 + out->a2 - out->b0 - out->b2;
+    } else {
+        out->b1 = -(out->b0 + out->b2);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Exponential moving average y += alpha * (x - y) as a first order section
+ * @param alpha_q15 smoothing factor, 0..32768 is 0.0..1.0, bigger is clamped
+ * @param out the section
+ */
+void adxl345_filter_ema(uint16_t alpha_q15, adxl345_biquad_coef_t *out)
+{
+    if (alpha_q15 > 32768) {
+        alpha_q15 = 32768;
+    }
+
+    out->b0 = (int32_t)alpha_q15 << 15;
+    out->b1 = 0;
+    out->b2 = 0;
+    out->a1 = out->b0 - ADXL345_FILTER_COEF_ONE;
+    out->a2 = 0;
+}
+
+/**
+ * @brief Set up a filter bank and clear its state
+ * @param filter bank to set up
+ * @param channels number of channels, 3 for x, y, z
+ * @param sections cascade of sections, run in this order
+ * @param count number of sections
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t adxl345_filter_init(adxl345_filter_t *filter, uint8_t channels, const adxl345_biquad_coef_t *sections, uint8_t count)
+{
+    if (filter == NULL || sections == NULL || channels == 0 || channels > ADXL345_FILTER_MAX_CHANNELS ||
+            count == 0 || count > ADXL345_FILTER_MAX_SECTIONS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    memset(filter, 0, sizeof(adxl345_filter_t));
+    memcpy(filter->coef, sections, count * sizeof(adxl345_biquad_coef_t));
+    filter->channels = channels;
+    filter->sections = count;
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Reset the state
+ * @param initial one value per channel to start settled on, as if that input had
+ *        been there forever. NULL starts from 0.
+ */
+void adxl345_filter_reset(adxl345_filter_t *filter, const int16_t *initial)
+{
+    memset(filter->state, 0, sizeof(filter->state));
+
+    if (initial == NULL) {
+        return;
+    }
+
+    for (uint8_t ch = 0; ch < filter->channels; ch++) {
+        int32_t x = ADXL345_FILTER_Q16(initial[ch]);
+
+        for (uint8_t s = 0; s < filter->sections; s++) {
+            adxl345_biquad_state_t *st = &filter->state[ch][s];
+            int32_t y = adxl345_filter_dc(&filter->coef[s], x);
+
+            st->x1 = st->x2 = x;
+            st->y1 = st->y2 = y;
+            x = y;
+        }
+    }
+}
+
+/**
+ * @brief Run one frame through the bank
+ * @param in one value per channel, raw counts
+ * @param out_q16 one value per channel, Q16.16 counts
+ */
+void IRAM_ATTR adxl345_filter_process(adxl345_filter_t *filter, const int16_t *in, int32_t *out_q16)
+{
+    for (uint8_t ch = 0; ch < filter->channels; ch++) {
+        int32_t x = ADXL345_FILTER_Q16(in[ch]);
+
+        for (uint8_t s = 0; s < filter->sections; s++) {
+            x = adxl345_filter_section(&filter->coef[s], &filter->state[ch][s], x);
+        }
+        out_q16[ch] = x;
+    }
+}
+
+/**
+ * @brief Filter a block of samples, e.g. a FIFO drain. The bank needs 3 channels.
+ * @param in samples, oldest first
+ * @param count number of samples
+ * @param out filtered samples rounded to counts, may be the same array as in
+ */
+void adxl345_filter_process_xyz(adxl345_filter_t *filter, const adxl345_raw_xyz_t *in, size_t count, adxl345_raw_xyz_t *out)
+{
+    for (size_t i = 0; i < count; i++) {
+        int16_t frame[3] = { in[i].x, in[i].y, in[i].z };
+        int32_t q16[3];
+
+        adxl345_filter_process(filter, frame, q16);
+        out[i].x = adxl345_filter_round(q16[0]);
+        out[i].y = adxl345_filter_round(q16[1]);
+        out[i].z = adxl345_filter_round(q16[2]);
+    }
+}
+
+/**
+ * @brief One direct form I step. Q2.30 * Q16.16 products summed in 64 bit, then
+ *        rounded back to Q16.16 and saturated: Q16.16 ends at +-32768 counts, a high
+ *        pass or Butterworth overshoot on a full scale (or left-justified) input
+ *        goes past it and would otherwise wrap and flip the sign of the state.
+ *        The shift of a negative value is arithmetic on GCC for both Xtensa/RISC-V
+ *        and the host, so the result is bit-exact.
+ */
+static int32_t IRAM_ATTR adxl345_filter_section(const adxl345_biquad_coef_t *c, adxl345_biquad_state_t *s, int32_t x)
+{
+    int64_t acc = (int64_t)c->b0 * x + (int64_t)c->b1 * s->x1 - (int64_t)c->a1 * s->y1;
+
+    if (c->b2 != 0 || c->a2 != 0) {
+        acc += (int64_t)c->b2 * s->x2 - (int64_t)c->a2 * s->y2;
+    }
+
+    int32_t y = adxl345_filter_sat32((acc + (1LL << 29)) >> 30);
+
+    s->x2 = s->x1;
+    s->x1 = x;
+    s->y2 = s->y1;
+    s->y1 = y;
+
+    return y;
+}
+
+/**
+ * @brief Steady state output of a section for a constant input
+ */
+static int32_t adxl345_filter_dc(const adxl345_biquad_coef_t *c, int32_t x)
+{
+    int64_t num = (int64_t)c->b0 + c->b1 + c->b2;
+    int64_t den = (int64_t)ADXL345_FILTER_COEF_ONE + c->a1 + c->a2;
+
+    if (num == den) {
+        return x;
+    }
+    if (num == 0 || den == 0) {
+        return 0;
+    }
+    while (num > INT32_MAX || num < INT32_MIN) {
+        num /= 2;
+        den /= 2;
+    }
+    return adxl345_filter_sat32((int64_t)x * num / den);
+}
+
+/**
+ * @brief Q16.16 to counts, rounded and saturated
+ */
+static int16_t adxl345_filter_round(int32_t q16)
+{
+    int32_t v = (int32_t)(((int64_t)q16 + 32768) >> 16);
+
+    if (v > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+/**
+ * @brief Clamp to the Q16.16 range
+ */
+static int32_t IRAM_ATTR adxl345_filter_sat32(int64_t v)
+{
+    if (v > INT32_MAX) {
+        return INT32_MAX;
+    }
+    if (v < INT32_MIN) {
+        return INT32_MIN;
+    }
+    return (int32_t)v;
+}
@@ -0,0 +1,81 @@
+/**
+ * Fixed-point filter bank for the ADXL345 axes, integer only so the output is
+ * bit-exact between host and target and there is no soft-float on the ESP32-C3.
+ *
+ * Every channel (axis) runs the same cascade of first or second order sections
+ * in direct form I:
+ *      y[n] = b0*x[n] + b1*x[n-1] + b2*x[n-2] - a1*y[n-1] - a2*y[n-2]
+ * Coefficients are Q2.30 (|c| < 2), the state and the output are Q16.16 counts
+ * so the fractional part of the filter state is never thrown away, the
+ * accumulator is 64 bit.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_FILTER_MAX_CHANNELS     3
+#define ADXL345_FILTER_MAX_SECTIONS     4
+#define ADXL345_FILTER_COEF_ONE         (1L << 30)      ///< 1.0 in Q2.30
+#define ADXL345_FILTER_Q16(counts)      ((int32_t)(counts) * 65536)
+
+typedef enum {
+    ADXL345_FILTER_LOWPASS_1 = 0,       ///< first order low pass
+    ADXL345_FILTER_HIGHPASS_1,          ///< first order high pass
+    ADXL345_FILTER_LOWPASS_2,           ///< second order Butterworth low pass
+    ADXL345_FILTER_HIGHPASS_2,          ///< second order Butterworth high pass
+} adxl345_filter_type_t;
+
+/**
+ * @brief Cutoff as a fraction of the output data rate, for the precomputed coefficients
+ */
+typedef enum {
+    ADXL345_FILTER_CUTOFF_ODR_DIV_200 = 0,  ///< fc = ODR / 200
+    ADXL345_FILTER_CUTOFF_ODR_DIV_100,      ///< fc = ODR / 100
+    ADXL345_FILTER_CUTOFF_ODR_DIV_50,       ///< fc = ODR / 50
+    ADXL345_FILTER_CUTOFF_ODR_DIV_20,       ///< fc = ODR / 20
+    ADXL345_FILTER_CUTOFF_ODR_DIV_10,       ///< fc = ODR / 10
+    ADXL345_FILTER_CUTOFF_ODR_DIV_5,        ///< fc = ODR / 5
+    ADXL345_FILTER_CUTOFF_MAX,
+} adxl345_filter_cutoff_t;
+
+/**
+ * @brief One section, Q2.30. A first order section has b2 = a2 = 0.
+ */
+typedef struct {
+    int32_t b0, b1, b2;
+    int32_t a1, a2;
+} adxl345_biquad_coef_t;
+
+typedef struct {
+    int32_t x1, x2;                     ///< past inputs, Q16.16
+    int32_t y1, y2;                     ///< past outputs, Q16.16
+} adxl345_biquad_state_t;
+
+/**
+ * @brief Filter bank, plain struct so it can live in a device handle or on the stack
+ */
+typedef struct {
+    adxl345_biquad_coef_t coef[ADXL345_FILTER_MAX_SECTIONS];
+    adxl345_biquad_state_t state[ADXL345_FILTER_MAX_CHANNELS][ADXL345_FILTER_MAX_SECTIONS];
+    uint8_t sections;
+    uint8_t channels;
+} adxl345_filter_t;
+
+esp_err_t adxl345_filter_coef(adxl345_filter_type_t type, adxl345_filter_cutoff_t cutoff, adxl345_biquad_coef_t *out);
+esp_err_t adxl345_filter_design(adxl345_filter_type_t type, float cutoff_hz, float odr_hz, adxl345_biquad_coef_t *out);
+void adxl345_filter_ema(uint16_t alpha_q15, adxl345_biquad_coef_t *out);
+esp_err_t adxl345_filter_init(adxl345_filter_t *filter, uint8_t channels, const adxl345_biquad_coef_t *sections, uint8_t count);
+void adxl345_filter_reset(adxl345_filter_t *filter, const int16_t *initial);
+void adxl345_filter_process(adxl345_filter_t *filter, const int16_t *in, int32_t *out_q16);
+void adxl345_filter_process_xyz(adxl345_filter_t *filter, const adxl345_raw_xyz_t *in, size_t count, adxl345_raw_xyz_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,308 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_intr.h"
+#include "adxl345_priv.h"
+
+
+/* prototype static functions */
+
+static void IRAM_ATTR adxl345_intr_isr(void *arg);
+static void adxl345_intr_task(void *vParm);
+static esp_err_t gpio_shim_attach(int gpio_num, adxl345_intr_handler_t handler, void *arg);
+static esp_err_t gpio_shim_detach(int gpio_num);
+static void gpio_shim_enable(int gpio_num);
+static void gpio_shim_disable(int gpio_num);
+
+
+typedef struct {
+    struct adxl345_intr_ctx *ctx;
+    int gpio_num;
+    bool attached;
+} intr_line_t;
+
+struct adxl345_intr_ctx {
+    adxl345_dev_t *dev;
+    intr_line_t line[2];                // INT1, INT2
+    const adxl345_intr_shim_t *shim;
+    adxl345_intr_cb_t callback;
+    void *arg;
+    TaskHandle_t task;
+    SemaphoreHandle_t stopped;          // given by the task on its way out
+    volatile bool stopping;             // set by adxl345_intr_stop(), the task exits on its own
+    bool self_stop;                     // stopped from the callback, the task frees the context
+    volatile int64_t isr_time_us;       // when the ISR woke the task
+};
+
+
+const adxl345_intr_shim_t adxl345_intr_gpio_shim = {
+    .attach = gpio_shim_attach,
+    .detach = gpio_shim_detach,
+    .enable = gpio_shim_enable,
+    .disable = gpio_shim_disable,
+};
+
+
+/**
+ * @brief Map and enable the sensor interrupts, attach the ISR(s) and start the acquisition task
+ * @param dev device handle
+ * @param config see adxl345_intr_config_t
+ * @return ESP_OK, ESP_ERR_INVALID_STATE when already running, or the error of the failing step
+ */
+esp_err_t adxl345_intr_start(adxl345_dev_t *dev, const adxl345_intr_config_t *config)
+{
+    esp_err_t err;
+    struct adxl345_intr_ctx *ctx;
+
+    if (dev == NULL || config == NULL || config->callback == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dev->intr != NULL) {
+        ESP_LOGE(__func__, "Interrupt acquisition already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    ctx = calloc(1, sizeof(struct adxl345_intr_ctx));
+    if (ctx == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ctx->dev = dev;
+    ctx->shim = config->shim ? config->shim : &adxl345_intr_gpio_shim;
+    ctx->callback = config->callback;
+    ctx->arg = config->arg;
+    ctx->line[ADXL345_INT1] = (intr_line_t) { .ctx = ctx, .gpio_num = config->int1_gpio };
+    ctx->line[ADXL345_INT2] = (intr_line_t) { .ctx = ctx, .gpio_num = config->int2_gpio };
+    dev->intr = ctx;
+
+    ctx->stopped = xSemaphoreCreateBinary();
+    if (ctx->stopped == NULL) {
+        adxl345_intr_stop(dev);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // keep the sensor quiet while we wire things up
+    err = adxl345_set_int_enable(dev, 0);
+
+    if (err == ESP_OK) {
+        // 1 = INT2, 0 = INT1: the whole register in one write
+        err = adxl345_write_regs(dev, ADXL345_REG_INT_MAP, &config->int2_map, 1);
+    }
+    if (err != ESP_OK) {
+        adxl345_intr_stop(dev);
+        return err;
+    }
+
+    if (xTaskCreate(adxl345_intr_task, "adxl345_intr", config->task_stack, ctx,
+                    config->task_priority, &ctx->task) != pdPASS) {
+        ctx->task = NULL;
+        adxl345_intr_stop(dev);
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < 2; i++) {
+        intr_line_t *line = &ctx->line[i];
+
+        if (line->gpio_num == ADXL345_INTR_GPIO_UNUSED) {
+            continue;
+        }
+        err = ctx->shim->attach(line->gpio_num, adxl345_intr_isr, line);
+        if (err != ESP_OK) {
+            ESP_LOGE(__func__, "Attaching ISR to GPIO %d failed, error: %d", line->gpio_num, err);
+            adxl345_intr_stop(dev);
+            return err;
+        }
+        line->attached = true;
+    }
+
+    err = adxl345_set_int_enable(dev, config->int_enable);
+    if (err != ESP_OK) {
+        adxl345_intr_stop(dev);
+        return err;
+    }
+
+    // sources that were already pending won't give us an edge, so service once now
+    ctx->isr_time_us = esp_timer_get_time();
+    xTaskNotifyGive(ctx->task);
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Disable the sensor interrupts, detach the ISR(s) and stop the acquisition task.
+ *        The task finishes the callback it is in and exits on its own, so the device
+ *        lock is never left taken. Called from the callback the task exits once the
+ *        callback returns.
+ * @param dev device handle
+ * @return ESP_OK or the bus error from disabling the interrupts
+ */
+esp_err_t adxl345_intr_stop(adxl345_dev_t *dev)
+{
+    struct adxl345_intr_ctx *ctx = dev->intr;
+
+    if (ctx == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = adxl345_set_int_enable(dev, 0);
+
+    for (int i = 0; i < 2; i++) {
+        intr_line_t *line = &ctx->line[i];
+
+        if (line->attached) {
+            ctx->shim->detach(line->gpio_num);
+            line->attached = false;
+        }
+    }
+
+    dev->intr = NULL;
+
+    if (ctx->task != NULL && ctx->task == xTaskGetCurrentTaskHandle()) {
+        ctx->self_stop = true;          // in the callback, the task cleans up after it returns
+        ctx->stopping = true;
+        return err;
+    }
+
+    if (ctx->task != NULL) {
+        ctx->stopping = true;
+        xTaskNotifyGive(ctx->task);
+        xSemaphoreTake(ctx->stopped, portMAX_DELAY);
+    }
+
+    if (ctx->stopped != NULL) {
+        vSemaphoreDelete(ctx->stopped);
+    }
+    free(ctx);
+
+    return err;
+}
+
+/**
+ * @brief Read INT_SOURCE once, hand it to the callback and unmask the INT lines again.
+ *        Called by the acquisition task, a host test can call it directly.
+ * @param dev device handle
+ * @return ESP_OK, ESP_ERR_INVALID_STATE when not started, or the bus error
+ */
+esp_err_t adxl345_intr_service(adxl345_dev_t *dev)
+{
+    struct adxl345_intr_ctx *ctx = dev->intr;
+    uint8_t int_source = 0;
+
+    if (ctx == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    esp_err_t err = adxl345_get_int_source(dev, &int_source);
+
+    if (err == ESP_OK && int_source != 0) {
+        ctx->callback(dev, int_source, ctx->isr_time_us, ctx->arg);
+        if (dev->intr != ctx) {
+            return err;                 // stopped from the callback, the lines are detached
+        }
+    }
+
+    for (int i = 0; i < 2; i++) {
+        if (ctx->line[i].attached) {
+            ctx->shim->enable(ctx->line[i].gpio_num);
+        }
+    }
+
+    return err;
+}
+
+/**
+ * @brief The INT lines are level triggered, so mask the line until the task
+ *        has serviced the sensor and wake the task.
+ */
+static void IRAM_ATTR adxl345_intr_isr(void *arg)
+{
+    intr_line_t *line = (intr_line_t *)arg;
+    BaseType_t woken = pdFALSE;
+
+    line->ctx->isr_time_us = esp_timer_get_time();
+    line->ctx->shim->disable(line->gpio_num);
+    vTaskNotifyGiveFromISR(line->ctx->task, &woken);
+    portYIELD_FROM_ISR(woken);
+}
+
+static void adxl345_intr_task(void *vParm)
+{
+    struct adxl345_intr_ctx *ctx = (struct adxl345_intr_ctx *)vParm;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (ctx->stopping) {
+            break;
+        }
+        adxl345_intr_service(ctx->dev);
+        if (ctx->stopping) {
+            break;
+        }
+    }
+
+    if (ctx->self_stop) {
+        vSemaphoreDelete(ctx->stopped);
+        free(ctx);
+    } else {
+        xSemaphoreGive(ctx->stopped);   // ctx belongs to adxl345_intr_stop() from here on
+    }
+    vTaskDelete(NULL);
+}
+
+
+/* <=====================================================================================> */
+
+/*
+        ESP-IDF GPIO SHIM
+
+*/
+
+static esp_err_t gpio_shim_attach(int gpio_num, adxl345_intr_handler_t handler, void *arg)
+{
+    esp_err_t err;
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << gpio_num,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_HIGH_LEVEL,      // INT pins are active high, INT_INVERT = 0
+    };
+
+    err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {     // already installed is fine
+        return err;
+    }
+
+    return gpio_isr_handler_add(gpio_num, handler, arg);
+}
+
+static esp_err_t gpio_shim_detach(int gpio_num)
+{
+    return gpio_isr_handler_remove(gpio_num);
+}
+
+static void gpio_shim_enable(int gpio_num)
+{
+    gpio_intr_enable(gpio_num);
+}
+
+static void gpio_shim_disable(int gpio_num)
+{
+    gpio_intr_disable(gpio_num);
+}
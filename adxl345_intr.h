@@ -0,0 +1,75 @@
+/**
+ * Interrupt driven acquisition for the ADXL345.
+ * The INT1/INT2 lines fire a GPIO ISR, the ISR wakes an acquisition task with a
+ * task notification and the task reads INT_SOURCE once to dispatch the event.
+ * Every device handle gets its own acquisition task.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_INTR_GPIO_UNUSED (-1)   ///< INT line not wired
+
+/**
+ * @brief Handler called from interrupt context
+ */
+typedef void (*adxl345_intr_handler_t)(void *arg);
+
+/**
+ * @brief GPIO/ISR layer. The default shim uses the ESP-IDF GPIO driver,
+ *        a host test can provide its own and call the handler to inject interrupts.
+ */
+typedef struct {
+    esp_err_t (*attach)(int gpio_num, adxl345_intr_handler_t handler, void *arg);  ///< configure the pin as a high level interrupt and add the handler
+    esp_err_t (*detach)(int gpio_num);                                             ///< remove the handler
+    void (*enable)(int gpio_num);                                                  ///< unmask the pin interrupt, called from task context
+    void (*disable)(int gpio_num);                                                 ///< mask the pin interrupt, called from the ISR
+} adxl345_intr_shim_t;
+
+extern const adxl345_intr_shim_t adxl345_intr_gpio_shim;
+
+/**
+ * @brief Called from the acquisition task with the INT_SOURCE value and the
+ *        esp_timer_get_time() timestamp taken in the ISR.
+ *        The callback has to clear the sources it handles, reading the data/FIFO
+ *        clears DATA_READY, WATERMARK and OVERRUN. It may call adxl345_intr_stop().
+ */
+typedef void (*adxl345_intr_cb_t)(adxl345_dev_t *dev, uint8_t int_source, int64_t timestamp_us, void *arg);
+
+typedef struct {
+    int int1_gpio;                      ///< GPIO wired to INT1, ADXL345_INTR_GPIO_UNUSED when not connected
+    int int2_gpio;                      ///< GPIO wired to INT2, ADXL345_INTR_GPIO_UNUSED when not connected
+    uint8_t int_enable;                 ///< ADXL345_INT_* bits to enable
+    uint8_t int2_map;                   ///< ADXL345_INT_* bits routed to INT2, the others go to INT1
+    adxl345_intr_cb_t callback;         ///< event handler
+    void *arg;                          ///< passed to the callback
+    uint32_t task_stack;                ///< acquisition task stack size
+    uint32_t task_priority;             ///< acquisition task priority
+    const adxl345_intr_shim_t *shim;    ///< NULL selects adxl345_intr_gpio_shim
+} adxl345_intr_config_t;
+
+#define ADXL345_INTR_CONFIG_DEFAULT() {                                             \
+    .int1_gpio = ADXL345_INTR_GPIO_UNUSED,                                          \
+    .int2_gpio = ADXL345_INTR_GPIO_UNUSED,                                          \
+    .int_enable = ADXL345_INT_DATA_READY | ADXL345_INT_WATERMARK | ADXL345_INT_OVERRUN, \
+    .int2_map = 0,                                                                  \
+    .callback = NULL,                                                               \
+    .arg = NULL,                                                                    \
+    .task_stack = 4096,                                                             \
+    .task_priority = 10,                                                            \
+    .shim = NULL,                                                                   \
+}
+
+esp_err_t adxl345_intr_start(adxl345_dev_t *dev, const adxl345_intr_config_t *config);
+esp_err_t adxl345_intr_stop(adxl345_dev_t *dev);
+esp_err_t adxl345_intr_service(adxl345_dev_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
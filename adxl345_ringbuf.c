@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_ringbuf.h"
+#include "adxl345_priv.h"
+
+/**
+ * head and tail run freely and wrap at 2^32, the slot is (index & mask).
+ * Only the producer stores head and dropped, only the consumer stores tail, so
+ * plain atomic loads/stores are enough and no read-modify-write instructions are
+ * needed (the ESP32-C3 has none).
+ */
+struct adxl345_ringbuf_t {
+    _Atomic uint32_t head;          // next slot to write, producer owned
+    _Atomic uint32_t tail;          // next slot to read, consumer owned
+    _Atomic uint32_t dropped;       // samples that did not fit, producer owned
+    uint32_t mask;                  // depth - 1
+    adxl345_sample_t *buf;
+};
+
+
+/**
+ * @brief Allocate a ring buffer
+ * @param depth number of samples it can hold, rounded up to a power of 2
+ * @param out_rb the new ring buffer
+ * @return ESP_OK, ESP_ERR_INVALID_ARG (also for a depth whose buffer size does not
+ *         fit a size_t) or ESP_ERR_NO_MEM
+ */
+esp_err_t adxl345_ringbuf_create(size_t depth, adxl345_ringbuf_t **out_rb)
+{
+    uint32_t size = 1;
+
+    if (out_rb == NULL || depth == 0 || depth > 0x80000000UL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    while (size < depth) {
+        size <<= 1;
+    }
+
+    size_t bytes = (size_t)size * sizeof(adxl345_sample_t);
+
+    if (bytes / sizeof(adxl345_sample_t) != size) {
+        return ESP_ERR_INVALID_ARG;     // wrapped, a 32 bit size_t on target
+    }
+
+    adxl345_ringbuf_t *rb = calloc(1, sizeof(adxl345_ringbuf_t));
+    if (rb == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    rb->buf = malloc(bytes);
+    if (rb->buf == NULL) {
+        free(rb);
+        return ESP_ERR_NO_MEM;
+    }
+
+    rb->mask = size - 1;
+    atomic_init(&rb->head, 0);
+    atomic_init(&rb->tail, 0);
+    atomic_init(&rb->dropped, 0);
+
+    *out_rb = rb;
+    return ESP_OK;
+}
+
+/**
+ * @brief Free a ring buffer, producer and consumer must be done with it
+ * @param rb NULL is ignored
+ */
+void adxl345_ringbuf_destroy(adxl345_ringbuf_t *rb)
+{
+    if (rb != NULL) {
+        free(rb->buf);
+        free(rb);
+    }
+}
+
+/**
+ * @brief Producer side, copy samples in. What does not fit is dropped and counted.
+ * @param samples oldest first
+ * @param count number of samples
+ * @return number of samples stored
+ */
+size_t adxl345_ringbuf_push(adxl345_ringbuf_t *rb, const adxl345_sample_t *samples, size_t count)
+{
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    uint32_t space = (rb->mask + 1) - (head - tail);
+    size_t n = count < space ? count : space;
+
+    for (size_t i = 0; i < n; i++) {
+        rb->buf[(head + i) & rb->mask] = samples[i];
+    }
+
+    // publish the samples before the new head
+    atomic_store_explicit(&rb->head, head + (uint32_t)n, memory_order_release);
+
+    if (n < count) {
+        uint32_t dropped = atomic_load_explicit(&rb->dropped, memory_order_relaxed);
+        atomic_store_explicit(&rb->dropped, dropped + (uint32_t)(count - n), memory_order_relaxed);
+    }
+
+    return n;
+}
+
+/**
+ * @brief Consumer side, copy out up to max_samples, oldest first
+ * @param samples where to store them
+ * @param max_samples size of the samples array
+ * @return number of samples copied
+ */
+size_t adxl345_ringbuf_pop(adxl345_ringbuf_t *rb, adxl345_sample_t *samples, size_t max_samples)
+{
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+    uint32_t used = head - tail;
+    size_t n = max_samples < used ? max_samples : used;
+
+    for (size_t i = 0; i < n; i++) {
+        samples[i] = rb->buf[(tail + i) & rb->mask];
+    }
+
+    // hand the slots back only after we copied them out
+    atomic_store_explicit(&rb->tail, tail + (uint32_t)n, memory_order_release);
+
+    return n;
+}
+
+/**
+ * @brief Samples waiting, a snapshot, safe to call from either side
+ */
+size_t adxl345_ringbuf_count(adxl345_ringbuf_t *rb)
+{
+    uint32_t tail = atomic_load_explicit(&rb->tail, memory_order_acquire);
+    uint32_t head = atomic_load_explicit(&rb->head, memory_order_acquire);
+
+    return head - tail;
+}
+
+/**
+ * @brief Number of samples the buffer can hold
+ */
+size_t adxl345_ringbuf_depth(adxl345_ringbuf_t *rb)
+{
+    return (size_t)rb->mask + 1;
+}
+
+/**
+ * @brief Samples dropped because the buffer was full, since create
+ */
+uint32_t adxl345_ringbuf_dropped(adxl345_ringbuf_t *rb)
+{
+    return atomic_load_explicit(&rb->dropped, memory_order_relaxed);
+}
+
+/**
+ * @brief Producer helper for the acquisition task: drain the sensor FIFO and push
+ *        the samples with timestamps. The newest sample gets timestamp_us, the
+ *        older ones are spaced one sample period apart at the current data rate.
+ * @param dev device to read
+ * @param rb ring buffer to fill
+ * @param timestamp_us time of the newest sample, e.g. the ISR timestamp
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_ringbuf_fill(adxl345_dev_t *dev, adxl345_ringbuf_t *rb, int64_t timestamp_us)
+{
+    adxl345_raw_xyz_t raw[ADXL345_FIFO_SIZE + 1];
+    adxl345_sample_t samples[ADXL345_FIFO_SIZE + 1];
+    size_t count = 0;
+    int64_t period_ns = (int64_t)adxl345_get_sample_period_ns(dev);
+    esp_err_t err;
+
+    err = adxl345_read_fifo(dev, raw, ADXL345_FIFO_SIZE + 1, &count);
+
+    for (size_t i = 0; i < count; i++) {
+        samples[i].timestamp_us = timestamp_us - (int64_t)(count - 1 - i) * period_ns / 1000;
+        samples[i].x = raw[i].x;
+        samples[i].y = raw[i].y;
+        samples[i].z = raw[i].z;
+    }
+
+    size_t pushed = adxl345_ringbuf_push(rb, samples, count);
+    ADXL345_STATS_ADD(dev, samples_dropped, count - pushed);
+    (void)pushed;
+
+    return err;
+}
@@ -0,0 +1,30 @@
+/**
+ * Lock-free single-producer/single-consumer ring buffer of timestamped samples.
+ * The acquisition task pushes, one consumer task pops, neither takes a mutex.
+ * A full buffer drops the newest samples and counts them, the producer never waits.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+typedef struct adxl345_ringbuf_t adxl345_ringbuf_t;
+
+esp_err_t adxl345_ringbuf_create(size_t depth, adxl345_ringbuf_t **out_rb);
+void adxl345_ringbuf_destroy(adxl345_ringbuf_t *rb);
+size_t adxl345_ringbuf_push(adxl345_ringbuf_t *rb, const adxl345_sample_t *samples, size_t count);
+size_t adxl345_ringbuf_pop(adxl345_ringbuf_t *rb, adxl345_sample_t *samples, size_t max_samples);
+size_t adxl345_ringbuf_count(adxl345_ringbuf_t *rb);
+size_t adxl345_ringbuf_depth(adxl345_ringbuf_t *rb);
+uint32_t adxl345_ringbuf_dropped(adxl345_ringbuf_t *rb);
+esp_err_t adxl345_ringbuf_fill(adxl345_dev_t *dev, adxl345_ringbuf_t *rb, int64_t timestamp_us);
+
+#ifdef __cplusplus
+}
+#endif
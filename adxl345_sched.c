@@ -0,0 +1,364 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_sched.h"
+
+#define SCHED_MEAN_SHIFT    4           // running mean over ~16 samples, keeps gravity and tilt out
+#define SCHED_ENERGY_SHIFT  3           // mean square over ~8 samples
+#define SCHED_ENERGY_MAX    (1ULL << 52) // above 3 * (65536 counts)^2 in Q16, the thresholds saturate here
+
+
+struct adxl345_sched_t {
+    adxl345_dev_t *dev;
+    adxl345_sched_config_t config;
+    adxl345_sched_mode_t mode;
+    int64_t since_us;                   // start of the current accounting slice
+    int64_t loud_us;                    // ENERGY: last time the RMS was above exit_rms_mg
+    uint64_t time_us[ADXL345_SCHED_MODES];
+    uint64_t charge_uaus;               // uA*us
+    uint32_t switches;
+    bool primed;                        // ENERGY: mean holds a sample
+    int32_t mean[3];                    // running mean, counts Q16.16
+    int64_t energy;                     // mean square around the running mean, counts^2 Q16
+    float scale_ms2;                    // data format the thresholds were converted for
+    int32_t mg_q16;                     // mg per count, Q16.16
+    uint64_t enter_energy;              // enter_rms_mg as counts^2 Q16
+    uint64_t exit_energy;               // exit_rms_mg as counts^2 Q16
+    uint16_t rms_mg;
+};
+
+
+/* prototype static functions */
+
+static void adxl345_sched_account(adxl345_sched_t *sched, int64_t now_us);
+static esp_err_t adxl345_sched_apply(adxl345_sched_t *sched, adxl345_sched_mode_t mode);
+static void adxl345_sched_thresholds(adxl345_sched_t *sched);
+static uint32_t adxl345_sched_isqrt64(uint64_t v);
+
+
+/* Typical supply current at 2.5 V in uA per rate code, datasheet tables 7 and 8 */
+static const uint16_t adxl345_supply_ua[16] = {
+    23, 23, 23, 23, 34, 40, 45, 50, 60, 90, 140, 140, 140, 140, 90, 140,
+};
+static const uint16_t adxl345_supply_low_power_ua[16] = {
+    23, 23, 23, 23, 34, 40, 45, 34, 40, 45, 50, 60, 90, 140, 90, 140,
+};
+
+
+/**
+ * @brief Typical sensor supply current at a data rate
+ * @param rate data rate
+ * @param low_power BW_RATE LOW_POWER bit
+ * @return uA at 2.5 V
+ */
+uint16_t adxl345_sched_supply_ua(adxl345_datarate_t rate, bool low_power)
+{
+    return low_power ? adxl345_supply_low_power_ua[rate & 0x0F] : adxl345_supply_ua[rate & 0x0F];
+}
+
+/**
+ * @brief Allocate a scheduler, the sensor is not touched until adxl345_sched_start()
+ * @param dev device handle
+ * @param config policy and the settings of both modes
+ * @param out_sched the new scheduler
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ */
+esp_err_t adxl345_sched_create(adxl345_dev_t *dev, const adxl345_sched_config_t *config, adxl345_sched_t **out_sched)
+{
+    if (dev == NULL || config == NULL || out_sched == NULL ||
+            config->policy > ADXL345_SCHED_POLICY_ENERGY ||
+            (config->policy == ADXL345_SCHED_POLICY_ENERGY && config->exit_rms_mg > config->enter_rms_mg)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < ADXL345_SCHED_MODES; i++) {
+        if (config->mode[i].fifo_mode > ADXL345_FIFO_TRIGGER || config->mode[i].watermark > 31) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    adxl345_sched_t *sched = calloc(1, sizeof(adxl345_sched_t));
+    if (sched == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    sched->dev = dev;
+    sched->config = *config;
+    sched->mode = ADXL345_SCHED_IDLE;
+    adxl345_sched_thresholds(sched);
+
+    *out_sched = sched;
+    return ESP_OK;
+}
+
+/**
+ * @brief Free a scheduler, the sensor stays in its current mode
+ * @param sched NULL is ignored
+ */
+void adxl345_sched_destroy(adxl345_sched_t *sched)
+{
+    free(sched);
+}
+
+/**
+ * @brief Take over the power settings: auto sleep off (the scheduler decides now),
+ *        IDLE mode applied and the statistics restarted.
+ *        For the EVENTS policy configure and enable ACTIVITY / INACTIVITY first.
+ * @return ESP_OK or the bus error
+ */
+esp_err_t adxl345_sched_start(adxl345_sched_t *sched)
+{
+    esp_err_t err = adxl345_set_auto_sleep(sched->dev, false, ADXL345_WAKE_8HZ);
+
+    if (err == ESP_OK) {
+        err = adxl345_sched_apply(sched, ADXL345_SCHED_IDLE);
+    }
+
+    sched->mode = ADXL345_SCHED_IDLE;
+    sched->primed = false;
+    adxl345_sched_reset_stats(sched);
+
+    return err;
+}
+
+/**
+ * @brief Write BW_RATE and FIFO_CTL for a mode. The rate goes down before the FIFO
+ *        is bypassed (which empties it) and up after the FIFO is set up.
+ */
+static esp_err_t adxl345_sched_apply(adxl345_sched_t *sched, adxl345_sched_mode_t mode)
+{
+    const adxl345_sched_mode_config_t *m = &sched->config.mode[mode];
+    esp_err_t err = ESP_OK;
+
+    if (mode == ADXL345_SCHED_IDLE) {
+        err = adxl345_set_bw_rate(sched->dev, m->rate, m->low_power);
+    }
+    if (err == ESP_OK && m->fifo_mode != ADXL345_FIFO_BYPASS) {
+        err = adxl345_set_fifo_watermark(sched->dev, m->watermark);
+    }
+    if (err == ESP_OK) {
+        err = adxl345_set_fifo(sched->dev, m->fifo_mode);
+    }
+    if (err == ESP_OK && mode != ADXL345_SCHED_IDLE) {
+        err = adxl345_set_bw_rate(sched->dev, m->rate, m->low_power);
+    }
+
+    return err;
+}
+
+/**
+ * @brief The ENERGY thresholds as mean squares in counts^2 Q16 for the current data
+ *        format, so feeding compares integers. Float here only, at create and when
+ *        the data format changed.
+ */
+static void adxl345_sched_thresholds(adxl345_sched_t *sched)
+{
+    float mg_per_count = adxl345_get_scale_ms2(sched->dev) * (1000.0f / 9.80665f);
+    float enter = sched->config.enter_rms_mg / mg_per_count;
+    float exit = sched->config.exit_rms_mg / mg_per_count;
+    float enter_q16 = enter * enter * 65536.0f;
+    float exit_q16 = exit * exit * 65536.0f;
+
+    sched->scale_ms2 = adxl345_get_scale_ms2(sched->dev);
+    sched->mg_q16 = (int32_t)(mg_per_count * 65536.0f + 0.5f);
+    sched->enter_energy = enter_q16 >= (float)SCHED_ENERGY_MAX ? SCHED_ENERGY_MAX : (uint64_t)enter_q16;
+    sched->exit_energy = exit_q16 >= (float)SCHED_ENERGY_MAX ? SCHED_ENERGY_MAX : (uint64_t)exit_q16;
+}
+
+/**
+ * @brief Book the time since the last call on the current mode
+ */
+static void adxl345_sched_account(adxl345_sched_t *sched, int64_t now_us)
+{
+    const adxl345_sched_mode_config_t *m = &sched->config.mode[sched->mode];
+    uint64_t dt = now_us > sched->since_us ? (uint64_t)(now_us - sched->since_us) : 0;
+
+    sched->time_us[sched->mode] += dt;
+    sched->charge_uaus += dt * adxl345_sched_supply_ua(m->rate, m->low_power);
+    sched->since_us = now_us;
+}
+
+/**
+ * @brief Switch mode now, whatever the policy says. The policy switches back
+ *        on its next decision.
+ * @param mode ADXL345_SCHED_IDLE or ADXL345_SCHED_ACTIVE
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or the bus error, the mode is unchanged on error
+ */
+esp_err_t adxl345_sched_set_mode(adxl345_sched_t *sched, adxl345_sched_mode_t mode)
+{
+    if (mode >= ADXL345_SCHED_MODES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mode == sched->mode) {
+        return ESP_OK;
+    }
+
+    esp_err_t err = adxl345_sched_apply(sched, mode);
+    if (err != ESP_OK) {
+        ESP_LOGW(__func__, "Switching to %s failed, error: %d", mode == ADXL345_SCHED_IDLE ? "IDLE" : "ACTIVE", err);
+        return err;
+    }
+
+    int64_t now = esp_timer_get_time();
+
+    adxl345_sched_account(sched, now);
+    sched->mode = mode;
+    sched->switches++;
+    sched->loud_us = now;
+
+    if (sched->config.callback != NULL) {
+        sched->config.callback(sched->dev, mode, sched->config.arg);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Current mode
+ */
+adxl345_sched_mode_t adxl345_sched_get_mode(adxl345_sched_t *sched)
+{
+    return sched->mode;
+}
+
+/**
+ * @brief EVENTS policy: hand it the INT_SOURCE bits, from the interrupt callback
+ *        or the ADXL345_INT_ACTIVITY / INACTIVITY events of adxl345_events.h.
+ *        ACTIVITY wins when both are set.
+ * @param int_source ADXL345_INT_* bits
+ * @return ESP_OK or the adxl345_sched_set_mode() error, ignored for the ENERGY policy
+ */
+esp_err_t adxl345_sched_update(adxl345_sched_t *sched, uint8_t int_source)
+{
+    if (sched->config.policy != ADXL345_SCHED_POLICY_EVENTS) {
+        return ESP_OK;
+    }
+    if (int_source & ADXL345_INT_ACTIVITY) {
+        return adxl345_sched_set_mode(sched, ADXL345_SCHED_ACTIVE);
+    }
+    if (int_source & ADXL345_INT_INACTIVITY) {
+        return adxl345_sched_set_mode(sched, ADXL345_SCHED_IDLE);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief ENERGY policy: hand it every batch you read. Tracks the RMS of the
+ *        acceleration around a running mean (so gravity and a new orientation
+ *        don't count) and switches with hysteresis once per batch.
+ *        Integer only per sample, the targets without FPU (ESP32-C3) run it too.
+ * @param samples raw samples at the current data format
+ * @param count number of samples, 0 only re-checks the hold time
+ * @return ESP_OK or the adxl345_sched_set_mode() error, ignored for the EVENTS policy
+ */
+esp_err_t adxl345_sched_feed(adxl345_sched_t *sched, const adxl345_raw_xyz_t *samples, size_t count)
+{
+    const adxl345_sched_config_t *c = &sched->config;
+
+    if (c->policy != ADXL345_SCHED_POLICY_ENERGY) {
+        return ESP_OK;
+    }
+
+    if (adxl345_get_scale_ms2(sched->dev) != sched->scale_ms2) {
+        adxl345_sched_thresholds(sched);        // range / FULL_RES changed, once per batch is enough
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        const int32_t xyz[3] = { samples[i].x, samples[i].y, samples[i].z };
+        int64_t sq = 0;
+
+        if (!sched->primed) {
+            for (int a = 0; a < 3; a++) {
+                sched->mean[a] = xyz[a] * 65536;
+            }
+            sched->energy = 0;
+            sched->primed = true;
+        }
+        for (int a = 0; a < 3; a++) {
+            int64_t d = (int64_t)xyz[a] * 65536 - sched->mean[a];       // Q16, |d| < 2^32
+            int64_t d8 = (d + 128) >> 8;                                // Q8, the square is Q16
+
+            sched->mean[a] += (int32_t)(d >> SCHED_MEAN_SHIFT);
+            sq += d8 * d8;
+        }
+        sched->energy += (sq - sched->energy) >> SCHED_ENERGY_SHIFT;
+    }
+
+    // counts Q8 to mg, once per batch
+    uint64_t rms = ((uint64_t)adxl345_sched_isqrt64((uint64_t)sched->energy) * (uint32_t)sched->mg_q16 + (1 << 23)) >> 24;
+    int64_t now = esp_timer_get_time();
+
+    sched->rms_mg = rms > 65535 ? 65535 : (uint16_t)rms;
+    if ((uint64_t)sched->energy >= sched->exit_energy) {
+        sched->loud_us = now;
+    }
+
+    if (sched->mode == ADXL345_SCHED_IDLE && (uint64_t)sched->energy > sched->enter_energy) {
+        return adxl345_sched_set_mode(sched, ADXL345_SCHED_ACTIVE);
+    }
+    if (sched->mode == ADXL345_SCHED_ACTIVE && now - sched->loud_us >= (int64_t)c->hold_ms * 1000) {
+        return adxl345_sched_set_mode(sched, ADXL345_SCHED_IDLE);
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Time per mode and estimated charge up to now
+ * @param stats where to store them
+ */
+void adxl345_sched_get_stats(adxl345_sched_t *sched, adxl345_sched_stats_t *stats)
+{
+    adxl345_sched_account(sched, esp_timer_get_time());
+
+    for (int i = 0; i < ADXL345_SCHED_MODES; i++) {
+        stats->time_us[i] = sched->time_us[i];
+    }
+    stats->switches = sched->switches;
+    stats->charge_uas = sched->charge_uaus / 1000000;
+    stats->rms_mg = sched->rms_mg;
+}
+
+/**
+ * @brief Restart the statistics from now
+ */
+void adxl345_sched_reset_stats(adxl345_sched_t *sched)
+{
+    for (int i = 0; i < ADXL345_SCHED_MODES; i++) {
+        sched->time_us[i] = 0;
+    }
+    sched->charge_uaus = 0;
+    sched->switches = 0;
+    sched->since_us = esp_timer_get_time();
+    sched->loud_us = sched->since_us;
+}
+
+/**
+ * @brief Integer square root, floor(sqrt(v))
+ */
+static uint32_t adxl345_sched_isqrt64(uint64_t v)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
@@ -0,0 +1,95 @@
+/**
+ * Adaptive data rate / power mode scheduler. Two modes: IDLE samples slowly in
+ * low power mode, ACTIVE samples fast with the FIFO in stream mode. The policy
+ * decides when to switch:
+ *  - EVENTS: the sensor's own ACTIVITY / INACTIVITY interrupts (adxl345_events.h),
+ *    the MCU does nothing while it is quiet.
+ *  - ENERGY: the RMS of the acceleration around its running mean, from the samples
+ *    you read anyway, with hysteresis and a hold time before going back to IDLE.
+ * Time in every mode and an estimate of the sensor supply charge are kept, so the
+ * savings of a policy can be checked on the bench.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+typedef struct adxl345_sched_t adxl345_sched_t;
+
+typedef enum {
+    ADXL345_SCHED_IDLE = 0,
+    ADXL345_SCHED_ACTIVE,
+    ADXL345_SCHED_MODES,
+} adxl345_sched_mode_t;
+
+typedef enum {
+    ADXL345_SCHED_POLICY_EVENTS = 0,    ///< switch on ACTIVITY / INACTIVITY, see adxl345_sched_update()
+    ADXL345_SCHED_POLICY_ENERGY,        ///< switch on signal energy, see adxl345_sched_feed()
+} adxl345_sched_policy_t;
+
+/**
+ * @brief Sensor settings of one mode
+ */
+typedef struct {
+    adxl345_datarate_t rate;            ///< ODR
+    bool low_power;                     ///< BW_RATE LOW_POWER, only does something from 12.5 to 400 Hz
+    adxl345_fifo_mode_t fifo_mode;      ///< FIFO mode
+    uint8_t watermark;                  ///< FIFO watermark, ignored in bypass mode
+} adxl345_sched_mode_config_t;
+
+/**
+ * @brief Called from adxl345_sched_update()/feed()/set_mode() after the sensor switched
+ */
+typedef void (*adxl345_sched_cb_t)(adxl345_dev_t *dev, adxl345_sched_mode_t mode, void *arg);
+
+typedef struct {
+    adxl345_sched_policy_t policy;
+    adxl345_sched_mode_config_t mode[ADXL345_SCHED_MODES];  ///< settings per adxl345_sched_mode_t
+    uint16_t enter_rms_mg;              ///< ENERGY: go ACTIVE above this
+    uint16_t exit_rms_mg;               ///< ENERGY: go IDLE below this, lower than enter_rms_mg
+    uint32_t hold_ms;                   ///< ENERGY: time below exit_rms_mg before going back to IDLE (EVENTS: TIME_INACT does this)
+    adxl345_sched_cb_t callback;        ///< NULL when not needed
+    void *arg;                          ///< passed to the callback
+} adxl345_sched_config_t;
+
+#define ADXL345_SCHED_CONFIG_DEFAULT() {                                                    \
+    .policy = ADXL345_SCHED_POLICY_EVENTS,                                                  \
+    .mode = {                                                                               \
+        [ADXL345_SCHED_IDLE] = { ADXL345_DATARATE_12_5_HZ, true, ADXL345_FIFO_BYPASS, 0 },  \
+        [ADXL345_SCHED_ACTIVE] = { ADXL345_DATARATE_800_HZ, false, ADXL345_FIFO_STREAM, 16 }, \
+    },                                                                                      \
+    .enter_rms_mg = 50,                                                                     \
+    .exit_rms_mg = 20,                                                                      \
+    .hold_ms = 2000,                                                                        \
+    .callback = NULL,                                                                       \
+    .arg = NULL,                                                                            \
+}
+
+typedef struct {
+    uint64_t time_us[ADXL345_SCHED_MODES];  ///< time spent in every mode
+    uint32_t switches;                      ///< mode changes
+    uint64_t charge_uas;                    ///< estimated sensor supply charge in uA*s, datasheet typical at 2.5 V
+    uint16_t rms_mg;                        ///< ENERGY: last signal RMS
+} adxl345_sched_stats_t;
+
+esp_err_t adxl345_sched_create(adxl345_dev_t *dev, const adxl345_sched_config_t *config, adxl345_sched_t **out_sched);
+void adxl345_sched_destroy(adxl345_sched_t *sched);
+esp_err_t adxl345_sched_start(adxl345_sched_t *sched);
+esp_err_t adxl345_sched_set_mode(adxl345_sched_t *sched, adxl345_sched_mode_t mode);
+adxl345_sched_mode_t adxl345_sched_get_mode(adxl345_sched_t *sched);
+esp_err_t adxl345_sched_update(adxl345_sched_t *sched, uint8_t int_source);
+esp_err_t adxl345_sched_feed(adxl345_sched_t *sched, const adxl345_raw_xyz_t *samples, size_t count);
+void adxl345_sched_get_stats(adxl345_sched_t *sched, adxl345_sched_stats_t *stats);
+void adxl345_sched_reset_stats(adxl345_sched_t *sched);
+uint16_t adxl345_sched_supply_ua(adxl345_datarate_t rate, bool low_power);
+
+#ifdef __cplusplus
+}
+#endif
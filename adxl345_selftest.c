@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "adxl345.h"
+#include "adxl345_selftest.h"
+#include "adxl345_priv.h"
+
+
+/* prototype static functions */
+
+static int32_t selftest_scale(int32_t limit, uint16_t factor_x100);
+
+
+/* datasheet Table 14: self-test output change relative to Vs = 2.5 V, x100 */
+static const struct {
+    uint16_t supply_mv;
+    uint16_t xy_x100;
+    uint16_t z_x100;
+} selftest_factors[] = {
+    { 2000, 64, 80 },
+    { 2500, 100, 100 },
+    { 3300, 177, 147 },
+    { 3600, 211, 169 },
+};
+
+#define SELFTEST_FACTORS    (sizeof(selftest_factors) / sizeof(selftest_factors[0]))
+
+
+/**
+ * @brief limit * factor / 100, rounded away from zero
+ */
+static int32_t selftest_scale(int32_t limit, uint16_t factor_x100)
+{
+    int32_t scaled = limit * factor_x100;
+
+    return (scaled >= 0 ? scaled + 50 : scaled - 50) / 100;
+}
+
+/**
+ * @brief Self-test limits for a supply voltage, the table interpolated linearly and
+ *        clamped to 2.0..3.6 V
+ * @param supply_mv Vs
+ * @param min lower limit per axis, LSB at 3.9 mg
+ * @param max upper limit per axis
+ */
+void adxl345_selftest_limits(uint16_t supply_mv, adxl345_xyz_i32_t *min, adxl345_xyz_i32_t *max)
+{
+    uint16_t xy = selftest_factors[SELFTEST_FACTORS - 1].xy_x100;
+    uint16_t z = selftest_factors[SELFTEST_FACTORS - 1].z_x100;
+
+    if (supply_mv <= selftest_factors[0].supply_mv) {
+        xy = selftest_factors[0].xy_x100;
+        z = selftest_factors[0].z_x100;
+    }
+    for (size_t i = 1; i < SELFTEST_FACTORS; i++) {
+        uint16_t lo = selftest_factors[i - 1].supply_mv;
+        uint16_t hi = selftest_factors[i].supply_mv;
+
+        if (supply_mv > lo && supply_mv <= hi) {
+            int32_t span = hi - lo;
+            int32_t pos = supply_mv - lo;
+
+            xy = selftest_factors[i - 1].xy_x100 + ((selftest_factors[i].xy_x100 - selftest_factors[i - 1].xy_x100) * pos + span / 2) / span;
+            z = selftest_factors[i - 1].z_x100 + ((selftest_factors[i].z_x100 - selftest_factors[i - 1].z_x100) * pos + span / 2) / span;
+            break;
+        }
+    }
+
+    min->x = selftest_scale(ADXL345_SELFTEST_X_MIN, xy);
+    max->x = selftest_scale(ADXL345_SELFTEST_X_MAX, xy);
+    min->y = selftest_scale(ADXL345_SELFTEST_Y_MIN, xy);
+    max->y = selftest_scale(ADXL345_SELFTEST_Y_MAX, xy);
+    min->z = selftest_scale(ADXL345_SELFTEST_Z_MIN, z);
+    max->z = selftest_scale(ADXL345_SELFTEST_Z_MAX, z);
+}
+
+/**
+ * @brief Run the self-test. The sensor is locked for the whole run and ends up in
+ *        the configuration it had before, also when the test fails.
+ * @param config supply voltage and batch sizes, NULL for ADXL345_SELFTEST_CONFIG_DEFAULT()
+ * @param result deltas, limits, verdict and time taken
+ * @return ESP_OK when every axis is inside its limits, ESP_FAIL when not (result
+ *         says which), ESP_ERR_INVALID_ARG, ESP_ERR_TIMEOUT or the bus error
+ */
+esp_err_t adxl345_selftest_run(adxl345_dev_t *dev, const adxl345_selftest_config_t *config,
+                               adxl345_selftest_result_t *result)
+{
+    adxl345_selftest_config_t cfg = ADXL345_SELFTEST_CONFIG_DEFAULT();
+    adxl345_config_t saved;
+    adxl345_config_t test;
+    adxl345_xyz_i32_t off;
+    adxl345_xyz_i32_t on;
+    int64_t start = esp_timer_get_time();
+    esp_err_t err;
+
+    if (config != NULL) {
+        cfg = *config;
+    }
+    if (dev == NULL || result == NULL || cfg.samples == 0 || cfg.samples > 1024) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    *result = (adxl345_selftest_result_t) { .pass = false };
+    adxl345_selftest_limits(cfg.supply_mv, &result->min, &result->max);
+
+    ADXL345_LOCK(dev);
+    adxl345_get_config(dev, &saved);
+
+    test = saved;                                                       // offsets cancel out in the delta
+    test.bw_rate = ADXL345_DATARATE_800_HZ;                             // normal power
+    test.power_ctl = 0x08;                                              // measuring, no sleep
+    test.int_enable = 0x00;                                             // keep the interrupt task out of the FIFO
+    test.data_format = (saved.data_format & 0x60) | 0x08 | ADXL345_RANGE_16_G;  // keep SPI / INT_INVERT
+    test.fifo_ctl = ADXL345_FIFO_STREAM << 6;
+
+    err = adxl345_apply_config(dev, &test, false);
+    if (err == ESP_OK) {
+        err = adxl345_fifo_average(dev, cfg.samples, cfg.settle, &off);
+    }
+    if (err == ESP_OK) {
+        test.data_format |= 0x80;                                       // SELF_TEST
+        err = adxl345_write_regs(dev, ADXL345_REG_DATA_FORMAT, &test.data_format, 1);
+    }
+    if (err == ESP_OK) {
+        err = adxl345_fifo_average(dev, cfg.samples, cfg.settle, &on);
+    }
+
+    esp_err_t restore = adxl345_apply_config(dev, &saved, true);
+    ADXL345_UNLOCK(dev);
+
+    result->duration_us = (uint32_t)(esp_timer_get_time() - start);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (restore != ESP_OK) {
+        return restore;
+    }
+
+    result->delta.x = on.x - off.x;
+    result->delta.y = on.y - off.y;
+    result->delta.z = on.z - off.z;
+    result->pass = result->delta.x >= result->min.x && result->delta.x <= result->max.x &&
+                   result->delta.y >= result->min.y && result->delta.y <= result->max.y &&
+                   result->delta.z >= result->min.z && result->delta.z <= result->max.z;
+
+    if (!result->pass) {
+        ESP_LOGE(__func__, "Self-test failed, delta x: %ld y: %ld z: %ld LSB", (long)result->delta.x,
+                 (long)result->delta.y, (long)result->delta.z);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(__func__, "Self-test passed in %lu us", (unsigned long)result->duration_us);
+    return ESP_OK;
+}
@@ -0,0 +1,54 @@
+/**
+ * Complete self-test: the electrostatic force of SELF_TEST moves the proof mass,
+ * the output change has to land inside the datasheet limits. The sensor runs at
+ * 800 Hz, +-16 g FULL_RES, normal power; a FIFO averaged batch with SELF_TEST off
+ * and one with it on are compared against the limits scaled for the supply voltage,
+ * then the configuration from before is written back.
+ * About 60 ms with the defaults, short enough for every boot. Keep the board still.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+/* output change limits at Vs = 2.5 V, LSB at 3.9 mg, from the datasheet */
+#define ADXL345_SELFTEST_X_MIN      50
+#define ADXL345_SELFTEST_X_MAX      540
+#define ADXL345_SELFTEST_Y_MIN      (-540)
+#define ADXL345_SELFTEST_Y_MAX      (-50)
+#define ADXL345_SELFTEST_Z_MIN      75
+#define ADXL345_SELFTEST_Z_MAX      875
+
+typedef struct {
+    uint16_t supply_mv;         ///< Vs, the limits scale with it, 2000..3600
+    uint16_t samples;           ///< averaged per state, 1..1024
+    uint8_t settle;             ///< samples dropped after switching SELF_TEST
+} adxl345_selftest_config_t;
+
+#define ADXL345_SELFTEST_CONFIG_DEFAULT() {     \
+    .supply_mv = 3300,                          \
+    .samples = 16,                              \
+    .settle = 4,                                \
+}
+
+typedef struct {
+    bool pass;
+    adxl345_xyz_i32_t delta;    ///< SELF_TEST on minus off, LSB at 3.9 mg
+    adxl345_xyz_i32_t min;      ///< limits used, scaled to supply_mv
+    adxl345_xyz_i32_t max;
+    uint32_t duration_us;       ///< whole test, restoring the configuration included
+} adxl345_selftest_result_t;
+
+esp_err_t adxl345_selftest_run(adxl345_dev_t *dev, const adxl345_selftest_config_t *config,
+                               adxl345_selftest_result_t *result);
+void adxl345_selftest_limits(uint16_t supply_mv, adxl345_xyz_i32_t *min, adxl345_xyz_i32_t *max);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,589 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_spectrum.h"
+
+#define SPECTRUM_AXES       3
+#define SPECTRUM_Q15_TOP    16383       // block scaling target, one bit of headroom for the first butterfly
+
+
+struct adxl345_spectrum_engine_t {
+    adxl345_spectrum_config_t config;
+    float targets[ADXL345_SPECTRUM_MAX_TARGETS];
+    uint16_t half;                      // frame_size / 2, the complex FFT size
+    uint16_t bins;                      // values per callback
+    uint16_t pos;                       // next slot in history
+    uint16_t filled;                    // samples in history, up to frame_size
+    uint16_t since_frame;               // samples since the last frame
+    uint32_t frame;
+    float inv_cg;                       // 1 / coherent gain of the window
+    int32_t inv_cg_q13;
+    int16_t *history[SPECTRUM_AXES];    // last frame_size samples per axis, circular
+    // float path
+    float *win_f;
+    float *tw_cos_f;                    // cos(2 pi k / N), k < N / 2
+    float *tw_sin_f;
+    float *work_f;                      // frame_size floats, also N / 2 complex values
+    float *mag_f;
+    float *coef_f;                      // Goertzel 2 cos(w)
+    // Q15 path
+    int16_t *win_q;
+    int16_t *tw_cos_q;
+    int16_t *tw_sin_q;
+    int16_t *work_q;
+    int32_t *mag_q;
+    int32_t *coef_q;                    // Goertzel 2 cos(w), Q14
+};
+
+
+/* prototype static functions */
+
+static void adxl345_spectrum_frame(adxl345_spectrum_engine_t *eng, uint8_t axis);
+static void adxl345_spectrum_fft_f(adxl345_spectrum_engine_t *eng);
+static void adxl345_spectrum_fft_q(adxl345_spectrum_engine_t *eng);
+static void adxl345_spectrum_rfft_mag_f(adxl345_spectrum_engine_t *eng);
+static void adxl345_spectrum_rfft_mag_q(adxl345_spectrum_engine_t *eng, int shift);
+static void adxl345_spectrum_goertzel_f(adxl345_spectrum_engine_t *eng);
+static void adxl345_spectrum_goertzel_q(adxl345_spectrum_engine_t *eng, int shift);
+static int32_t adxl345_spectrum_q16(int64_t value, int shift);
+static uint32_t adxl345_isqrt64(uint64_t v);
+
+
+/**
+ * @brief Allocate a spectrum engine, all buffers included
+ * @param config mode, format, frame size, callback
+ * @param out_engine the new engine
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM
+ */
+esp_err_t adxl345_spectrum_create(const adxl345_spectrum_config_t *config, adxl345_spectrum_engine_t **out_engine)
+{
+    uint16_t n;
+    bool fft;
+    bool q15;
+    bool ok = true;
+
+    if (config == NULL || out_engine == NULL || config->callback == NULL || (config->axes & 0x07) == 0 ||
+            config->frame_size < ADXL345_SPECTRUM_MIN_FRAME || config->frame_size > ADXL345_SPECTRUM_MAX_FRAME ||
+            config->hop == 0 || config->hop > config->frame_size || !(config->sample_rate_hz > 0.0f)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    n = config->frame_size;
+    fft = config->mode == ADXL345_SPECTRUM_FFT;
+    q15 = config->format == ADXL345_SPECTRUM_Q15;
+
+    if (fft && (n & (n - 1)) != 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!fft && (config->targets_hz == NULL || config->target_count == 0 ||
+                 config->target_count > ADXL345_SPECTRUM_MAX_TARGETS)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    adxl345_spectrum_engine_t *eng = calloc(1, sizeof(adxl345_spectrum_engine_t));
+    if (eng == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    eng->config = *config;
+    eng->half = n / 2;
+    eng->bins = fft ? eng->half + 1 : config->target_count;
+    if (!fft) {
+        memcpy(eng->targets, config->targets_hz, config->target_count * sizeof(float));
+        eng->config.targets_hz = eng->targets;
+    }
+
+    for (int a = 0; a < SPECTRUM_AXES; a++) {
+        eng->history[a] = calloc(n, sizeof(int16_t));
+        ok = ok && eng->history[a] != NULL;
+    }
+
+    eng->win_f = malloc(n * sizeof(float));         // also used to build the Q15 window
+    ok = ok && eng->win_f != NULL;
+    if (q15) {
+        eng->win_q = malloc(n * sizeof(int16_t));
+        eng->work_q = malloc(n * sizeof(int16_t));
+        eng->mag_q = malloc(eng->bins * sizeof(int32_t));
+        ok = ok && eng->win_q && eng->work_q && eng->mag_q;
+        if (fft) {
+            eng->tw_cos_q = malloc(eng->half * sizeof(int16_t));
+            eng->tw_sin_q = malloc(eng->half * sizeof(int16_t));
+            ok = ok && eng->tw_cos_q && eng->tw_sin_q;
+        } else {
+            eng->coef_q = malloc(eng->bins * sizeof(int32_t));
+            ok = ok && eng->coef_q;
+        }
+    } else {
+        eng->work_f = malloc(n * sizeof(float));
+        eng->mag_f = malloc(eng->bins * sizeof(float));
+        ok = ok && eng->work_f && eng->mag_f;
+        if (fft) {
+            eng->tw_cos_f = malloc(eng->half * sizeof(float));
+            eng->tw_sin_f = malloc(eng->half * sizeof(float));
+            ok = ok && eng->tw_cos_f && eng->tw_sin_f;
+        } else {
+            eng->coef_f = malloc(eng->bins * sizeof(float));
+            ok = ok && eng->coef_f;
+        }
+    }
+
+    if (!ok) {
+        adxl345_spectrum_destroy(eng);
+        return ESP_ERR_NO_MEM;
+    }
+
+    // periodic windows, the right kind for spectral analysis
+    float sum = 0.0f;
+    for (uint16_t i = 0; i < n; i++) {
+        float c = cosf(2.0f * (float)M_PI * i / n);
+
+        switch (config->window) {
+        case ADXL345_WINDOW_HAMMING:
+            eng->win_f[i] = 0.54f - 0.46f * c;
+            break;
+        case ADXL345_WINDOW_RECT:
+            eng->win_f[i] = 1.0f;
+            break;
+        case ADXL345_WINDOW_HANN:
+        default:
+            eng->win_f[i] = 0.5f - 0.5f * c;
+            break;
+        }
+        sum += eng->win_f[i];
+        if (q15) {
+            eng->win_q[i] = (int16_t)lrintf(fminf(eng->win_f[i] * 32768.0f, 32767.0f));
+        }
+    }
+    eng->inv_cg = n / sum;
+    eng->inv_cg_q13 = (int32_t)lrintf(eng->inv_cg * 8192.0f);
+
+    for (uint16_t k = 0; fft && k < eng->half; k++) {
+        float c = cosf(2.0f * (float)M_PI * k / n);
+        float s = sinf(2.0f * (float)M_PI * k / n);
+
+        if (q15) {
+            eng->tw_cos_q[k] = (int16_t)lrintf(fminf(c * 32768.0f, 32767.0f));
+            eng->tw_sin_q[k] = (int16_t)lrintf(fminf(s * 32768.0f, 32767.0f));
+        } else {
+            eng->tw_cos_f[k] = c;
+            eng->tw_sin_f[k] = s;
+        }
+    }
+
+    for (uint8_t t = 0; !fft && t < eng->bins; t++) {
+        float c = 2.0f * cosf(2.0f * (float)M_PI * eng->targets[t] / config->sample_rate_hz);
+
+        if (q15) {
+            eng->coef_q[t] = (int32_t)lrintf(c * 16384.0f);
+        } else {
+            eng->coef_f[t] = c;
+        }
+    }
+
+    *out_engine = eng;
+    return ESP_OK;
+}
+
+/**
+ * @brief Free the engine and its buffers
+ * @param engine NULL is ignored
+ */
+void adxl345_spectrum_destroy(adxl345_spectrum_engine_t *engine)
+{
+    if (engine == NULL) {
+        return;
+    }
+
+    for (int a = 0; a < SPECTRUM_AXES; a++) {
+        free(engine->history[a]);
+    }
+    free(engine->win_f);
+    free(engine->tw_cos_f);
+    free(engine->tw_sin_f);
+    free(engine->work_f);
+    free(engine->mag_f);
+    free(engine->coef_f);
+    free(engine->win_q);
+    free(engine->tw_cos_q);
+    free(engine->tw_sin_q);
+    free(engine->work_q);
+    free(engine->mag_q);
+    free(engine->coef_q);
+    free(engine);
+}
+
+/**
+ * @brief Forget the collected samples, the next frame needs frame_size new ones
+ */
+void adxl345_spectrum_reset(adxl345_spectrum_engine_t *engine)
+{
+    engine->pos = 0;
+    engine->filled = 0;
+    engine->since_frame = 0;
+    engine->frame = 0;
+}
+
+/**
+ * @brief Feed samples, the callback runs for every frame completed by them
+ * @param samples oldest first, at sample_rate_hz
+ * @param count number of samples
+ * @return ESP_OK or ESP_ERR_INVALID_ARG
+ */
+esp_err_t adxl345_spectrum_feed(adxl345_spectrum_engine_t *engine, const adxl345_raw_xyz_t *samples, size_t count)
+{
+    uint16_t n;
+
+    if (engine == NULL || (samples == NULL && count > 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    n = engine->config.frame_size;
+
+    for (size_t i = 0; i < count; i++) {
+        engine->history[0][engine->pos] = samples[i].x;
+        engine->history[1][engine->pos] = samples[i].y;
+        engine->history[2][engine->pos] = samples[i].z;
+        engine->pos = engine->pos + 1 == n ? 0 : engine->pos + 1;
+        if (engine->filled < n) {
+            engine->filled++;
+        }
+        engine->since_frame++;
+
+        if (engine->filled < n || engine->since_frame < engine->config.hop) {
+            continue;
+        }
+        engine->since_frame = 0;
+
+        for (uint8_t a = 0; a < SPECTRUM_AXES; a++) {
+            if (engine->config.axes & (1 << a)) {
+                adxl345_spectrum_frame(engine, a);
+            }
+        }
+        engine->frame++;
+    }
+
+    return ESP_OK;
+}
+
+/**
+ * @brief Window one axis of the current frame, transform it and hand it to the callback
+ */
+static void adxl345_spectrum_frame(adxl345_spectrum_engine_t *eng, uint8_t axis)
+{
+    const int16_t *hist = eng->history[axis];
+    const uint16_t n = eng->config.frame_size;
+    bool fft = eng->config.mode == ADXL345_SPECTRUM_FFT;
+    int32_t mean = 0;
+    adxl345_spectrum_t spectrum = {
+        .frame = eng->frame,
+        .axis = axis,
+        .bins = eng->bins,
+        .bin_hz = fft ? eng->config.sample_rate_hz / n : 0.0f,
+    };
+
+    // history is full, pos is the oldest sample
+    if (eng->config.remove_dc) {
+        int32_t sum = 0;
+
+        for (uint16_t i = 0; i < n; i++) {
+            sum += hist[i];
+        }
+        mean = sum / n;
+    }
+
+    if (eng->config.format == ADXL345_SPECTRUM_FLOAT) {
+        for (uint16_t i = 0, j = eng->pos; i < n; i++, j = j + 1 == n ? 0 : j + 1) {
+            eng->work_f[i] = (float)(hist[j] - mean) * eng->win_f[i];
+        }
+
+        if (fft) {
+            adxl345_spectrum_fft_f(eng);
+            adxl345_spectrum_rfft_mag_f(eng);
+        } else {
+            adxl345_spectrum_goertzel_f(eng);
+        }
+        spectrum.mag = eng->mag_f;
+    } else {
+        int32_t peak = 0;
+        int shift = 0;
+
+        for (uint16_t i = 0; i < n; i++) {
+            int32_t v = hist[i] - mean;
+
+            peak = v > peak ? v : (-v > peak ? -v : peak);
+        }
+
+        // block floating point: scale the frame to use the 16 bits, undone on the magnitudes
+        while (peak > SPECTRUM_Q15_TOP) {
+            peak >>= 1;
+            shift--;
+        }
+        while (peak != 0 && peak <= SPECTRUM_Q15_TOP / 2) {
+            peak <<= 1;
+            shift++;
+        }
+
+        for (uint16_t i = 0, j = eng->pos; i < n; i++, j = j + 1 == n ? 0 : j + 1) {
+            int32_t v = hist[j] - mean;
+
+            v = shift >= 0 ? v * (1 << shift) : v >> -shift;
+            eng->work_q[i] = (int16_t)((v * eng->win_q[i] + 16384) >> 15);
+        }
+
+        if (fft) {
+            adxl345_spectrum_fft_q(eng);
+            adxl345_spectrum_rfft_mag_q(eng, shift);
+        } else {
+            adxl345_spectrum_goertzel_q(eng, shift);
+        }
+        spectrum.mag_q16 = eng->mag_q;
+    }
+
+    eng->config.callback(&spectrum, eng->config.arg);
+}
+
+/**
+ * @brief In place radix-2 complex FFT of the N / 2 complex values packed in work_f
+ *        (the real frame read as re, im pairs). W_M^k is W_N^2k, so one table does both.
+ */
+static void adxl345_spectrum_fft_f(adxl345_spectrum_engine_t *eng)
+{
+    float *z = eng->work_f;
+    const uint16_t m = eng->half;
+
+    for (uint16_t i = 1, j = 0; i < m; i++) {
+        uint16_t bit = m >> 1;
+
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            float tr = z[2 * i], ti = z[2 * i + 1];
+
+            z[2 * i] = z[2 * j];
+            z[2 * i + 1] = z[2 * j + 1];
+            z[2 * j] = tr;
+            z[2 * j + 1] = ti;
+        }
+    }
+
+    for (uint16_t len = 2; len <= m; len <<= 1) {
+        uint16_t step = 2 * (m / len);
+
+        for (uint16_t i = 0; i < m; i += len) {
+            for (uint16_t k = 0; k < len / 2; k++) {
+                float wr = eng->tw_cos_f[k * step], wi = -eng->tw_sin_f[k * step];
+                float *u = &z[2 * (i + k)];
+                float *v = &z[2 * (i + k + len / 2)];
+                float tr = v[0] * wr - v[1] * wi;
+                float ti = v[0] * wi + v[1] * wr;
+
+                v[0] = u[0] - tr;
+                v[1] = u[1] - ti;
+                u[0] += tr;
+                u[1] += ti;
+            }
+        }
+    }
+}
+
+/**
+ * @brief Same as adxl345_spectrum_fft_f() in Q15, every stage halves the values so
+ *        the result is Z / M and never overflows
+ */
+static void adxl345_spectrum_fft_q(adxl345_spectrum_engine_t *eng)
+{
+    int16_t *z = eng->work_q;
+    const uint16_t m = eng->half;
+
+    for (uint16_t i = 1, j = 0; i < m; i++) {
+        uint16_t bit = m >> 1;
+
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            int16_t tr = z[2 * i], ti = z[2 * i + 1];
+
+            z[2 * i] = z[2 * j];
+            z[2 * i + 1] = z[2 * j + 1];
+            z[2 * j] = tr;
+            z[2 * j + 1] = ti;
+        }
+    }
+
+    for (uint16_t len = 2; len <= m; len <<= 1) {
+        uint16_t step = 2 * (m / len);
+
+        for (uint16_t i = 0; i < m; i += len) {
+            for (uint16_t k = 0; k < len / 2; k++) {
+                int32_t wr = eng->tw_cos_q[k * step], wi = -eng->tw_sin_q[k * step];
+                int16_t *u = &z[2 * (i + k)];
+                int16_t *v = &z[2 * (i + k + len / 2)];
+                int32_t tr = (v[0] * wr - v[1] * wi + 16384) >> 15;
+                int32_t ti = (v[0] * wi + v[1] * wr + 16384) >> 15;
+
+                v[0] = (int16_t)((u[0] - tr) >> 1);
+                v[1] = (int16_t)((u[1] - ti) >> 1);
+                u[0] = (int16_t)((u[0] + tr) >> 1);
+                u[1] = (int16_t)((u[1] + ti) >> 1);
+            }
+        }
+    }
+}
+
+/**
+ * @brief Untangle the half size complex FFT into the real FFT bins and turn them into
+ *        window corrected peak amplitudes:
+ *          X[k] = (Z[k] + Z*[M-k]) / 2 - j W_N^k (Z[k] - Z*[M-k]) / 2
+ */
+static void adxl345_spectrum_rfft_mag_f(adxl345_spectrum_engine_t *eng)
+{
+    const float *z = eng->work_f;
+    const uint16_t m = eng->half;
+    const float dc_scale = eng->inv_cg / eng->config.frame_size;
+    const float scale = 2.0f * dc_scale;
+
+    eng->mag_f[0] = fabsf(z[0] + z[1]) * dc_scale;
+    eng->mag_f[m] = fabsf(z[0] - z[1]) * dc_scale;
+
+    for (uint16_t k = 1; k < m; k++) {
+        float ar = z[2 * k], ai = z[2 * k + 1];
+        float br = z[2 * (m - k)], bi = -z[2 * (m - k) + 1];
+        float fer = ar + br, fei = ai + bi;                 // 2 Fe
+        float for_ = ai - bi, foi = br - ar;                // 2 Fo = -j (a - b)
+        float wr = eng->tw_cos_f[k], wi = -eng->tw_sin_f[k];
+        float xr = (fer + for_ * wr - foi * wi) * 0.5f;
+        float xi = (fei + for_ * wi + foi * wr) * 0.5f;
+
+        eng->mag_f[k] = sqrtf(xr * xr + xi * xi) * scale;
+    }
+}
+
+/**
+ * @brief Q15 version of adxl345_spectrum_rfft_mag_f(), z holds Z / M, the block
+ *        scaling shift is undone here
+ */
+static void adxl345_spectrum_rfft_mag_q(adxl345_spectrum_engine_t *eng, int shift)
+{
+    const int16_t *z = eng->work_q;
+    const uint16_t m = eng->half;
+    int32_t x4;
+
+    // X4 = 4 X / N, the amplitude is |X4| / 2 * inv_cg (|X4| / 4 * inv_cg at DC and N / 2)
+    x4 = 2 * (z[0] + z[1]);
+    eng->mag_q[0] = adxl345_spectrum_q16((int64_t)(x4 < 0 ? -x4 : x4) * eng->inv_cg_q13, 13 + 2 + shift - 16);
+    x4 = 2 * (z[0] - z[1]);
+    eng->mag_q[m] = adxl345_spectrum_q16((int64_t)(x4 < 0 ? -x4 : x4) * eng->inv_cg_q13, 13 + 2 + shift - 16);
+
+    for (uint16_t k = 1; k < m; k++) {
+        int32_t ar = z[2 * k], ai = z[2 * k + 1];
+        int32_t br = z[2 * (m - k)], bi = -z[2 * (m - k) + 1];
+        int32_t fer = ar + br, fei = ai + bi;
+        int32_t for_ = ai - bi, foi = br - ar;
+        int32_t wr = eng->tw_cos_q[k], wi = -eng->tw_sin_q[k];
+        int32_t xr = fer + ((for_ * wr - foi * wi + 16384) >> 15);
+        int32_t xi = fei + ((for_ * wi + foi * wr + 16384) >> 15);
+        uint32_t mag = adxl345_isqrt64(((uint64_t)((int64_t)xr * xr + (int64_t)xi * xi)) << 24);   // |X4| << 12
+
+        eng->mag_q[k] = adxl345_spectrum_q16((int64_t)mag * eng->inv_cg_q13, 12 + 13 + 1 + shift - 16);
+    }
+}
+
+/**
+ * @brief Goertzel resonator per target over the windowed frame in work_f
+ */
+static void adxl345_spectrum_goertzel_f(adxl345_spectrum_engine_t *eng)
+{
+    const uint16_t n = eng->config.frame_size;
+    const float scale = 2.0f * eng->inv_cg / n;
+
+    for (uint16_t t = 0; t < eng->bins; t++) {
+        float c = eng->coef_f[t];
+        float s1 = 0.0f, s2 = 0.0f;
+
+        for (uint16_t i = 0; i < n; i++) {
+            float s = eng->work_f[i] + c * s1 - s2;
+
+            s2 = s1;
+            s1 = s;
+        }
+
+        float power = s1 * s1 + s2 * s2 - c * s1 * s2;
+
+        eng->mag_f[t] = sqrtf(power > 0.0f ? power : 0.0f) * scale;
+    }
+}
+
+/**
+ * @brief Goertzel in fixed point, Q14 coefficient, 32 bit state, 64 bit power
+ */
+static void adxl345_spectrum_goertzel_q(adxl345_spectrum_engine_t *eng, int shift)
+{
+    const uint16_t n = eng->config.frame_size;
+
+    for (uint16_t t = 0; t < eng->bins; t++) {
+        int32_t c = eng->coef_q[t];
+        int32_t s1 = 0, s2 = 0;
+
+        for (uint16_t i = 0; i < n; i++) {
+            int32_t s = eng->work_q[i] + (int32_t)(((int64_t)c * s1 + 8192) >> 14) - s2;
+
+            s2 = s1;
+            s1 = s;
+        }
+
+        int64_t power = (int64_t)s1 * s1 + (int64_t)s2 * s2 - (((int64_t)c * s1) >> 14) * s2;
+        uint32_t mag = adxl345_isqrt64(power > 0 ? (uint64_t)power : 0);       // |X|
+
+        // 2 |X| inv_cg / N in Q16.16
+        eng->mag_q[t] = adxl345_spectrum_q16((int64_t)mag * eng->inv_cg_q13 * 2 * 8 / n, 13 - 16 + 3 + shift);
+    }
+}
+
+/**
+ * @brief value >> shift (<< -shift when negative), rounded and saturated to int32
+ */
+static int32_t adxl345_spectrum_q16(int64_t value, int shift)
+{
+    if (shift > 0) {
+        value = (value + (1LL << (shift - 1))) >> shift;
+    } else if (shift < 0) {
+        value = value > (INT32_MAX >> -shift) ? INT32_MAX : value << -shift;
+    }
+
+    return value > INT32_MAX ? INT32_MAX : (int32_t)value;
+}
+
+/**
+ * @brief Integer square root, floor(sqrt(v))
+ */
+static uint32_t adxl345_isqrt64(uint64_t v)
+{
+    uint64_t root = 0;
+    uint64_t bit = 1ULL << 62;
+
+    while (bit > v) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (v >= root + bit) {
+            v -= root + bit;
+            root = (root >> 1) + bit;
+        } else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+
+    return (uint32_t)root;
+}
@@ -0,0 +1,105 @@
+/**
+ * Vibration spectrum engine. Feed it sample batches (FIFO drains, ring buffer pops)
+ * and it calls back with per-axis magnitude spectra, one per frame of frame_size
+ * samples, a new frame every hop samples (hop < frame_size overlaps the frames).
+ *
+ * FFT mode: windowed real FFT, frame_size / 2 + 1 bins from DC to ODR / 2.
+ * Goertzel mode: only the target frequencies, much cheaper for a handful of lines
+ * such as the shaft rate and bearing defect frequencies.
+ *
+ * Float or Q15 arithmetic, selectable at create. The Q15 path scales every frame
+ * to full range (block floating point) so small peaks survive. Magnitudes are peak
+ * amplitudes in raw counts corrected for the window, convert them with the
+ * adxl345_convert_* scale like any other sample value.
+ * Everything is allocated at create, feeding never allocates.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_SPECTRUM_MIN_FRAME      16
+#define ADXL345_SPECTRUM_MAX_FRAME      1024
+#define ADXL345_SPECTRUM_MAX_TARGETS    16
+
+#define ADXL345_SPECTRUM_AXIS_X         0x01
+#define ADXL345_SPECTRUM_AXIS_Y         0x02
+#define ADXL345_SPECTRUM_AXIS_Z         0x04
+
+typedef struct adxl345_spectrum_engine_t adxl345_spectrum_engine_t;
+
+typedef enum {
+    ADXL345_SPECTRUM_FFT = 0,           ///< full spectrum, frame_size a power of 2
+    ADXL345_SPECTRUM_GOERTZEL,          ///< target frequencies only, any frame_size
+} adxl345_spectrum_mode_t;
+
+typedef enum {
+    ADXL345_SPECTRUM_FLOAT = 0,         ///< float, fast on an FPU (ESP32, ESP32-S3)
+    ADXL345_SPECTRUM_Q15,               ///< 16 bit fixed point, for targets without FPU (ESP32-C3)
+} adxl345_spectrum_format_t;
+
+typedef enum {
+    ADXL345_WINDOW_HANN = 0,            ///< good default
+    ADXL345_WINDOW_HAMMING,
+    ADXL345_WINDOW_RECT,                ///< no window, only for signals periodic in the frame
+} adxl345_window_t;
+
+/**
+ * @brief One axis of one frame, valid during the callback only
+ */
+typedef struct {
+    uint32_t frame;                     ///< frame counter since create/reset
+    uint8_t axis;                       ///< 0 = x, 1 = y, 2 = z
+    uint16_t bins;                      ///< FFT: frame_size / 2 + 1, Goertzel: target_count
+    float bin_hz;                       ///< FFT bin spacing, 0 in Goertzel mode
+    const float *mag;                   ///< peak amplitude per bin in counts, ADXL345_SPECTRUM_FLOAT only
+    const int32_t *mag_q16;             ///< peak amplitude per bin in counts Q16.16, ADXL345_SPECTRUM_Q15 only
+} adxl345_spectrum_t;
+
+typedef void (*adxl345_spectrum_cb_t)(const adxl345_spectrum_t *spectrum, void *arg);
+
+typedef struct {
+    adxl345_spectrum_mode_t mode;
+    adxl345_spectrum_format_t format;
+    adxl345_window_t window;
+    uint16_t frame_size;                ///< samples per frame, ADXL345_SPECTRUM_MIN_FRAME..MAX_FRAME
+    uint16_t hop;                       ///< samples between frames, 1..frame_size, frame_size / 2 = 50% overlap
+    uint8_t axes;                       ///< ADXL345_SPECTRUM_AXIS_* bits
+    bool remove_dc;                     ///< subtract the frame mean first, keeps gravity out of the low bins
+    float sample_rate_hz;               ///< ODR of the samples fed in
+    const float *targets_hz;            ///< Goertzel frequencies, copied at create
+    uint8_t target_count;               ///< up to ADXL345_SPECTRUM_MAX_TARGETS
+    adxl345_spectrum_cb_t callback;     ///< called from adxl345_spectrum_feed() for every axis of every frame
+    void *arg;                          ///< passed to the callback
+} adxl345_spectrum_config_t;
+
+#define ADXL345_SPECTRUM_CONFIG_DEFAULT() {                                         \
+    .mode = ADXL345_SPECTRUM_FFT,                                                   \
+    .format = ADXL345_SPECTRUM_FLOAT,                                               \
+    .window = ADXL345_WINDOW_HANN,                                                  \
+    .frame_size = 256,                                                              \
+    .hop = 128,                                                                     \
+    .axes = ADXL345_SPECTRUM_AXIS_X | ADXL345_SPECTRUM_AXIS_Y | ADXL345_SPECTRUM_AXIS_Z, \
+    .remove_dc = true,                                                              \
+    .sample_rate_hz = 3200.0f,                                                      \
+    .targets_hz = NULL,                                                             \
+    .target_count = 0,                                                              \
+    .callback = NULL,                                                               \
+    .arg = NULL,                                                                    \
+}
+
+esp_err_t adxl345_spectrum_create(const adxl345_spectrum_config_t *config, adxl345_spectrum_engine_t **out_engine);
+void adxl345_spectrum_destroy(adxl345_spectrum_engine_t *engine);
+void adxl345_spectrum_reset(adxl345_spectrum_engine_t *engine);
+esp_err_t adxl345_spectrum_feed(adxl345_spectrum_engine_t *engine, const adxl345_raw_xyz_t *samples, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,107 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_stats.h"
+#include "adxl345_priv.h"
+
+#ifdef CONFIG_ADXL345_STATS_ENABLED
+
+/**
+ * @brief Account a finished bus transaction, called through ADXL345_STATS_BUS()
+ * @param write write or read
+ * @param reg first register
+ * @param len payload bytes
+ * @param err transaction result
+ * @param start_us esp_timer_get_time() before the transaction
+ */
+void adxl345_stats_bus(adxl345_dev_t *dev, bool write, uint8_t reg, size_t len, esp_err_t err, int64_t start_us)
+{
+    adxl345_stats_t *stats = &dev->stats;
+
+    if (write) {
+        stats->writes++;
+    } else {
+        stats->reads++;
+    }
+
+    if (err != ESP_OK) {
+        stats->errors++;
+        if (reg < ADXL345_STATS_REGS) {
+            stats->reg_errors[reg]++;
+        }
+        return;
+    }
+
+    if (write) {
+        stats->bytes_written += len;
+    } else {
+        stats->bytes_read += len;
+    }
+    adxl345_stats_latency(dev, write ? ADXL345_STATS_OP_WRITE : ADXL345_STATS_OP_READ, start_us);
+}
+
+/**
+ * @brief Account the duration of an operation, called through ADXL345_STATS_LATENCY()
+ * @param op what finished
+ * @param start_us esp_timer_get_time() when it started
+ */
+void adxl345_stats_latency(adxl345_dev_t *dev, adxl345_stats_op_t op, int64_t start_us)
+{
+    adxl345_latency_stats_t *lat = &dev->stats.latency[op];
+    int64_t elapsed = esp_timer_get_time() - start_us;
+    uint32_t us = elapsed < 0 ? 0 : (elapsed > UINT32_MAX ? UINT32_MAX : (uint32_t)elapsed);
+    int bucket = 0;
+
+    if (lat->count == 0 || us < lat->min_us) {
+        lat->min_us = us;
+    }
+    if (us > lat->max_us) {
+        lat->max_us = us;
+    }
+    lat->count++;
+    lat->total_us += us;
+
+    for (uint32_t v = us >> 4; v != 0 && bucket < ADXL345_STATS_HIST_BUCKETS - 1; v >>= 1) {
+        bucket++;
+    }
+    lat->hist[bucket]++;
+}
+
+#endif
+
+/**
+ * @brief Snapshot of the counters. Taken without a lock, a counter being bumped
+ *        by the acquisition task at that moment may be one behind.
+ * @param stats where to store them
+ * @return ESP_OK, or ESP_ERR_NOT_SUPPORTED without CONFIG_ADXL345_STATS_ENABLED
+ */
+esp_err_t adxl345_get_stats(adxl345_dev_t *dev, adxl345_stats_t *stats)
+{
+#ifdef CONFIG_ADXL345_STATS_ENABLED
+    *stats = dev->stats;
+    return ESP_OK;
+#else
+    (void)dev;
+    memset(stats, 0, sizeof(adxl345_stats_t));
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+/**
+ * @brief Zero all counters
+ * @return ESP_OK, or ESP_ERR_NOT_SUPPORTED without CONFIG_ADXL345_STATS_ENABLED
+ */
+esp_err_t adxl345_reset_stats(adxl345_dev_t *dev)
+{
+#ifdef CONFIG_ADXL345_STATS_ENABLED
+    memset(&dev->stats, 0, sizeof(adxl345_stats_t));
+    return ESP_OK;
+#else
+    (void)dev;
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
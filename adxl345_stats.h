@@ -0,0 +1,62 @@
+/**
+ * Per-device counters for the field: bus transactions, bytes, errors per register,
+ * FIFO overruns and watermark hits, samples read and dropped, retries, bus clears,
+ * configuration re-applies after brownouts, and latency per
+ * operation (min / avg / max and a log2 histogram).
+ * Only compiled in with CONFIG_ADXL345_STATS_ENABLED (menuconfig, or -DADXL345_STATS=ON
+ * for the host build); without it the hooks are empty macros and the API returns
+ * ESP_ERR_NOT_SUPPORTED.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_STATS_REGS          (ADXL345_REG_FIFO_STATUS + 1)   ///< registers 0x00..0x39
+#define ADXL345_STATS_HIST_BUCKETS  12      ///< bucket 0: < 16 us, bucket n: 2^(n+3)..2^(n+4) us, last: >= 16 ms
+
+typedef enum {
+    ADXL345_STATS_OP_READ = 0,      ///< one read transaction
+    ADXL345_STATS_OP_WRITE,         ///< one write transaction
+    ADXL345_STATS_OP_XYZ,           ///< one 6 byte sample read
+    ADXL345_STATS_OP_FIFO,          ///< one adxl345_read_fifo() drain
+    ADXL345_STATS_OPS,
+} adxl345_stats_op_t;
+
+typedef struct {
+    uint32_t count;
+    uint32_t min_us;
+    uint32_t max_us;
+    uint64_t total_us;                          ///< avg = total_us / count
+    uint32_t hist[ADXL345_STATS_HIST_BUCKETS];
+} adxl345_latency_stats_t;
+
+typedef struct {
+    uint32_t reads;                             ///< read transactions
+    uint32_t writes;                            ///< write transactions
+    uint64_t bytes_read;
+    uint64_t bytes_written;
+    uint32_t errors;                            ///< failed transactions
+    uint16_t reg_errors[ADXL345_STATS_REGS];    ///< failed transactions by first register
+    uint32_t fifo_overruns;                     ///< INT_SOURCE reads with OVERRUN set
+    uint32_t watermark_hits;                    ///< INT_SOURCE reads with WATERMARK set
+    uint32_t samples_read;                      ///< samples out of the data registers / FIFO
+    uint32_t samples_dropped;                   ///< samples that did not fit a ring buffer (adxl345_ringbuf_fill())
+    uint32_t retries;                           ///< transactions repeated after an error
+    uint32_t reads_lost;                        ///< failed reads of INT_SOURCE / the data registers, not retried: samples or events gone
+    uint32_t bus_recoveries;                    ///< bus clears by the transport
+    uint32_t config_reapplied;                  ///< sensor resets (brownouts) repaired
+    adxl345_latency_stats_t latency[ADXL345_STATS_OPS];
+} adxl345_stats_t;
+
+esp_err_t adxl345_get_stats(adxl345_dev_t *dev, adxl345_stats_t *stats);
+esp_err_t adxl345_reset_stats(adxl345_dev_t *dev);
+
+#ifdef __cplusplus
+}
+#endif
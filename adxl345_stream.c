@@ -0,0 +1,316 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_stream.h"
+#include "adxl345_priv.h"
+
+
+/* prototype static functions */
+
+static size_t stream_put_varint(uint8_t *out, int32_t value);
+static bool stream_get_varint(const uint8_t *in, size_t len, size_t *pos, int32_t *value);
+static void stream_put_le(uint8_t *out, uint64_t value, size_t bytes);
+static uint64_t stream_get_le(const uint8_t *in, size_t bytes);
+
+
+/* CRC-16/CCITT-FALSE (poly 0x1021), a nibble at a time, 32 bytes of table */
+static const uint16_t stream_crc_table[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+
+/**
+ * @brief CRC-16/CCITT-FALSE, init 0xFFFF, no reflection, "123456789" gives 0x29B1
+ */
+uint16_t adxl345_stream_crc16(const uint8_t *data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint16_t)(crc << 4) ^ stream_crc_table[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (uint16_t)(crc << 4) ^ stream_crc_table[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Start a stream, the first frame gets sequence number 0
+ * @param device_id goes into every frame
+ */
+void adxl345_stream_enc_init(adxl345_stream_enc_t *enc, uint8_t device_id)
+{
+    enc->device_id = device_id;
+    enc->seq = 0;
+}
+
+/**
+ * @brief Encode one batch as a frame, rate and data format from the shadow copy
+ * @param samples raw samples at the current settings, equally spaced
+ * @param count 1..ADXL345_STREAM_MAX_SAMPLES
+ * @param base_us timestamp of samples[0]
+ * @param out frame buffer, ADXL345_STREAM_FRAME_MAX(count) is always enough
+ * @param out_len frame length
+ * @return ESP_OK, ESP_ERR_INVALID_ARG or ESP_ERR_INVALID_SIZE when out is too small,
+ *         the sequence number only moves on ESP_OK
+ */
+esp_err_t adxl345_stream_encode(adxl345_stream_enc_t *enc, adxl345_dev_t *dev, const adxl345_raw_xyz_t *samples, size_t count,
+                                int64_t base_us, uint8_t *out, size_t out_size, size_t *out_len)
+{
+    if (count > ADXL345_STREAM_MAX_SAMPLES) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    const adxl345_stream_header_t header = {
+        .device_id = enc->device_id,
+        .rate = ADXL345_SHADOW(dev, ADXL345_REG_BW_RATE) & 0x0F,
+        .data_format = ADXL345_SHADOW(dev, ADXL345_REG_DATA_FORMAT),
+        .seq = enc->seq,
+        .count = (uint16_t)count,
+        .base_us = base_us,
+    };
+
+    esp_err_t err = adxl345_stream_encode_frame(&header, samples, out, out_size, out_len);
+    if (err == ESP_OK) {
+        enc->seq++;
+    }
+
+    return err;
+}
+
+/**
+ * @brief Encode a frame from a filled in header, no device needed
+ * @param header header->count samples are taken from samples
+ * @return see adxl345_stream_encode()
+ */
+esp_err_t adxl345_stream_encode_frame(const adxl345_stream_header_t *header, const adxl345_raw_xyz_t *samples,
+                                      uint8_t *out, size_t out_size, size_t *out_len)
+{
+    if (header == NULL || out == NULL || out_len == NULL || header->count == 0 ||
+            header->count > ADXL345_STREAM_MAX_SAMPLES || samples == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // the payload goes straight into out, so the worst case has to fit up front
+    if (out_size < ADXL345_STREAM_FRAME_MAX(header->count)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    size_t pos = ADXL345_STREAM_HEADER_LEN;
+    adxl345_raw_xyz_t prev = { 0 };
+
+    for (size_t i = 0; i < header->count; i++) {
+        pos += stream_put_varint(&out[pos], (int32_t)samples[i].x - prev.x);
+        pos += stream_put_varint(&out[pos], (int32_t)samples[i].y - prev.y);
+        pos += stream_put_varint(&out[pos], (int32_t)samples[i].z - prev.z);
+        prev = samples[i];
+    }
+
+    out[0] = ADXL345_STREAM_MAGIC0;
+    out[1] = ADXL345_STREAM_MAGIC1;
+    out[2] = ADXL345_STREAM_VERSION;
+    out[3] = header->device_id;
+    out[4] = header->rate;
+    out[5] = header->data_format;
+    stream_put_le(&out[6], header->seq, 2);
+    stream_put_le(&out[8], header->count, 2);
+    stream_put_le(&out[10], pos - ADXL345_STREAM_HEADER_LEN, 2);
+    stream_put_le(&out[12], (uint64_t)header->base_us, 8);
+    stream_put_le(&out[pos], adxl345_stream_crc16(out, pos), 2);
+
+    *out_len = pos + ADXL345_STREAM_CRC_LEN;
+    return ESP_OK;
+}
+
+/**
+ * @brief Decode the frame at the start of a byte stream. Drop *used bytes and call
+ *        again until it asks for more; bytes before a frame (line noise, a partial
+ *        frame from before you connected) come back as ESP_ERR_NOT_FOUND first.
+ * @param buf received bytes
+ * @param len bytes in buf
+ * @param header the frame header, valid on ESP_OK
+ * @param samples decoded samples, header->count of them on ESP_OK
+ * @param max_samples room in samples, ADXL345_STREAM_MAX_SAMPLES always fits
+ * @param used bytes of buf that can be dropped, set for every result
+ * @return ESP_OK,
+ *         ESP_ERR_NOT_FOUND: *used bytes up to the next frame start,
+ *         ESP_ERR_INVALID_SIZE: no complete frame yet, append and call again,
+ *         ESP_ERR_INVALID_CRC: corrupt frame or false sync, skipped,
+ *         ESP_ERR_INVALID_VERSION: frame of another format version, skipped,
+ *         ESP_ERR_NO_MEM: frame has more than max_samples samples, nothing consumed
+ *         ESP_ERR_INVALID_ARG
+ */
+esp_err_t adxl345_stream_decode(const uint8_t *buf, size_t len, adxl345_stream_header_t *header,
+                                adxl345_raw_xyz_t *samples, size_t max_samples, size_t *used)
+{
+    if (used == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *used = 0;
+    if (buf == NULL || header == NULL || samples == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t start = 0;
+
+    while (start + 1 < len && !(buf[start] == ADXL345_STREAM_MAGIC0 && buf[start + 1] == ADXL345_STREAM_MAGIC1)) {
+        start++;
+    }
+    if (start + 1 >= len && !(len > 0 && buf[len - 1] == ADXL345_STREAM_MAGIC0)) {
+        start = len;            // keep a trailing first magic byte, its partner may be in the next read
+    }
+    if (start > 0) {
+        *used = start;
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (len < ADXL345_STREAM_HEADER_LEN) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    const uint8_t *frame = buf;
+    uint16_t count = (uint16_t)stream_get_le(&frame[8], 2);
+    size_t payload_len = (size_t)stream_get_le(&frame[10], 2);
+
+    if (frame[2] != ADXL345_STREAM_VERSION) {
+        *used = 1;
+        return ESP_ERR_INVALID_VERSION;
+    }
+    // check what we can before waiting for a frame length that may be noise
+    if (count == 0 || count > ADXL345_STREAM_MAX_SAMPLES ||
+            payload_len < 3 * (size_t)count || payload_len > ADXL345_STREAM_SAMPLE_MAX_LEN * (size_t)count) {
+        *used = 1;
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    size_t frame_len = ADXL345_STREAM_HEADER_LEN + payload_len + ADXL345_STREAM_CRC_LEN;
+
+    if (len < frame_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (adxl345_stream_crc16(frame, frame_len - ADXL345_STREAM_CRC_LEN) !=
+            (uint16_t)stream_get_le(&frame[frame_len - ADXL345_STREAM_CRC_LEN], 2)) {
+        *used = 1;
+        return ESP_ERR_INVALID_CRC;
+    }
+    if (count > max_samples) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    const uint8_t *payload = &frame[ADXL345_STREAM_HEADER_LEN];
+    size_t pos = 0;
+    int32_t xyz[3] = { 0 };
+
+    for (size_t i = 0; i < count; i++) {
+        for (int a = 0; a < 3; a++) {
+            int32_t delta;
+
+            if (!stream_get_varint(payload, payload_len, &pos, &delta)) {
+                *used = 1;
+                return ESP_ERR_INVALID_CRC;
+            }
+            xyz[a] += delta;
+        }
+        samples[i].x = (int16_t)xyz[0];
+        samples[i].y = (int16_t)xyz[1];
+        samples[i].z = (int16_t)xyz[2];
+    }
+    if (pos != payload_len) {
+        *used = 1;
+        return ESP_ERR_INVALID_CRC;
+    }
+
+    header->device_id = frame[3];
+    header->rate = frame[4];
+    header->data_format = frame[5];
+    header->seq = (uint16_t)stream_get_le(&frame[6], 2);
+    header->count = count;
+    header->base_us = (int64_t)stream_get_le(&frame[12], 8);
+
+    *used = frame_len;
+    return ESP_OK;
+}
+
+/**
+ * @brief Time between the samples of a frame
+ */
+uint64_t adxl345_stream_sample_period_ns(const adxl345_stream_header_t *header)
+{
+    return 312500ULL << (ADXL345_DATARATE_3200_HZ - (header->rate & 0x0F));
+}
+
+/**
+ * @brief mg per LSB for the frame's data format, same values as adxl345_convert_mg()
+ */
+float adxl345_stream_scale_mg(const adxl345_stream_header_t *header)
+{
+    uint8_t range = header->data_format & 0x03;
+
+    if (header->data_format & 0x04) {                     // JUSTIFY
+        return (float)(4000 << range) / 65536.0f;   // +-range over the full 16 bit
+    }
+    if (header->data_format & 0x08) {                     // FULL_RES
+        return 3.90625f;
+    }
+    return 3.90625f * (float)(1 << range);
+}
+
+/**
+ * @brief Zigzag (0, -1, 1, -2 -> 0, 1, 2, 3) then 7 bits per byte, low first
+ */
+static size_t stream_put_varint(uint8_t *out, int32_t value)
+{
+    uint32_t zz = ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+    size_t n = 0;
+
+    while (zz >= 0x80) {
+        out[n++] = (uint8_t)(zz | 0x80);
+        zz >>= 7;
+    }
+    out[n++] = (uint8_t)zz;
+
+    return n;
+}
+
+static bool stream_get_varint(const uint8_t *in, size_t len, size_t *pos, int32_t *value)
+{
+    uint32_t zz = 0;
+
+    for (int shift = 0; shift <= 28; shift += 7) {
+        if (*pos >= len) {
+            return false;
+        }
+        uint8_t b = in[(*pos)++];
+
+        zz |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *value = (int32_t)(zz >> 1) ^ -(int32_t)(zz & 1);
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void stream_put_le(uint8_t *out, uint64_t value, size_t bytes)
+{
+    for (size_t i = 0; i < bytes; i++) {
+        out[i] = (uint8_t)(value >> (8 * i));
+    }
+}
+
+static uint64_t stream_get_le(const uint8_t *in, size_t bytes)
+{
+    uint64_t value = 0;
+
+    for (size_t i = 0; i < bytes; i++) {
+        value |= (uint64_t)in[i] << (8 * i);
+    }
+
+    return value;
+}
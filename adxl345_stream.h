@@ -0,0 +1,79 @@
+/**
+ * Compact binary sample stream, for getting full 3200 Hz data off the board
+ * through a UART or a socket. A frame is a batch of equally spaced samples:
+ *
+ *   offset  size
+ *   0       2     magic 0xA5 0x5A
+ *   2       1     version
+ *   3       1     device id (yours, to tell sensors apart)
+ *   4       1     BW_RATE rate code, the sample period follows from it
+ *   5       1     DATA_FORMAT, range / FULL_RES / JUSTIFY, the scale follows from it
+ *   6       2     sequence number, a gap means lost frames
+ *   8       2     sample count
+ *   10      2     payload length
+ *   12      8     timestamp of the first sample, us
+ *   20      ...   payload
+ *   end     2     CRC-16/CCITT-FALSE of everything before it
+ *
+ * Little endian. The payload holds per axis zigzag varints: the first sample as is,
+ * then the difference to the previous one. Quiet axes take one byte, so a sample
+ * is about 3-4 bytes instead of 6 raw or ~25 as text: 3200 Hz is ~12 kB/s, fine for
+ * a 230400 baud UART.
+ *
+ * The decoder has no device or ESP-IDF dependency beyond esp_err.h, the host build
+ * uses it for adxl345_stream2csv.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_STREAM_MAGIC0           0xA5
+#define ADXL345_STREAM_MAGIC1           0x5A
+#define ADXL345_STREAM_VERSION          1
+#define ADXL345_STREAM_HEADER_LEN       20
+#define ADXL345_STREAM_CRC_LEN          2
+#define ADXL345_STREAM_MAX_SAMPLES      1024
+#define ADXL345_STREAM_SAMPLE_MAX_LEN   9       ///< 3 axes, a 17 bit delta zigzags into a 3 byte varint
+
+/** @brief Worst case frame size for count samples, size your buffer with it */
+#define ADXL345_STREAM_FRAME_MAX(count) \
+    ((size_t)ADXL345_STREAM_HEADER_LEN + (size_t)(count) * ADXL345_STREAM_SAMPLE_MAX_LEN + ADXL345_STREAM_CRC_LEN)
+
+typedef struct {
+    uint8_t device_id;
+    uint8_t rate;               ///< BW_RATE rate code (adxl345_datarate_t)
+    uint8_t data_format;        ///< DATA_FORMAT register
+    uint16_t seq;
+    uint16_t count;             ///< samples in the frame
+    int64_t base_us;            ///< first sample
+} adxl345_stream_header_t;
+
+/**
+ * @brief Encoder state, one per stream
+ */
+typedef struct {
+    uint8_t device_id;
+    uint16_t seq;               ///< of the next frame
+} adxl345_stream_enc_t;
+
+void adxl345_stream_enc_init(adxl345_stream_enc_t *enc, uint8_t device_id);
+esp_err_t adxl345_stream_encode(adxl345_stream_enc_t *enc, adxl345_dev_t *dev, const adxl345_raw_xyz_t *samples, size_t count,
+                                int64_t base_us, uint8_t *out, size_t out_size, size_t *out_len);
+esp_err_t adxl345_stream_encode_frame(const adxl345_stream_header_t *header, const adxl345_raw_xyz_t *samples,
+                                      uint8_t *out, size_t out_size, size_t *out_len);
+esp_err_t adxl345_stream_decode(const uint8_t *buf, size_t len, adxl345_stream_header_t *header,
+                                adxl345_raw_xyz_t *samples, size_t max_samples, size_t *used);
+uint64_t adxl345_stream_sample_period_ns(const adxl345_stream_header_t *header);
+float adxl345_stream_scale_mg(const adxl345_stream_header_t *header);
+uint16_t adxl345_stream_crc16(const uint8_t *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,291 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_ringbuf.h"
+#include "adxl345_bench.h"
+
+#define BENCH_FIFO_RATE     ADXL345_DATARATE_3200_HZ
+#define BENCH_FIFO_FILL_US  10000               // 32 samples at 3200 Hz
+#define BENCH_RINGBUF_DEPTH 64
+
+
+typedef struct {
+    adxl345_ringbuf_t *rb;
+    adxl345_xyz_iir_t iir;
+    adxl345_raw_xyz_t raw[ADXL345_FIFO_SIZE];   // a FIFO drain worth of samples for the conversion cases
+} bench_state_t;
+
+typedef struct {
+    const char *api;
+    bool fifo;                                  // runs in stream mode at BENCH_FIFO_RATE
+    bool compute;                               // no bus access, only the CPU numbers mean something
+    size_t (*call)(adxl345_dev_t *dev, bench_state_t *state);      // measured, returns the samples it got
+} bench_case_t;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t samples;
+    uint64_t transactions;
+    uint64_t bytes;
+    uint64_t bus_time_ns;
+    int64_t latency_us;
+    uint64_t cpu;
+} bench_result_t;
+
+
+/* prototype static functions */
+
+static size_t bench_get_xyz(adxl345_dev_t *dev, bench_state_t *state);
+static size_t bench_get_accel(adxl345_dev_t *dev, bench_state_t *state);
+static size_t bench_get_accel_iir(adxl345_dev_t *dev, bench_state_t *state);
+static size_t bench_read_fifo(adxl345_dev_t *dev, bench_state_t *state);
+static size_t bench_ringbuf_fill(adxl345_dev_t *dev, bench_state_t *state);
+static size_t bench_convert_mg(adxl345_dev_t *dev, bench_state_t *state);
+static size_t bench_convert_block_mg(adxl345_dev_t *dev, bench_state_t *state);
+static size_t bench_convert_block_ms2(adxl345_dev_t *dev, bench_state_t *state);
+static void bench_bus(const adxl345_bench_env_t *env, adxl345_bench_bus_t *out);
+static double bench_max_odr(double us_per_sample);
+static void bench_print(FILE *out, const adxl345_bench_env_t *env, const bench_case_t *bcase, const bench_result_t *r);
+
+
+static const bench_case_t bench_cases[] = {
+    { "adxl345_get_x+y+z",         false, false, bench_get_xyz },
+    { "adxl345_get_accel",         false, false, bench_get_accel },
+    { "adxl345_get_accel_iir",     false, false, bench_get_accel_iir },
+    { "adxl345_read_fifo",         true,  false, bench_read_fifo },
+    { "adxl345_ringbuf_fill",      true,  false, bench_ringbuf_fill },
+    { "adxl345_convert_mg",        false, true,  bench_convert_mg },
+    { "adxl345_convert_block_mg",  false, true,  bench_convert_block_mg },
+    { "adxl345_convert_block_ms2", false, true,  bench_convert_block_ms2 },
+};
+
+#define BENCH_CASE_COUNT    (sizeof(bench_cases) / sizeof(bench_cases[0]))
+
+
+/**
+ * @brief Run every API env->iterations times and write the results as one JSON object.
+ *        The sensor has to be up (adxl345_begin()), its configuration is restored
+ *        at the end.
+ * @param dev sensor to use
+ * @param env platform clocks and bus counters
+ * @param out where the JSON goes
+ * @return ESP_OK, ESP_ERR_INVALID_ARG, ESP_ERR_NO_MEM or the i2c_manager error
+ */
+esp_err_t adxl345_bench_run(adxl345_dev_t *dev, const adxl345_bench_env_t *env, FILE *out)
+{
+    bench_result_t results[BENCH_CASE_COUNT];
+    bench_state_t state = { 0 };
+    adxl345_config_t saved;
+    esp_err_t err;
+
+    if (dev == NULL || env == NULL || out == NULL || env->time_us == NULL || env->cpu == NULL ||
+            env->wait_us == NULL || env->iterations == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    err = adxl345_ringbuf_create(BENCH_RINGBUF_DEPTH, &state.rb);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    adxl345_get_config(dev, &saved);
+    memset(results, 0, sizeof(results));
+
+    for (size_t i = 0; i < ADXL345_FIFO_SIZE; i++) {
+        state.raw[i].x = (int16_t)(i * 37 - 512);
+        state.raw[i].y = (int16_t)(256 - i * 11);
+        state.raw[i].z = (int16_t)(i * 5 + 200);
+    }
+
+    for (size_t c = 0; c < BENCH_CASE_COUNT && err == ESP_OK; c++) {
+        const bench_case_t *bcase = &bench_cases[c];
+        bench_result_t *r = &results[c];
+
+        if (bcase->fifo) {
+            err = adxl345_set_datarate(dev, BENCH_FIFO_RATE);
+            if (err == ESP_OK) {
+                err = adxl345_set_fifo(dev, ADXL345_FIFO_STREAM);
+            }
+        } else {
+            err = adxl345_set_fifo(dev, ADXL345_FIFO_BYPASS);
+        }
+
+        for (uint32_t i = 0; i < env->iterations && err == ESP_OK; i++) {
+            adxl345_bench_bus_t bus0, bus1;
+            adxl345_sample_t drain[BENCH_RINGBUF_DEPTH];
+
+            if (bcase->fifo) {
+                adxl345_ringbuf_pop(state.rb, drain, BENCH_RINGBUF_DEPTH);
+                env->wait_us(env->arg, BENCH_FIFO_FILL_US);
+            }
+
+            bench_bus(env, &bus0);
+            int64_t t0 = env->time_us();
+            uint64_t c0 = env->cpu();
+
+            size_t samples = bcase->call(dev, &state);
+
+            uint64_t c1 = env->cpu();
+            int64_t t1 = env->time_us();
+            bench_bus(env, &bus1);
+
+            r->calls++;
+            r->samples += samples;
+            r->transactions += bus1.transactions - bus0.transactions;
+            r->bytes += bus1.bytes - bus0.bytes;
+            r->bus_time_ns += bus1.bus_time_ns - bus0.bus_time_ns;
+            r->latency_us += t1 - t0;
+            r->cpu += (c1 - c0) - (bus1.transport_cpu - bus0.transport_cpu);
+        }
+    }
+
+    adxl345_ringbuf_destroy(state.rb);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(__func__, "bench aborted: %s", esp_err_to_name(err));
+        adxl345_apply_config(dev, &saved, false);
+        return err;
+    }
+
+    err = adxl345_apply_config(dev, &saved, false);
+
+    fprintf(out, "{\"schema\":%d,\"platform\":\"%s\",\"bus\":\"%s\",\"bus_hz\":%u,\"cpu_unit\":\"%s\",\"iterations\":%u,\"results\":[",
+            ADXL345_BENCH_SCHEMA, env->platform, env->bus ? env->bus : "i2c", env->bus_hz, env->cpu_unit, env->iterations);
+    for (size_t c = 0; c < BENCH_CASE_COUNT; c++) {
+        bench_print(out, env, &bench_cases[c], &results[c]);
+        fprintf(out, c + 1 < BENCH_CASE_COUNT ? "," : "");
+    }
+
+    // the two only differ by the EMA, the difference is the filter cost
+    fprintf(out, "],\"derived\":{\"filter_cpu_per_sample\":%.1f}}\n",
+            (double)results[2].cpu / results[2].samples - (double)results[1].cpu / results[1].samples);
+
+    return err;
+}
+
+static size_t bench_get_xyz(adxl345_dev_t *dev, bench_state_t *state)
+{
+    int16_t x, y, z;
+
+    (void)state;
+    if (adxl345_get_x(dev, &x) != ESP_OK || adxl345_get_y(dev, &y) != ESP_OK || adxl345_get_z(dev, &z) != ESP_OK) {
+        return 0;
+    }
+    return 1;
+}
+
+static size_t bench_get_accel(adxl345_dev_t *dev, bench_state_t *state)
+{
+    adxl345_xyz_t accel;
+
+    (void)state;
+    return adxl345_get_accel(dev, &accel) == ESP_OK ? 1 : 0;
+}
+
+static size_t bench_get_accel_iir(adxl345_dev_t *dev, bench_state_t *state)
+{
+    return adxl345_get_accel_iir(dev, &state->iir, 0.2f) == ESP_OK ? 1 : 0;
+}
+
+static size_t bench_read_fifo(adxl345_dev_t *dev, bench_state_t *state)
+{
+    adxl345_raw_xyz_t raw[ADXL345_FIFO_SIZE + 1];
+    size_t count = 0;
+
+    (void)state;
+    adxl345_read_fifo(dev, raw, ADXL345_FIFO_SIZE + 1, &count);
+    return count;
+}
+
+static size_t bench_ringbuf_fill(adxl345_dev_t *dev, bench_state_t *state)
+{
+    size_t before = adxl345_ringbuf_count(state->rb);
+
+    adxl345_ringbuf_fill(dev, state->rb, 0);
+    return adxl345_ringbuf_count(state->rb) - before;
+}
+
+static size_t bench_convert_mg(adxl345_dev_t *dev, bench_state_t *state)
+{
+    adxl345_xyz_i32_t mg;
+    volatile int32_t sink = 0;
+
+    // one sample at a time, the way a caller without the block API would do it
+    for (size_t i = 0; i < ADXL345_FIFO_SIZE; i++) {
+        adxl345_convert_mg(dev, &state->raw[i], &mg, 1);
+        sink += mg.x;
+    }
+    (void)sink;
+    return ADXL345_FIFO_SIZE;
+}
+
+static size_t bench_convert_block_mg(adxl345_dev_t *dev, bench_state_t *state)
+{
+    static int32_t x[ADXL345_FIFO_SIZE], y[ADXL345_FIFO_SIZE], z[ADXL345_FIFO_SIZE];
+
+    adxl345_convert_block_mg(dev, state->raw, ADXL345_FIFO_SIZE, x, y, z);
+    return ADXL345_FIFO_SIZE;
+}
+
+static size_t bench_convert_block_ms2(adxl345_dev_t *dev, bench_state_t *state)
+{
+    static float x[ADXL345_FIFO_SIZE], y[ADXL345_FIFO_SIZE], z[ADXL345_FIFO_SIZE];
+
+    adxl345_convert_block_ms2(dev, state->raw, ADXL345_FIFO_SIZE, x, y, z);
+    return ADXL345_FIFO_SIZE;
+}
+
+static void bench_bus(const adxl345_bench_env_t *env, adxl345_bench_bus_t *out)
+{
+    memset(out, 0, sizeof(adxl345_bench_bus_t));
+    if (env->bus_counters != NULL) {
+        env->bus_counters(env->arg, out);
+    }
+}
+
+/**
+ * @brief Highest ADXL345 data rate whose sample period is not shorter than
+ *        the time the read path needs per sample, 0 when even 0.10 Hz is too fast
+ */
+static double bench_max_odr(double us_per_sample)
+{
+    for (int code = ADXL345_DATARATE_3200_HZ; code >= ADXL345_DATARATE_0_10_HZ; code--) {
+        double period_us = 312.5 * (double)(1 << (ADXL345_DATARATE_3200_HZ - code));
+
+        if (period_us >= us_per_sample) {
+            return 1000000.0 / period_us;
+        }
+    }
+    return 0.0;
+}
+
+static void bench_print(FILE *out, const adxl345_bench_env_t *env, const bench_case_t *bcase, const bench_result_t *r)
+{
+    double samples = r->samples ? (double)r->samples : 1.0;
+    double latency_per_sample = (double)r->latency_us / samples;
+
+    fprintf(out, "{\"api\":\"%s\",\"calls\":%llu,\"samples\":%llu,", bcase->api,
+            (unsigned long long)r->calls, (unsigned long long)r->samples);
+
+    if (bcase->compute) {
+        fprintf(out, "\"cpu_per_call\":%.1f,\"cpu_per_sample\":%.1f}", (double)r->cpu / r->calls, (double)r->cpu / samples);
+        return;
+    }
+
+    if (env->bus_counters != NULL) {
+        fprintf(out, "\"transactions_per_sample\":%.3f,\"bytes_per_sample\":%.2f,\"bus_us_per_sample\":%.2f,",
+                (double)r->transactions / samples, (double)r->bytes / samples, (double)r->bus_time_ns / samples / 1000.0);
+    } else {
+        fprintf(out, "\"transactions_per_sample\":null,\"bytes_per_sample\":null,\"bus_us_per_sample\":null,");
+    }
+
+    fprintf(out, "\"latency_us_per_call\":%.2f,\"latency_us_per_sample\":%.2f,\"cpu_per_call\":%.1f,\"cpu_per_sample\":%.1f,"
+            "\"max_rate_hz\":%.1f,\"max_odr_hz\":%.2f}",
+            (double)r->latency_us / r->calls, latency_per_sample, (double)r->cpu / r->calls, (double)r->cpu / samples,
+            latency_per_sample > 0.0 ? 1000000.0 / latency_per_sample : 0.0, bench_max_odr(latency_per_sample));
+}
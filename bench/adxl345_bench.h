@@ -0,0 +1,48 @@
+/**
+ * Per API benchmark of the driver: bus transactions and bytes per sample, latency
+ * per call, CPU cost per call and the highest ODR the read path keeps up with.
+ * Platform neutral, the host build runs it against the simulator
+ * (host/bench_main.c), the target build with the cycle counter (examples/bench).
+ * Results are written as one JSON object per run.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "adxl345.h"
+
+#define ADXL345_BENCH_SCHEMA    1   ///< bump when a JSON field changes meaning
+
+/**
+ * @brief Bus activity since the start of the run, as far as the platform can see it
+ */
+typedef struct {
+    uint32_t transactions;          ///< reads + writes
+    uint64_t bytes;                 ///< payload bytes both ways
+    uint64_t bus_time_ns;           ///< time the bus was busy
+    uint64_t transport_cpu;         ///< CPU spent below the driver (emulation), in cpu_unit, subtracted from the driver cost
+} adxl345_bench_bus_t;
+
+typedef struct {
+    const char *platform;           ///< free text, e.g. "host-sim" or the chip name
+    const char *cpu_unit;           ///< unit of cpu(), "ns" or "cycles"
+    const char *bus;                ///< transport, "i2c" or "spi", NULL is "i2c"
+    uint32_t bus_hz;                ///< SCL / SCLK clock the sensor runs at
+    uint32_t iterations;            ///< calls per API
+    int64_t (*time_us)(void);       ///< latency clock
+    uint64_t (*cpu)(void);          ///< CPU clock, cycle counter on target
+    void (*bus_counters)(void *arg, adxl345_bench_bus_t *out);     ///< NULL when the bus can not be observed
+    void (*wait_us)(void *arg, uint32_t us);                        ///< let the sensor run, fills the FIFO
+    void *arg;                      ///< passed to bus_counters and wait_us
+} adxl345_bench_env_t;
+
+esp_err_t adxl345_bench_run(adxl345_dev_t *dev, const adxl345_bench_env_t *env, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
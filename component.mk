@@ -1 +1,2 @@
-COMPONENT_DEPENDS := i2c_manager
\ No newline at end of file
+COMPONENT_DEPENDS := i2c_manager driver esp_timer
+COMPONENT_PRIV_INCLUDEDIRS := private_include
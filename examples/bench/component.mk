@@ -0,0 +1 @@
+# EMPTY
\ No newline at end of file
@@ -0,0 +1,89 @@
+#include <stdio.h>
+#include <string.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include "esp_cpu.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#include "adxl345.h"
+#include "adxl345_bench.h"
+
+
+
+/*
+    On-target benchmark, prints one JSON line per run on the console.
+    The bus can't be watched here, so transactions/bytes are null and the cycle
+    count includes the time spent waiting in the I2C driver. Compare with the
+    host run (host/bench_main.c) for the bus numbers.
+    Set CONFIG_I2C_MANAGER_0_FREQ_HZ to the bus clock you want to measure.
+*/
+
+
+#define BENCH_ITERATIONS    200
+
+
+static void bench_task(void *vParm);
+static uint64_t bench_cycles(void);
+static void bench_wait_us(void *arg, uint32_t us);
+
+static const char *TAG = "app_main";
+static adxl345_dev_t *accel = NULL;
+
+void app_main(void)
+{
+    adxl345_dev_config_t accel_cfg = ADXL345_DEV_CONFIG_DEFAULT();
+
+    ESP_ERROR_CHECK(adxl345_create(&accel_cfg, &accel));
+
+    if (adxl345_begin(accel) == ESP_OK) {
+        xTaskCreate(bench_task, "bench", 8192, NULL, 5, NULL);
+    } else {
+        ESP_LOGE(TAG, "No sensor, no benchmark");
+    }
+    vTaskDelete(NULL);
+}
+
+
+static void bench_task(void *vParm)
+{
+    adxl345_bench_env_t env = {
+        .platform = CONFIG_IDF_TARGET,
+        .cpu_unit = "cycles",
+        .bus = "i2c",
+        .bus_hz = CONFIG_I2C_MANAGER_0_FREQ_HZ,
+        .iterations = BENCH_ITERATIONS,
+        .time_us = esp_timer_get_time,
+        .cpu = bench_cycles,
+        .bus_counters = NULL,
+        .wait_us = bench_wait_us,
+        .arg = NULL,
+    };
+
+    vTaskDelay(pdMS_TO_TICKS(500));
+    ESP_ERROR_CHECK(adxl345_bench_run(accel, &env, stdout));
+
+    vTaskDelete(NULL);
+}
+
+/**
+ * @brief The cycle counter is 32 bit, extend it, called often enough to never miss a wrap
+ */
+static uint64_t bench_cycles(void)
+{
+    static uint32_t last = 0;
+    static uint64_t total = 0;
+    uint32_t now = (uint32_t)esp_cpu_get_cycle_count();
+
+    total += (uint32_t)(now - last);
+    last = now;
+    return total;
+}
+
+static void bench_wait_us(void *arg, uint32_t us)
+{
+    (void)arg;
+    vTaskDelay(pdMS_TO_TICKS(us / 1000) + 1);
+}
@@ -8,6 +8,7 @@
 #include "sdkconfig.h"
 
 #include "adxl345.h"
+#include "adxl345_selftest.h"
 
 
 
@@ -30,16 +31,21 @@ static TaskHandle_t DataRate1_h = NULL;
 static TaskHandle_t SetGetRange1_h = NULL;
 static TaskHandle_t Axis_h = NULL;
 static const char *TAG = "app_main";
+static adxl345_dev_t *accel = NULL;
 
 void app_main(void)
 {
-    /* selftest req
-        set data rate: 100 <-> 3200 (BW_RATE
-        clear LOW_POWER in BW_RATE reg
-        set to 16G mode
+    adxl345_dev_config_t accel_cfg = ADXL345_DEV_CONFIG_DEFAULT();
 
-    */
-    if (adxl345_begin()) {
+    ESP_ERROR_CHECK(adxl345_create(&accel_cfg, &accel));
+
+    if (adxl345_begin(accel) == ESP_OK) {
+        adxl345_selftest_result_t selftest;
+
+        if (adxl345_selftest_run(accel, NULL, &selftest) != ESP_OK) {
+            ESP_LOGW(TAG, "Self-test failed, delta x: %ld y: %ld z: %ld LSB", (long)selftest.delta.x,
+                     (long)selftest.delta.y, (long)selftest.delta.z);
+        }
         xTaskCreate(adxl345_task, "adxl345_Task", 4096, NULL, 5, &AccelTask_h);
         xTaskCreate(adxl345_setDataRate1, "DR1", 4096, NULL, 5, &DataRate1_h);
         xTaskCreate(adxl345_setgetrange, "Ranges", 4096, NULL, 5, &SetGetRange1_h);
@@ -54,10 +60,10 @@ static void adxl345_task(void *vParm)
 
     vTaskDelay(pdMS_TO_TICKS(100));
 
-    ESP_LOGI(TAG, "Get data rate from sensor: %s", adxl345_get_datarate());
+    ESP_LOGI(TAG, "Get data rate from sensor: %s", adxl345_get_datarate(accel));
     vTaskDelay(pdMS_TO_TICKS(100));
 
-    ESP_LOGI(TAG, "Get data rate from sensor: %s", adxl345_get_datarate());
+    ESP_LOGI(TAG, "Get data rate from sensor: %s", adxl345_get_datarate(accel));
     vTaskDelay(pdMS_TO_TICKS(100));
 
     vTaskDelete(NULL);
@@ -67,10 +73,10 @@ static void adxl345_task(void *vParm)
 static void adxl345_setDataRate1(void *vParm)
 {
     vTaskDelay(pdMS_TO_TICKS(500));
-    adxl345_set_datarate(ADXL345_DATARATE_3200_HZ);
+    ESP_ERROR_CHECK_WITHOUT_ABORT(adxl345_set_datarate(accel, ADXL345_DATARATE_3200_HZ));
 
     vTaskDelay(pdMS_TO_TICKS(100));
-    ESP_LOGI(TAG, "Get data rate from sensor: %s", adxl345_get_datarate());
+    ESP_LOGI(TAG, "Get data rate from sensor: %s", adxl345_get_datarate(accel));
 
     vTaskDelete(NULL);
 
@@ -79,10 +85,10 @@ static void adxl345_setDataRate1(void *vParm)
 static void adxl345_setgetrange(void *vParm)
 {
     vTaskDelay(pdMS_TO_TICKS(1000));
-    ESP_LOGI(TAG, "Read current range from register: %s", adxl345_get_range());
+    ESP_LOGI(TAG, "Read current range from register: %s", adxl345_get_range(accel));
 
-    adxl345_set_range(16);
-    ESP_LOGI(TAG, "Read current range from register: %s.", adxl345_get_range());
+    ESP_ERROR_CHECK_WITHOUT_ABORT(adxl345_set_range(accel, 16));
+    ESP_LOGI(TAG, "Read current range from register: %s.", adxl345_get_range(accel));
 
     vTaskDelete(NULL);
 }
@@ -98,8 +104,11 @@ static void adxl345_getaxis(void *vParm)
 
     while (1) {
 
-        adxl345_get_accel(&axis_data);
-        adxl345_get_accel_iir(&axis_data_iir, 0.01);
+        if (adxl345_get_accel(accel, &axis_data) != ESP_OK ||
+                adxl345_get_accel_iir(accel, &axis_data_iir, 0.01) != ESP_OK) {
+            vTaskDelay(pdMS_TO_TICKS(2000));
+            continue;
+        }
         //ESP_LOGI(__func__, "X-Axis: %d - Y-Axis: %d - Z-Axis: %d", adxl345_get_x(), adxl345_get_y(), adxl345_get_z());
         //ESP_LOGI(__func__, "X: %3d\t\tY: %3d\t\tZ: %3d", axis_data.x, axis_data.y, axis_data.z);
         //  ESP_LOGI(__func__, "\tX: %3.4f\tY: %3.4f\tZ: %3.4f\t|\tXf: %3.4f\tYf: %3.4f\tZf: %3.4fm/s", axis_data.x_ms, axis_data.y_ms, axis_data.z_ms, axis_data_iir.x_ms, axis_data_iir.y_ms, axis_data_iir.z_ms);
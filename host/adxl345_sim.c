@@ -0,0 +1,725 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_log.h"
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_sim.h"
+
+#define SIM_MAX_DEVICES     8
+#define SIM_MAX_GPIO        64
+#define SIM_REG_COUNT       0x3A
+#define SIM_EVENT_BITS      (ADXL345_INT_SINGLE_TAP | ADXL345_INT_DOUBLE_TAP | ADXL345_INT_ACTIVITY | \
+                             ADXL345_INT_INACTIVITY | ADXL345_INT_FREE_FALL)
+
+
+struct adxl345_sim_t {
+    adxl345_sim_config_t config;
+    uint8_t regs[SIM_REG_COUNT];            // written values, the computed registers are built on read
+    adxl345_raw_xyz_t fifo[ADXL345_FIFO_SIZE];
+    uint8_t fifo_count;
+    adxl345_raw_xyz_t output;               // data registers in bypass mode
+    bool data_ready;                        // bypass mode DATA_READY
+    bool overrun;
+    bool triggered;                         // trigger mode FIFO_TRIG
+    uint8_t events;                         // latched tap/activity/free-fall bits
+    uint64_t next_sample_ns;                // virtual time of the next conversion, 0 while in standby
+    uint32_t fail_next;
+    esp_err_t fail_err;
+    bool hung;                              // SDA held low, every transaction times out until a bus clear
+    uint32_t error_rate;                    // per million transactions
+    uint32_t prng;
+    adxl345_sim_counters_t counters;
+};
+
+typedef struct {
+    adxl345_intr_handler_t handler;
+    void *arg;
+    bool enabled;
+} sim_gpio_t;
+
+
+static adxl345_sim_t *sim_devices[SIM_MAX_DEVICES];
+static sim_gpio_t sim_gpio[SIM_MAX_GPIO];
+static uint64_t sim_now_ns;
+static bool sim_in_isr;
+
+
+/* prototype static functions */
+
+static void sim_reset_regs(adxl345_sim_t *sim);
+static void sim_update(adxl345_sim_t *sim);
+static void sim_convert(adxl345_sim_t *sim, adxl345_raw_xyz_t *out);
+static uint8_t sim_int_source(adxl345_sim_t *sim);
+static uint8_t sim_read_reg(adxl345_sim_t *sim, uint8_t reg, const adxl345_raw_xyz_t *data);
+static void sim_write_reg(adxl345_sim_t *sim, uint8_t reg, uint8_t value);
+static uint64_t sim_period_ns(adxl345_sim_t *sim);
+static uint32_t sim_random(adxl345_sim_t *sim);
+static void sim_dispatch_interrupts(void);
+static esp_err_t sim_bus_read(adxl345_sim_t *sim, uint8_t reg, uint8_t *buf, size_t len, uint32_t bus_bits);
+static esp_err_t sim_bus_write(adxl345_sim_t *sim, uint8_t reg, const uint8_t *buf, size_t len, uint32_t bus_bits);
+static uint64_t sim_host_ns(void);
+static void sim_clock_forward(uint64_t ns);
+static esp_err_t sim_shim_attach(int gpio_num, adxl345_intr_handler_t handler, void *arg);
+static esp_err_t sim_shim_detach(int gpio_num);
+static void sim_shim_enable(int gpio_num);
+static void sim_shim_disable(int gpio_num);
+
+
+const adxl345_intr_shim_t adxl345_sim_intr_shim = {
+    .attach = sim_shim_attach,
+    .detach = sim_shim_detach,
+    .enable = sim_shim_enable,
+    .disable = sim_shim_disable,
+};
+
+
+/**
+ * @brief Add a simulated sensor to the bus
+ * @param config see adxl345_sim_config_t
+ * @param out_sim the new sensor
+ * @return ESP_OK, ESP_ERR_INVALID_STATE when the address is taken or the bus is full, ESP_ERR_NO_MEM
+ */
+esp_err_t adxl345_sim_create(const adxl345_sim_config_t *config, adxl345_sim_t **out_sim)
+{
+    int slot = -1;
+
+    if (config == NULL || out_sim == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (adxl345_sim_find(config->i2c_port, config->i2c_address) != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    for (int i = 0; i < SIM_MAX_DEVICES; i++) {
+        if (sim_devices[i] == NULL) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    adxl345_sim_t *sim = calloc(1, sizeof(adxl345_sim_t));
+    if (sim == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    sim->config = *config;
+    if (sim->config.bus_hz == 0) {
+        sim->config.bus_hz = 400000;
+    }
+    sim->prng = config->seed ? config->seed : 1;
+    sim_reset_regs(sim);
+
+    sim_devices[slot] = sim;
+    *out_sim = sim;
+    return ESP_OK;
+}
+
+/**
+ * @brief Remove a simulated sensor from the bus
+ */
+void adxl345_sim_destroy(adxl345_sim_t *sim)
+{
+    for (int i = 0; i < SIM_MAX_DEVICES; i++) {
+        if (sim_devices[i] == sim) {
+            sim_devices[i] = NULL;
+        }
+    }
+    free(sim);
+}
+
+/**
+ * @brief Sensor answering on port/address, NULL when nobody does (NACK)
+ */
+adxl345_sim_t *adxl345_sim_find(int i2c_port, uint8_t i2c_address)
+{
+    for (int i = 0; i < SIM_MAX_DEVICES; i++) {
+        adxl345_sim_t *sim = sim_devices[i];
+
+        if (sim != NULL && sim->config.i2c_port == i2c_port && sim->config.i2c_address == i2c_address) {
+            return sim;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Virtual time since start, the host esp_timer_get_time() returns this
+ */
+int64_t adxl345_sim_time_us(void)
+{
+    return (int64_t)(sim_now_ns / 1000);
+}
+
+/**
+ * @brief Let time pass: conversions happen at the ODR and active INT lines call their handler
+ */
+void adxl345_sim_advance_us(uint64_t us)
+{
+    sim_clock_forward(us * 1000);
+}
+
+/**
+ * @brief Register read as seen on the bus. The data registers are latched at the
+ *        start of the transaction, a read that reaches DATAZ1 pops the FIFO.
+ * @param reg first register, auto-increments
+ * @param buf where to store the values
+ * @param len number of registers
+ * @param bus_bits length of the transaction on the wire, sets how much time passes
+ * @return ESP_OK or the injected error
+ */
+esp_err_t adxl345_sim_bus_read(adxl345_sim_t *sim, uint8_t reg, uint8_t *buf, size_t len, uint32_t bus_bits)
+{
+    uint64_t start = sim_host_ns();
+    esp_err_t err = sim_bus_read(sim, reg, buf, len, bus_bits);
+
+    sim->counters.host_ns += sim_host_ns() - start;
+    return err;
+}
+
+/**
+ * @brief Register write as seen on the bus, read-only registers ignore the byte
+ * @param reg first register, auto-increments
+ * @param buf values to write
+ * @param len number of registers
+ * @param bus_bits length of the transaction on the wire
+ * @return ESP_OK or the injected error
+ */
+esp_err_t adxl345_sim_bus_write(adxl345_sim_t *sim, uint8_t reg, const uint8_t *buf, size_t len, uint32_t bus_bits)
+{
+    uint64_t start = sim_host_ns();
+    esp_err_t err = sim_bus_write(sim, reg, buf, len, bus_bits);
+
+    sim->counters.host_ns += sim_host_ns() - start;
+    return err;
+}
+
+static esp_err_t sim_bus_read(adxl345_sim_t *sim, uint8_t reg, uint8_t *buf, size_t len, uint32_t bus_bits)
+{
+    uint64_t xfer_ns = (uint64_t)bus_bits * 1000000000ULL / sim->config.bus_hz + sim->config.xfer_overhead_us * 1000ULL;
+    bool fifo_mode = (sim->regs[ADXL345_REG_FIFO_CTL] & 0xC0) != 0;
+    bool data_read = false;
+    bool pop = false;
+    adxl345_raw_xyz_t latched;
+
+    sim_update(sim);
+
+    sim->counters.transactions++;
+    sim->counters.reads++;
+    sim->counters.bus_time_ns += xfer_ns;
+
+    if (sim->hung || sim->fail_next > 0 || (sim->error_rate && sim_random(sim) % 1000000 < sim->error_rate)) {
+        esp_err_t err = sim->hung ? ESP_ERR_TIMEOUT : sim->fail_next > 0 ? sim->fail_err : ESP_FAIL;
+
+        if (sim->fail_next > 0) {
+            sim->fail_next--;
+        }
+        sim->counters.errors_injected++;
+        sim_clock_forward(xfer_ns);
+        return err;
+    }
+
+    latched = (fifo_mode && sim->fifo_count > 0) ? sim->fifo[0] : sim->output;
+
+    for (size_t i = 0; i < len; i++) {
+        uint8_t r = reg + i;
+
+        buf[i] = sim_read_reg(sim, r, &latched);
+        if (r >= ADXL345_REG_DATAX0 && r <= ADXL345_REG_DATAZ1) {
+            data_read = true;
+        }
+        if (r == ADXL345_REG_DATAZ1) {
+            pop = true;
+        }
+        if (r == ADXL345_REG_INT_SOURCE) {
+            sim->events = 0;                // tap/activity/free-fall clear on INT_SOURCE read
+        }
+    }
+    sim->counters.bytes_read += len;
+
+    if (data_read) {
+        sim->overrun = false;
+        if (!fifo_mode) {
+            sim->data_ready = false;
+        } else if (pop && sim->fifo_count > 0) {
+            memmove(&sim->fifo[0], &sim->fifo[1], (sim->fifo_count - 1) * sizeof(adxl345_raw_xyz_t));
+            sim->fifo_count--;
+        }
+    }
+
+    sim_clock_forward(xfer_ns);
+    return ESP_OK;
+}
+
+static esp_err_t sim_bus_write(adxl345_sim_t *sim, uint8_t reg, const uint8_t *buf, size_t len, uint32_t bus_bits)
+{
+    uint64_t xfer_ns = (uint64_t)bus_bits * 1000000000ULL / sim->config.bus_hz + sim->config.xfer_overhead_us * 1000ULL;
+
+    sim_update(sim);
+
+    sim->counters.transactions++;
+    sim->counters.writes++;
+    sim->counters.bus_time_ns += xfer_ns;
+
+    if (sim->hung || sim->fail_next > 0 || (sim->error_rate && sim_random(sim) % 1000000 < sim->error_rate)) {
+        esp_err_t err = sim->hung ? ESP_ERR_TIMEOUT : sim->fail_next > 0 ? sim->fail_err : ESP_FAIL;
+
+        if (sim->fail_next > 0) {
+            sim->fail_next--;
+        }
+        sim->counters.errors_injected++;
+        sim_clock_forward(xfer_ns);
+        return err;
+    }
+
+    for (size_t i = 0; i < len; i++) {
+        sim_write_reg(sim, reg + i, buf[i]);
+    }
+    sim->counters.bytes_written += len;
+
+    sim_clock_forward(xfer_ns);
+    return ESP_OK;
+}
+
+/**
+ * @brief Fail the next count transactions with err
+ */
+void adxl345_sim_fail_next(adxl345_sim_t *sim, uint32_t count, esp_err_t err)
+{
+    sim->fail_next = count;
+    sim->fail_err = err;
+}
+
+/**
+ * @brief Hang the bus like a slave holding SDA low: every transaction times out
+ *        until adxl345_sim_bus_clear()
+ */
+void adxl345_sim_hang_bus(adxl345_sim_t *sim)
+{
+    sim->hung = true;
+}
+
+/**
+ * @brief Bus clear as a transport does it (9 SCL pulses + STOP), releases a hung bus
+ * @return ESP_OK
+ */
+esp_err_t adxl345_sim_bus_clear(adxl345_sim_t *sim)
+{
+    sim->hung = false;
+    sim->counters.bus_clears++;
+    sim_clock_forward(10 * 10000);          // 10 clocks at 100 kHz
+    return ESP_OK;
+}
+
+/**
+ * @brief Fail transactions at random (seeded, so still deterministic)
+ * @param per_million 0 turns it off
+ */
+void adxl345_sim_set_error_rate(adxl345_sim_t *sim, uint32_t per_million)
+{
+    sim->error_rate = per_million;
+}
+
+/**
+ * @brief Change the input signal, NULL for a sensor lying flat
+ */
+void adxl345_sim_set_signal(adxl345_sim_t *sim, adxl345_sim_signal_t signal, void *arg)
+{
+    sim_update(sim);
+    sim->config.signal = signal;
+    sim->config.signal_arg = arg;
+}
+
+/**
+ * @brief Latch tap/activity/free-fall bits in INT_SOURCE, as the sensor would on detection
+ * @param int_bits ADXL345_INT_SINGLE_TAP ... ADXL345_INT_FREE_FALL
+ * @param act_tap_status value for ACT_TAP_STATUS (source axes)
+ */
+void adxl345_sim_raise_event(adxl345_sim_t *sim, uint8_t int_bits, uint8_t act_tap_status)
+{
+    sim_update(sim);
+    sim->events |= int_bits & SIM_EVENT_BITS;
+    sim->regs[ADXL345_REG_ACT_TAP_STATUS] = act_tap_status;
+    if ((sim->regs[ADXL345_REG_FIFO_CTL] >> 6) == ADXL345_FIFO_TRIGGER && (int_bits & SIM_EVENT_BITS)) {
+        sim->triggered = true;              // the FIFO keeps what it holds from now on
+    }
+    sim_dispatch_interrupts();
+}
+
+/**
+ * @brief Brownout: every register back to its power-on value, FIFO emptied
+ */
+void adxl345_sim_power_cycle(adxl345_sim_t *sim)
+{
+    sim_reset_regs(sim);
+}
+
+/**
+ * @brief Register value without a bus transaction, nothing is cleared or popped
+ */
+uint8_t adxl345_sim_peek_reg(adxl345_sim_t *sim, uint8_t reg)
+{
+    bool fifo_mode;
+    adxl345_raw_xyz_t latched;
+
+    sim_update(sim);
+    fifo_mode = (sim->regs[ADXL345_REG_FIFO_CTL] & 0xC0) != 0;
+    latched = (fifo_mode && sim->fifo_count > 0) ? sim->fifo[0] : sim->output;
+
+    return sim_read_reg(sim, reg, &latched);
+}
+
+/**
+ * @brief Samples waiting in the FIFO
+ */
+uint8_t adxl345_sim_fifo_count(adxl345_sim_t *sim)
+{
+    sim_update(sim);
+    return sim->fifo_count;
+}
+
+/**
+ * @brief Is the INT1/INT2 line asserted
+ */
+bool adxl345_sim_int_active(adxl345_sim_t *sim, adxl345_int_pin_t pin)
+{
+    uint8_t active;
+
+    sim_update(sim);
+    active = sim_int_source(sim) & sim->regs[ADXL345_REG_INT_ENABLE];
+
+    if (pin == ADXL345_INT2) {
+        return (active & sim->regs[ADXL345_REG_INT_MAP]) != 0;
+    }
+    return (active & ~sim->regs[ADXL345_REG_INT_MAP]) != 0;
+}
+
+void adxl345_sim_get_counters(adxl345_sim_t *sim, adxl345_sim_counters_t *counters)
+{
+    *counters = sim->counters;
+}
+
+void adxl345_sim_reset_counters(adxl345_sim_t *sim)
+{
+    memset(&sim->counters, 0, sizeof(sim->counters));
+}
+
+
+/* <=====================================================================================> */
+
+/*
+        SENSOR MODEL
+
+*/
+
+static void sim_reset_regs(adxl345_sim_t *sim)
+{
+    memset(sim->regs, 0, sizeof(sim->regs));
+    sim->regs[ADXL345_REG_DEVID] = ADXL345_REG_RETURN_DEVID;
+    sim->regs[ADXL345_REG_BW_RATE] = ADXL345_DATARATE_100_HZ;
+    sim->fifo_count = 0;
+    sim->output = (adxl345_raw_xyz_t) { 0 };
+    sim->data_ready = false;
+    sim->overrun = false;
+    sim->triggered = false;
+    sim->events = 0;
+    sim->next_sample_ns = 0;
+}
+
+static uint64_t sim_period_ns(adxl345_sim_t *sim)
+{
+    return 312500ULL << (ADXL345_DATARATE_3200_HZ - (sim->regs[ADXL345_REG_BW_RATE] & 0x0F));
+}
+
+static uint32_t sim_random(adxl345_sim_t *sim)
+{
+    // xorshift32
+    sim->prng ^= sim->prng << 13;
+    sim->prng ^= sim->prng >> 17;
+    sim->prng ^= sim->prng << 5;
+    return sim->prng;
+}
+
+/**
+ * @brief Run the conversions that were due up to now
+ */
+static void sim_update(adxl345_sim_t *sim)
+{
+    bool measuring = (sim->regs[ADXL345_REG_POWER_CTL] & 0x08) != 0;
+
+    if (!measuring) {
+        sim->next_sample_ns = 0;
+        return;
+    }
+    if (sim->next_sample_ns == 0) {
+        sim->next_sample_ns = sim_now_ns + sim_period_ns(sim);
+    }
+
+    while (sim->next_sample_ns <= sim_now_ns) {
+        uint8_t mode = sim->regs[ADXL345_REG_FIFO_CTL] >> 6;
+        adxl345_raw_xyz_t sample;
+
+        sim_convert(sim, &sample);
+        sim->counters.samples_generated++;
+
+        sim->output = sample;                   // the output register follows in every mode, the FIFO is fed from it
+        if (mode == ADXL345_FIFO_BYPASS) {
+            if (sim->data_ready) {
+                sim->overrun = true;
+                sim->counters.overruns++;
+            }
+            sim->data_ready = true;
+        } else if (sim->fifo_count < ADXL345_FIFO_SIZE) {
+            sim->fifo[sim->fifo_count++] = sample;
+        } else if (mode == ADXL345_FIFO_FIFO || (mode == ADXL345_FIFO_TRIGGER && sim->triggered)) {
+            sim->overrun = true;                // full, new samples are lost
+            sim->counters.overruns++;
+        } else {
+            memmove(&sim->fifo[0], &sim->fifo[1], (ADXL345_FIFO_SIZE - 1) * sizeof(adxl345_raw_xyz_t));
+            sim->fifo[ADXL345_FIFO_SIZE - 1] = sample;
+            sim->overrun = true;
+            sim->counters.overruns++;
+        }
+
+        sim->next_sample_ns += sim_period_ns(sim);
+    }
+}
+
+/**
+ * @brief One conversion: input signal + self-test + offsets, scaled to the DATA_FORMAT
+ */
+static void sim_convert(adxl345_sim_t *sim, adxl345_raw_xyz_t *out)
+{
+    uint8_t data_format = sim->regs[ADXL345_REG_DATA_FORMAT];
+    uint8_t range = data_format & 0x03;
+    bool full_res = (data_format & 0x08) != 0;
+    bool justify = (data_format & 0x04) != 0;
+    int bits = full_res ? 10 + range : 10;
+    int32_t limit = 1 << (bits - 1);
+    int32_t mg[3] = { 0, 0, 1000 };
+    int16_t *axis[3] = { &out->x, &out->y, &out->z };
+
+    if (sim->config.signal != NULL) {
+        sim->config.signal(sim->config.signal_arg, (int64_t)(sim->next_sample_ns / 1000), mg);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        // mg -> 1/256 g LSB, 4 times coarser per range step when not in full resolution
+        int64_t value = (int64_t)mg[i];
+
+        if (sim->config.noise_mg) {
+            value += (int64_t)(sim_random(sim) % (2 * sim->config.noise_mg + 1)) - sim->config.noise_mg;
+        }
+        if (data_format & 0x80) {
+            value += sim->config.selftest_mg[i];
+        }
+
+        int64_t lsb = (value * 256 + (value >= 0 ? 500 : -500)) / 1000;
+        lsb += (int64_t)(int8_t)sim->regs[ADXL345_REG_OFSX + i] * 4;    // 15.6 mg = 4 LSB at 3.9 mg
+        if (!full_res) {
+            lsb >>= range;
+        }
+        if (lsb >= limit) {
+            lsb = limit - 1;
+        } else if (lsb < -limit) {
+            lsb = -limit;
+        }
+        if (justify) {
+            lsb *= 1 << (16 - bits);
+        }
+        *axis[i] = (int16_t)lsb;
+    }
+}
+
+static uint8_t sim_int_source(adxl345_sim_t *sim)
+{
+    uint8_t mode = sim->regs[ADXL345_REG_FIFO_CTL] >> 6;
+    uint8_t watermark = sim->regs[ADXL345_REG_FIFO_CTL] & 0x1F;
+    uint8_t source = sim->events;
+
+    if (mode == ADXL345_FIFO_BYPASS) {
+        if (sim->data_ready) {
+            source |= ADXL345_INT_DATA_READY;
+        }
+    } else {
+        if (sim->fifo_count > 0) {
+            source |= ADXL345_INT_DATA_READY;
+        }
+        if (sim->fifo_count >= watermark) {
+            source |= ADXL345_INT_WATERMARK;
+        }
+    }
+    if (sim->overrun) {
+        source |= ADXL345_INT_OVERRUN;
+    }
+
+    return source;
+}
+
+static uint8_t sim_read_reg(adxl345_sim_t *sim, uint8_t reg, const adxl345_raw_xyz_t *data)
+{
+    switch (reg) {
+    case ADXL345_REG_INT_SOURCE:
+        return sim_int_source(sim);
+    case ADXL345_REG_DATAX0:
+        return (uint16_t)data->x & 0xFF;
+    case ADXL345_REG_DATAX1:
+        return (uint16_t)data->x >> 8;
+    case ADXL345_REG_DATAY0:
+        return (uint16_t)data->y & 0xFF;
+    case ADXL345_REG_DATAY1:
+        return (uint16_t)data->y >> 8;
+    case ADXL345_REG_DATAZ0:
+        return (uint16_t)data->z & 0xFF;
+    case ADXL345_REG_DATAZ1:
+        return (uint16_t)data->z >> 8;
+    case ADXL345_REG_FIFO_STATUS:
+        return (sim->triggered ? 0x80 : 0x00) | sim->fifo_count;
+    default:
+        return reg < SIM_REG_COUNT ? sim->regs[reg] : 0x00;
+    }
+}
+
+static void sim_write_reg(adxl345_sim_t *sim, uint8_t reg, uint8_t value)
+{
+    bool writable = (reg >= ADXL345_REG_THRESH_TAP && reg <= ADXL345_REG_TAP_AXES) ||
+                    (reg >= ADXL345_REG_BW_RATE && reg <= ADXL345_REG_INT_MAP) ||
+                    reg == ADXL345_REG_DATA_FORMAT || reg == ADXL345_REG_FIFO_CTL;
+
+    if (!writable) {
+        return;
+    }
+
+    if (reg == ADXL345_REG_BW_RATE && (value & 0x0F) != (sim->regs[reg] & 0x0F)) {
+        sim->next_sample_ns = 0;            // restart the conversion timing at the new rate
+    }
+    if (reg == ADXL345_REG_FIFO_CTL && (value >> 6) == ADXL345_FIFO_BYPASS) {
+        sim->fifo_count = 0;                // bypass clears the FIFO
+        sim->triggered = false;
+    }
+
+    sim->regs[reg] = value;
+    sim_update(sim);
+}
+
+/**
+ * @brief Move the clock forward, converting and raising interrupts on the way.
+ *        Conversions are run one sample period at a time so an ISR sees the FIFO
+ *        at the moment its line went active.
+ */
+static void sim_clock_forward(uint64_t ns)
+{
+    uint64_t end = sim_now_ns + ns;
+
+    while (sim_now_ns < end) {
+        uint64_t next = end;
+
+        for (int i = 0; i < SIM_MAX_DEVICES; i++) {
+            adxl345_sim_t *sim = sim_devices[i];
+
+            if (sim != NULL && sim->next_sample_ns != 0 && sim->next_sample_ns > sim_now_ns && sim->next_sample_ns < next) {
+                next = sim->next_sample_ns;
+            }
+        }
+
+        sim_now_ns = next;
+        for (int i = 0; i < SIM_MAX_DEVICES; i++) {
+            if (sim_devices[i] != NULL) {
+                sim_update(sim_devices[i]);
+            }
+        }
+        sim_dispatch_interrupts();
+    }
+}
+
+/**
+ * @brief Call the handler of every enabled GPIO whose INT line is active, like a level triggered ISR
+ */
+static void sim_dispatch_interrupts(void)
+{
+    if (sim_in_isr) {
+        return;
+    }
+    sim_in_isr = true;
+
+    for (int i = 0; i < SIM_MAX_DEVICES; i++) {
+        adxl345_sim_t *sim = sim_devices[i];
+
+        if (sim == NULL) {
+            continue;
+        }
+
+        int gpio[2] = { sim->config.int1_gpio, sim->config.int2_gpio };
+
+        for (int pin = 0; pin < 2; pin++) {
+            if (gpio[pin] < 0 || gpio[pin] >= SIM_MAX_GPIO) {
+                continue;
+            }
+            sim_gpio_t *line = &sim_gpio[gpio[pin]];
+
+            if (line->handler != NULL && line->enabled && adxl345_sim_int_active(sim, (adxl345_int_pin_t)pin)) {
+                line->handler(line->arg);
+            }
+        }
+    }
+
+    sim_in_isr = false;
+}
+
+
+/* <=====================================================================================> */
+
+/*
+        GPIO SHIM
+
+*/
+
+static esp_err_t sim_shim_attach(int gpio_num, adxl345_intr_handler_t handler, void *arg)
+{
+    if (gpio_num < 0 || gpio_num >= SIM_MAX_GPIO) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sim_gpio[gpio_num] = (sim_gpio_t) { .handler = handler, .arg = arg, .enabled = true };
+    sim_dispatch_interrupts();
+    return ESP_OK;
+}
+
+static esp_err_t sim_shim_detach(int gpio_num)
+{
+    if (gpio_num < 0 || gpio_num >= SIM_MAX_GPIO) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    sim_gpio[gpio_num] = (sim_gpio_t) { 0 };
+    return ESP_OK;
+}
+
+static void sim_shim_enable(int gpio_num)
+{
+    if (gpio_num >= 0 && gpio_num < SIM_MAX_GPIO) {
+        sim_gpio[gpio_num].enabled = true;
+        sim_dispatch_interrupts();
+    }
+}
+
+static void sim_shim_disable(int gpio_num)
+{
+    if (gpio_num >= 0 && gpio_num < SIM_MAX_GPIO) {
+        sim_gpio[gpio_num].enabled = false;
+    }
+}
+
+static uint64_t sim_host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
@@ -0,0 +1,112 @@
+/**
+ * Register level ADXL345 simulator for host builds.
+ *
+ * Every simulated sensor sits on an (I2C port, address) pair and answers the
+ * i2c_manager stand-in, or any transport from adxl345_sim_bus(). A single virtual clock drives all of them: bus
+ * transactions advance it by their bit time at the configured bus clock, delays
+ * and adxl345_sim_advance_us() move it explicitly. Nothing depends on wall-clock
+ * time, so every run is deterministic.
+ *
+ * Modelled: ODR timing, FIFO bypass/fifo/stream/trigger with watermark and
+ * overrun, INT_SOURCE/INT_ENABLE/INT_MAP with the INT1/INT2 lines, DATA_FORMAT
+ * range/FULL_RES/JUSTIFY scaling, OFSX/Y/Z, self-test deltas, power cycling,
+ * injected bus errors, a hung bus and per-transaction latency, transaction/byte counters.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "adxl345.h"
+#include "adxl345_intr.h"
+#include "adxl345_bus.h"
+
+typedef struct adxl345_sim_t adxl345_sim_t;
+
+/**
+ * @brief Acceleration seen by the sensor at time_us, in mg
+ */
+typedef void (*adxl345_sim_signal_t)(void *arg, int64_t time_us, int32_t accel_mg[3]);
+
+typedef struct {
+    int i2c_port;                   ///< port the sensor answers on
+    uint8_t i2c_address;            ///< address the sensor answers on
+    int int1_gpio;                  ///< GPIO number of INT1 for adxl345_sim_intr_shim, -1 when not wired
+    int int2_gpio;                  ///< GPIO number of INT2 for adxl345_sim_intr_shim, -1 when not wired
+    uint32_t bus_hz;                ///< SCL / SCLK clock used to time transactions
+    uint32_t xfer_overhead_us;      ///< fixed latency added to every transaction
+    adxl345_sim_signal_t signal;    ///< input signal, NULL for a sensor lying flat (0, 0, +1000 mg)
+    void *signal_arg;               ///< passed to signal
+    int32_t selftest_mg[3];         ///< output change while SELF_TEST is set
+    uint32_t noise_mg;              ///< peak uniform noise added to every sample
+    uint32_t seed;                  ///< noise and error-rate PRNG seed
+} adxl345_sim_config_t;
+
+#define ADXL345_SIM_CONFIG_DEFAULT() {              \
+    .i2c_port = 0,                                  \
+    .i2c_address = ADXL345_DEFAULT_ADDRESS,         \
+    .int1_gpio = -1,                                \
+    .int2_gpio = -1,                                \
+    .bus_hz = 400000,                               \
+    .xfer_overhead_us = 0,                          \
+    .signal = NULL,                                 \
+    .signal_arg = NULL,                             \
+    .selftest_mg = { 1000, -1000, 1500 },           \
+    .noise_mg = 0,                                  \
+    .seed = 1,                                      \
+}
+
+/**
+ * @brief What the sensor saw on its bus since create or the last reset
+ */
+typedef struct {
+    uint32_t transactions;          ///< every read or write, failed ones included
+    uint32_t reads;                 ///< read transactions
+    uint32_t writes;                ///< write transactions
+    uint64_t bytes_read;            ///< payload bytes sent by the sensor
+    uint64_t bytes_written;         ///< payload bytes received by the sensor
+    uint64_t bus_time_ns;           ///< time spent on the bus
+    uint64_t host_ns;               ///< real host CPU time spent emulating the bus, for benchmarks to subtract
+    uint32_t errors_injected;       ///< transactions failed on purpose
+    uint32_t bus_clears;            ///< adxl345_sim_bus_clear() calls
+    uint32_t samples_generated;     ///< conversions done at the ODR
+    uint32_t overruns;              ///< samples lost to a full FIFO / unread data register
+} adxl345_sim_counters_t;
+
+esp_err_t adxl345_sim_create(const adxl345_sim_config_t *config, adxl345_sim_t **out_sim);
+void adxl345_sim_destroy(adxl345_sim_t *sim);
+adxl345_sim_t *adxl345_sim_find(int i2c_port, uint8_t i2c_address);
+
+int64_t adxl345_sim_time_us(void);
+void adxl345_sim_advance_us(uint64_t us);
+
+esp_err_t adxl345_sim_bus_read(adxl345_sim_t *sim, uint8_t reg, uint8_t *buf, size_t len, uint32_t bus_bits);
+esp_err_t adxl345_sim_bus_write(adxl345_sim_t *sim, uint8_t reg, const uint8_t *buf, size_t len, uint32_t bus_bits);
+
+void adxl345_sim_fail_next(adxl345_sim_t *sim, uint32_t count, esp_err_t err);
+void adxl345_sim_hang_bus(adxl345_sim_t *sim);
+esp_err_t adxl345_sim_bus_clear(adxl345_sim_t *sim);
+void adxl345_sim_set_error_rate(adxl345_sim_t *sim, uint32_t per_million);
+void adxl345_sim_set_signal(adxl345_sim_t *sim, adxl345_sim_signal_t signal, void *arg);
+void adxl345_sim_raise_event(adxl345_sim_t *sim, uint8_t int_bits, uint8_t act_tap_status);
+void adxl345_sim_power_cycle(adxl345_sim_t *sim);
+uint8_t adxl345_sim_peek_reg(adxl345_sim_t *sim, uint8_t reg);
+uint8_t adxl345_sim_fifo_count(adxl345_sim_t *sim);
+bool adxl345_sim_int_active(adxl345_sim_t *sim, adxl345_int_pin_t pin);
+void adxl345_sim_get_counters(adxl345_sim_t *sim, adxl345_sim_counters_t *counters);
+void adxl345_sim_reset_counters(adxl345_sim_t *sim);
+
+/* transport straight into the simulator, SPI or I2C framing (host/bus_sim.c) */
+void adxl345_sim_bus(adxl345_sim_t *sim, bool spi, adxl345_bus_t *out_bus);
+
+/* GPIO shim for adxl345_intr_start(), the simulator calls the handler while an INT line is active */
+extern const adxl345_intr_shim_t adxl345_sim_intr_shim;
+
+#ifdef __cplusplus
+}
+#endif
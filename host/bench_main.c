@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "adxl345.h"
+#include "adxl345_sim.h"
+#include "adxl345_bench.h"
+
+/**
+ * Host benchmark: runs adxl345_bench_run() against the simulator once per bus clock
+ * (I2C through i2c_manager, SPI through the simulator transport) and prints a JSON
+ * array of the runs on stdout.
+ * Latency is simulated bus time, CPU is real host time with the simulator's own
+ * time taken out, so it is the cost of the driver code on this machine.
+ *
+ *   adxl345_bench [--iterations N] [--overhead-us N] [--bus-hz HZ]... [--spi-hz HZ]...
+ */
+
+#define BENCH_MAX_CLOCKS    8
+
+
+static uint64_t bench_cpu_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_sim_counters(void *arg, adxl345_bench_bus_t *out)
+{
+    adxl345_sim_counters_t counters;
+
+    adxl345_sim_get_counters((adxl345_sim_t *)arg, &counters);
+    out->transactions = counters.transactions;
+    out->bytes = counters.bytes_read + counters.bytes_written;
+    out->bus_time_ns = counters.bus_time_ns;
+    out->transport_cpu = counters.host_ns;
+}
+
+static void bench_sim_wait(void *arg, uint32_t us)
+{
+    (void)arg;
+    adxl345_sim_advance_us(us);
+}
+
+static int bench_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [--iterations N] [--overhead-us N] [--bus-hz HZ]... [--spi-hz HZ]...\n", prog);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t clocks[BENCH_MAX_CLOCKS] = { 100000, 400000 };
+    bool spi[BENCH_MAX_CLOCKS] = { false, false };
+    size_t clock_count = 2;
+    bool clocks_given = false;
+    uint32_t iterations = 1000;
+    uint32_t overhead_us = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) {
+            return bench_usage(argv[0]);
+        }
+        if (strcmp(argv[i], "--iterations") == 0) {
+            iterations = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--overhead-us") == 0) {
+            overhead_us = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else if (strcmp(argv[i], "--bus-hz") == 0 || strcmp(argv[i], "--spi-hz") == 0) {
+            if (!clocks_given) {
+                clocks_given = true;
+                clock_count = 0;
+            }
+            if (clock_count == BENCH_MAX_CLOCKS) {
+                return bench_usage(argv[0]);
+            }
+            spi[clock_count] = strcmp(argv[i], "--spi-hz") == 0;
+            clocks[clock_count++] = (uint32_t)strtoul(argv[++i], NULL, 0);
+        } else {
+            return bench_usage(argv[0]);
+        }
+    }
+
+    if (iterations == 0) {
+        return bench_usage(argv[0]);
+    }
+
+    printf("[\n");
+    for (size_t i = 0; i < clock_count; i++) {
+        adxl345_sim_config_t sim_config = ADXL345_SIM_CONFIG_DEFAULT();
+        adxl345_dev_config_t dev_config = ADXL345_DEV_CONFIG_DEFAULT();
+        adxl345_bus_t bus;
+        adxl345_sim_t *sim;
+        adxl345_dev_t *dev;
+        esp_err_t err;
+
+        if (clocks[i] == 0) {
+            return bench_usage(argv[0]);
+        }
+
+        sim_config.bus_hz = clocks[i];
+        sim_config.xfer_overhead_us = overhead_us;
+        ESP_ERROR_CHECK(adxl345_sim_create(&sim_config, &sim));
+        if (spi[i]) {
+            adxl345_sim_bus(sim, true, &bus);
+            dev_config.bus = &bus;
+        }
+        ESP_ERROR_CHECK(adxl345_create(&dev_config, &dev));
+
+        if (adxl345_begin(dev) != ESP_OK) {
+            fprintf(stderr, "adxl345_begin failed\n");
+            return 1;
+        }
+
+        adxl345_bench_env_t env = {
+            .platform = "host-sim",
+            .cpu_unit = "ns",
+            .bus = spi[i] ? "spi" : "i2c",
+            .bus_hz = clocks[i],
+            .iterations = iterations,
+            .time_us = esp_timer_get_time,
+            .cpu = bench_cpu_ns,
+            .bus_counters = bench_sim_counters,
+            .wait_us = bench_sim_wait,
+            .arg = sim,
+        };
+
+        err = adxl345_bench_run(dev, &env, stdout);
+        if (err != ESP_OK) {
+            fprintf(stderr, "bench failed: %s\n", esp_err_to_name(err));
+            return 1;
+        }
+        if (i + 1 < clock_count) {
+            printf(",\n");
+        }
+
+        adxl345_destroy(dev);
+        adxl345_sim_destroy(sim);
+    }
+    printf("]\n");
+
+    return 0;
+}
@@ -0,0 +1,71 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "adxl345_bus.h"
+#include "adxl345_sim.h"
+
+/**
+ * adxl345_bus_t mock transports straight into a simulated sensor, bypassing i2c_manager.
+ * Bit counts per transaction, at the simulator's bus_hz:
+ *   I2C: same framing as i2c_manager_sim.c
+ *   SPI: address byte + len data bytes, plus one clock each for CS setup and hold
+ */
+#define I2C_BITS_WRITE(len)     (1 + 9 + 9 + 9 * (len) + 1)
+#define I2C_BITS_READ(len)      (1 + 9 + 9 + 1 + 9 + 9 * (len) + 1)
+#define SPI_BITS(len)           (1 + 8 + 8 * (len) + 1)
+
+
+static esp_err_t bus_sim_i2c_read(void *ctx, uint8_t reg, uint8_t *rx, size_t len)
+{
+    return adxl345_sim_bus_read(ctx, reg, rx, len, I2C_BITS_READ(len));
+}
+
+static esp_err_t bus_sim_i2c_write(void *ctx, uint8_t reg, const uint8_t *tx, size_t len)
+{
+    return adxl345_sim_bus_write(ctx, reg, tx, len, I2C_BITS_WRITE(len));
+}
+
+static esp_err_t bus_sim_spi_read(void *ctx, uint8_t reg, uint8_t *rx, size_t len)
+{
+    return adxl345_sim_bus_read(ctx, reg, rx, len, SPI_BITS(len));
+}
+
+static esp_err_t bus_sim_spi_write(void *ctx, uint8_t reg, const uint8_t *tx, size_t len)
+{
+    return adxl345_sim_bus_write(ctx, reg, tx, len, SPI_BITS(len));
+}
+
+static esp_err_t bus_sim_recover(void *ctx)
+{
+    return adxl345_sim_bus_clear(ctx);
+}
+
+static const adxl345_bus_ops_t bus_sim_i2c_ops = {
+    .read = bus_sim_i2c_read,
+    .write = bus_sim_i2c_write,
+    .del = NULL,
+    .recover = bus_sim_recover,
+};
+
+static const adxl345_bus_ops_t bus_sim_spi_ops = {
+    .read = bus_sim_spi_read,
+    .write = bus_sim_spi_write,
+    .del = NULL,
+    .recover = NULL,
+};
+
+/**
+ * @brief Transport talking to one simulated sensor, for adxl345_dev_config_t.bus
+ * @param spi true: 4-wire SPI framing, false: I2C framing
+ * @param out_bus the transport, nothing to free, it lives as long as the simulator
+ */
+void adxl345_sim_bus(adxl345_sim_t *sim, bool spi, adxl345_bus_t *out_bus)
+{
+    *out_bus = (adxl345_bus_t) {
+        .ops = spi ? &bus_sim_spi_ops : &bus_sim_i2c_ops,
+        .ctx = sim,
+        .name = spi ? "spi" : "i2c",
+        .fifo_gap_us = spi ? ADXL345_FIFO_GAP_US : 0,   // like the SPI backend above 1.6 MHz
+    };
+}
@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/queue.h"
+#include "driver/gpio.h"
+
+#include "adxl345_sim.h"
+
+/**
+ * The bits of ESP-IDF and FreeRTOS the driver uses, single threaded and on the
+ * simulator clock. Tasks are recorded but never run: a host program calls the
+ * work function (e.g. adxl345_intr_service()) itself.
+ */
+
+struct host_task {
+    TaskFunction_t fn;
+    void *arg;
+    uint32_t notifications;
+};
+
+struct host_sem {
+    int count;
+};
+
+struct host_queue {
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+    uint8_t items[];
+};
+
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:
+        return "ESP_ERR_INVALID_RESPONSE";
+    case ESP_ERR_INVALID_CRC:
+        return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_INVALID_VERSION:
+        return "ESP_ERR_INVALID_VERSION";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    return adxl345_sim_time_us();
+}
+
+void esp_rom_delay_us(uint32_t us)
+{
+    adxl345_sim_advance_us(us);
+}
+
+
+/* FreeRTOS */
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle)
+{
+    (void)name;
+    (void)stack;
+    (void)priority;
+
+    struct host_task *task = calloc(1, sizeof(struct host_task));
+    if (task == NULL) {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+
+    if (handle != NULL) {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    free(task);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    adxl345_sim_advance_us((uint64_t)ticks * portTICK_PERIOD_MS * 1000);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    return (TickType_t)(adxl345_sim_time_us() / (portTICK_PERIOD_MS * 1000));
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    (void)clear_on_exit;
+    (void)ticks;
+    return 0;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    task->notifications++;
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    task->notifications++;
+    if (woken != NULL) {
+        *woken = pdTRUE;
+    }
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return NULL;
+}
+
+uint32_t host_task_notifications(TaskHandle_t task)
+{
+    return task->notifications;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return calloc(1, sizeof(struct host_sem));
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return calloc(1, sizeof(struct host_sem));
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void)
+{
+    return calloc(1, sizeof(struct host_sem));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void)ticks;
+    sem->count++;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sem->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    return xSemaphoreTake(sem, ticks);
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem)
+{
+    return xSemaphoreGive(sem);
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    free(sem);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    QueueHandle_t queue = calloc(1, sizeof(struct host_queue) + (size_t)length * item_size);
+
+    if (queue != NULL) {
+        queue->length = length;
+        queue->item_size = item_size;
+    }
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    free(queue);
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+    (void)ticks;
+    if (queue->count == queue->length) {
+        return pdFAIL;
+    }
+    memcpy(&queue->items[((queue->head + queue->count) % queue->length) * queue->item_size], item, queue->item_size);
+    queue->count++;
+    return pdPASS;
+}
+
+BaseType_t xQueuePeek(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    (void)ticks;
+    if (queue->count == 0) {
+        return pdFALSE;
+    }
+    memcpy(item, &queue->items[queue->head * queue->item_size], queue->item_size);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks)
+{
+    if (xQueuePeek(queue, item, ticks) != pdTRUE) {
+        return pdFALSE;
+    }
+    queue->head = (queue->head + 1) % queue->length;
+    queue->count--;
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    return queue->count;
+}
+
+
+/* GPIO driver, not available, use adxl345_sim_intr_shim */
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    (void)config;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio_num, gpio_isr_t isr_handler, void *args)
+{
+    (void)gpio_num;
+    (void)isr_handler;
+    (void)args;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio_num)
+{
+    (void)gpio_num;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t gpio_num)
+{
+    (void)gpio_num;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t gpio_num)
+{
+    (void)gpio_num;
+    return ESP_ERR_NOT_SUPPORTED;
+}
@@ -0,0 +1,40 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "i2c_manager.h"
+
+#include "adxl345_sim.h"
+
+/**
+ * i2c_manager stand-in: every call is one transaction on the simulated bus.
+ * Bit counts for a register access, 9 bits per byte (8 + ACK):
+ *   write: S + addr + reg + len * data + P
+ *   read:  S + addr + reg + Sr + addr + len * data + P
+ */
+#define I2C_BITS_WRITE(len)     (1 + 9 + 9 + 9 * (len) + 1)
+#define I2C_BITS_READ(len)      (1 + 9 + 9 + 1 + 9 + 9 * (len) + 1)
+#define I2C_BITS_NACK           (1 + 9 + 1)
+
+esp_err_t i2c_manager_read(i2c_port_t port, uint16_t addr, uint32_t reg, uint8_t *buffer, uint16_t size)
+{
+    adxl345_sim_t *sim = adxl345_sim_find(port, (uint8_t)addr);
+
+    if (sim == NULL) {
+        adxl345_sim_advance_us(I2C_BITS_NACK * 1000000ULL / 400000);
+        return ESP_FAIL;
+    }
+
+    return adxl345_sim_bus_read(sim, (uint8_t)reg, buffer, size, I2C_BITS_READ(size));
+}
+
+esp_err_t i2c_manager_write(i2c_port_t port, uint16_t addr, uint32_t reg, const uint8_t *buffer, uint16_t size)
+{
+    adxl345_sim_t *sim = adxl345_sim_find(port, (uint8_t)addr);
+
+    if (sim == NULL) {
+        adxl345_sim_advance_us(I2C_BITS_NACK * 1000000ULL / 400000);
+        return ESP_FAIL;
+    }
+
+    return adxl345_sim_bus_write(sim, (uint8_t)reg, buffer, size, I2C_BITS_WRITE(size));
+}
@@ -0,0 +1,7 @@
+/**
+ * Host build stand-in for the ESP-IDF esp_attr.h
+ */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
@@ -0,0 +1,19 @@
+/**
+ * Host build stand-in for the ESP-IDF esp_log.h, errors and warnings go to stderr,
+ * info only with ADXL345_HOST_LOG_INFO defined, debug/verbose are compiled out.
+ */
+#pragma once
+
+#include <stdio.h>
+
+#define ESP_LOGE(tag, format, ...) fprintf(stderr, "E %s: " format "\n", tag, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...) fprintf(stderr, "W %s: " format "\n", tag, ##__VA_ARGS__)
+
+#ifdef ADXL345_HOST_LOG_INFO
+#define ESP_LOGI(tag, format, ...) fprintf(stderr, "I %s: " format "\n", tag, ##__VA_ARGS__)
+#else
+#define ESP_LOGI(tag, format, ...) do { if (0) { fprintf(stderr, "%s" format, tag, ##__VA_ARGS__); } } while (0)
+#endif
+
+#define ESP_LOGD(tag, format, ...) do { if (0) { fprintf(stderr, "%s" format, tag, ##__VA_ARGS__); } } while (0)
+#define ESP_LOGV(tag, format, ...) do { if (0) { fprintf(stderr, "%s" format, tag, ##__VA_ARGS__); } } while (0)
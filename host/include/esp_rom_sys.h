@@ -0,0 +1,8 @@
+/**
+ * Host build stand-in for the ROM busy wait, moves the simulator clock
+ */
+#pragma once
+
+#include <stdint.h>
+
+void esp_rom_delay_us(uint32_t us);
@@ -0,0 +1,8 @@
+/**
+ * Host build stand-in for the ESP-IDF esp_timer.h, runs on the simulator clock
+ */
+#pragma once
+
+#include <stdint.h>
+
+int64_t esp_timer_get_time(void);
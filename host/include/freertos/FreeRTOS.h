@@ -0,0 +1,20 @@
+/**
+ * Host build stand-in for FreeRTOS. There is no scheduler: tasks are created but
+ * never run, delays advance the simulator clock (1 tick = 1 ms).
+ */
+#pragma once
+
+#include <stdint.h>
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdTRUE      1
+#define pdFALSE     0
+#define pdPASS      pdTRUE
+#define pdFAIL      pdFALSE
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
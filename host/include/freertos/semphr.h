@@ -0,0 +1,17 @@
+/**
+ * Host build stand-in for FreeRTOS semaphores, single threaded so take always succeeds
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_sem *SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t sem);
+void vSemaphoreDelete(SemaphoreHandle_t sem);
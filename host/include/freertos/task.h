@@ -0,0 +1,22 @@
+/**
+ * Host build stand-in for FreeRTOS tasks, see FreeRTOS.h
+ */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack, void *arg,
+                       UBaseType_t priority, TaskHandle_t *handle);
+void vTaskDelete(TaskHandle_t task);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
+BaseType_t xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+/* host only: notifications given to a task that never runs */
+uint32_t host_task_notifications(TaskHandle_t task);
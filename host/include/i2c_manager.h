@@ -0,0 +1,18 @@
+/**
+ * Host build stand-in for i2c_manager, the calls are served by the simulated
+ * sensors registered with adxl345_sim_create().
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+typedef int i2c_port_t;
+
+#define I2C_NUM_0   0
+#define I2C_NUM_1   1
+
+esp_err_t i2c_manager_read(i2c_port_t port, uint16_t addr, uint32_t reg, uint8_t *buffer, uint16_t size);
+esp_err_t i2c_manager_write(i2c_port_t port, uint16_t addr, uint32_t reg, const uint8_t *buffer, uint16_t size);
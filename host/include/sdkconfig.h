@@ -0,0 +1,4 @@
+/**
+ * Host build stand-in for the generated sdkconfig.h
+ */
+#pragma once
@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_stream.h"
+
+/**
+ * Converts a captured adxl345_stream.h byte stream (UART log, socket dump) to CSV,
+ * one line per sample with the raw counts and milli-g. Sample times are the frame
+ * timestamp plus the sample period of the frame's rate. Garbage between frames and
+ * corrupt frames are skipped, a summary with lost frames goes to stderr.
+ *
+ *   adxl345_stream2csv [-o out.csv] [in.bin]      (stdin / stdout without them)
+ */
+
+#define S2C_CHUNK   4096
+#define S2C_BUF     (ADXL345_STREAM_FRAME_MAX(ADXL345_STREAM_MAX_SAMPLES) + S2C_CHUNK)
+
+
+typedef struct {
+    uint64_t frames;
+    uint64_t samples;
+    uint64_t bad_frames;        // CRC or version
+    uint64_t lost_frames;       // sequence gaps
+    uint64_t skipped_bytes;
+    bool seen[256];
+    uint16_t next_seq[256];
+} s2c_totals_t;
+
+
+static int s2c_usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-o out.csv] [in.bin]\n", prog);
+    return 2;
+}
+
+static void s2c_frame(FILE *out, s2c_totals_t *totals, const adxl345_stream_header_t *hdr, const adxl345_raw_xyz_t *samples)
+{
+    uint64_t period_ns = adxl345_stream_sample_period_ns(hdr);
+    float mg = adxl345_stream_scale_mg(hdr);
+
+    if (totals->seen[hdr->device_id] && hdr->seq != totals->next_seq[hdr->device_id]) {
+        totals->lost_frames += (uint16_t)(hdr->seq - totals->next_seq[hdr->device_id]);
+    }
+    totals->seen[hdr->device_id] = true;
+    totals->next_seq[hdr->device_id] = (uint16_t)(hdr->seq + 1);
+    totals->frames++;
+    totals->samples += hdr->count;
+
+    for (size_t i = 0; i < hdr->count; i++) {
+        int64_t t_us = hdr->base_us + (int64_t)((i * period_ns) / 1000);
+
+        fprintf(out, "%u,%u,%lld,%d,%d,%d,%.2f,%.2f,%.2f\n", hdr->device_id, hdr->seq, (long long)t_us,
+                samples[i].x, samples[i].y, samples[i].z,
+                samples[i].x * mg, samples[i].y * mg, samples[i].z * mg);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const char *in_path = NULL;
+    const char *out_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+            out_path = argv[++i];
+        } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+            return s2c_usage(argv[0]);
+        } else if (in_path == NULL) {
+            in_path = argv[i];
+        } else {
+            return s2c_usage(argv[0]);
+        }
+    }
+
+    FILE *in = (in_path == NULL || strcmp(in_path, "-") == 0) ? stdin : fopen(in_path, "rb");
+    if (in == NULL) {
+        perror(in_path);
+        return 1;
+    }
+    FILE *out = out_path == NULL ? stdout : fopen(out_path, "w");
+    if (out == NULL) {
+        perror(out_path);
+        return 1;
+    }
+
+    uint8_t *buf = malloc(S2C_BUF);
+    adxl345_raw_xyz_t *samples = malloc(ADXL345_STREAM_MAX_SAMPLES * sizeof(adxl345_raw_xyz_t));
+    s2c_totals_t *totals = calloc(1, sizeof(s2c_totals_t));
+    if (buf == NULL || samples == NULL || totals == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    size_t len = 0;
+    bool eof = false;
+
+    fprintf(out, "device,seq,t_us,x,y,z,x_mg,y_mg,z_mg\n");
+
+    while (!eof || len > 0) {
+        if (!eof && len + S2C_CHUNK <= S2C_BUF) {
+            size_t n = fread(&buf[len], 1, S2C_CHUNK, in);
+
+            len += n;
+            eof = n == 0;
+        }
+
+        adxl345_stream_header_t hdr;
+        size_t used;
+        esp_err_t err = adxl345_stream_decode(buf, len, &hdr, samples, ADXL345_STREAM_MAX_SAMPLES, &used);
+
+        switch (err) {
+        case ESP_OK:
+            s2c_frame(out, totals, &hdr, samples);
+            break;
+        case ESP_ERR_INVALID_CRC:
+        case ESP_ERR_INVALID_VERSION:
+            totals->bad_frames++;
+            totals->skipped_bytes += used;
+            break;
+        case ESP_ERR_NOT_FOUND:
+            totals->skipped_bytes += used;
+            break;
+        case ESP_ERR_INVALID_SIZE:
+            if (eof) {
+                totals->skipped_bytes += len;            // a truncated last frame
+                used = len;
+            }
+            break;
+        default:
+            fprintf(stderr, "decode error %d\n", err);
+            return 1;
+        }
+
+        memmove(buf, &buf[used], len - used);
+        len -= used;
+    }
+
+    fprintf(stderr, "frames: %llu, samples: %llu, bad frames: %llu, lost frames: %llu, skipped bytes: %llu\n",
+            (unsigned long long)totals->frames, (unsigned long long)totals->samples,
+            (unsigned long long)totals->bad_frames, (unsigned long long)totals->lost_frames,
+            (unsigned long long)totals->skipped_bytes);
+
+    if (out != stdout) {
+        fclose(out);
+    }
+    if (in != stdin) {
+        fclose(in);
+    }
+    free(totals);
+    free(samples);
+    free(buf);
+    return 0;
+}
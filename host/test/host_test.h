@@ -0,0 +1,61 @@
+/**
+ * Minimal check macros for the host tests, each test is its own ctest executable.
+ * A failed check prints where and keeps going, main() returns test_result().
+ */
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "adxl345.h"
+#include "adxl345_sim.h"
+
+static int test_failures;
+
+#define TEST_CHECK(cond) do {                                               \
+        if (!(cond)) {                                                      \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+#define TEST_CHECK_EQ(actual, expected) do {                                \
+        long long a_ = (long long)(actual);                                 \
+        long long e_ = (long long)(expected);                               \
+        if (a_ != e_) {                                                     \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__, #actual, a_, e_); \
+            test_failures++;                                                \
+        }                                                                   \
+    } while (0)
+
+#define TEST_RUN(fn) do {                                                   \
+        int before_ = test_failures;                                        \
+        fn();                                                               \
+        printf("%s %s\n", test_failures == before_ ? "PASS" : "FAIL", #fn); \
+    } while (0)
+
+static inline int test_result(void)
+{
+    return test_failures == 0 ? 0 : 1;
+}
+
+/**
+ * @brief A simulated sensor and a device handle on it over the i2c_manager stand-in
+ * @param sim_config NULL for ADXL345_SIM_CONFIG_DEFAULT()
+ * @param dev_config NULL for ADXL345_DEV_CONFIG_DEFAULT()
+ */
+static inline void test_setup(const adxl345_sim_config_t *sim_config, const adxl345_dev_config_t *dev_config,
+                              adxl345_sim_t **sim, adxl345_dev_t **dev)
+{
+    adxl345_sim_config_t sc = ADXL345_SIM_CONFIG_DEFAULT();
+    adxl345_dev_config_t dc = ADXL345_DEV_CONFIG_DEFAULT();
+
+    ESP_ERROR_CHECK(adxl345_sim_create(sim_config ? sim_config : &sc, sim));
+    ESP_ERROR_CHECK(adxl345_create(dev_config ? dev_config : &dc, dev));
+}
+
+static inline void test_teardown(adxl345_sim_t *sim, adxl345_dev_t *dev)
+{
+    adxl345_destroy(dev);
+    adxl345_sim_destroy(sim);
+}
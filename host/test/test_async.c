@@ -0,0 +1,228 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_async.h"
+#include "adxl345_sim.h"
+#include "host_test.h"
+
+/**
+ * Read merging of the async queue, run with adxl345_async_poll() on a queue without
+ * worker: reads that continue each other go out as one burst, split back into the
+ * buffers of the jobs, within max_merge and ADXL345_ASYNC_MAX_BURST, and a failed
+ * burst is reported to every job in it.
+ */
+
+
+typedef struct {
+    uint32_t calls;
+    esp_err_t err;
+} job_log_t;
+
+static void log_job(const adxl345_async_job_t *job, esp_err_t err)
+{
+    job_log_t *log = (job_log_t *)job->arg;
+
+    log->calls++;
+    log->err = err;
+}
+
+/* a distinct value on every axis so misplaced bytes show */
+static void tilted(void *arg, int64_t time_us, int32_t accel_mg[3])
+{
+    (void)arg;
+    (void)time_us;
+    accel_mg[0] = 1000;
+    accel_mg[1] = -500;
+    accel_mg[2] = 250;
+}
+
+static void async_setup(uint8_t max_merge, adxl345_sim_t **sim, adxl345_dev_t **dev, adxl345_async_t **async)
+{
+    adxl345_sim_config_t sim_config = ADXL345_SIM_CONFIG_DEFAULT();
+    adxl345_async_config_t config = ADXL345_ASYNC_CONFIG_DEFAULT();
+
+    sim_config.signal = tilted;
+    test_setup(&sim_config, NULL, sim, dev);
+    TEST_CHECK_EQ(adxl345_begin(*dev), ESP_OK);
+    adxl345_sim_advance_us(20000);
+
+    config.worker = false;
+    config.max_merge = max_merge;
+    TEST_CHECK_EQ(adxl345_async_create(&config, async), ESP_OK);
+    adxl345_sim_reset_counters(*sim);
+}
+
+/* 0x32..0x33 and 0x34..0x37: one 6 byte read, each buffer gets its registers */
+static void test_merge_data(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_async_t *async;
+    adxl345_sim_counters_t c;
+    adxl345_async_stats_t stats;
+    job_log_t log[2] = { 0 };
+    uint8_t expected[6];
+    uint8_t x[2], yz[4];
+
+    async_setup(ADXL345_ASYNC_MAX_MERGE, &sim, &dev, &async);
+    for (int i = 0; i < 6; i++) {
+        expected[i] = adxl345_sim_peek_reg(sim, ADXL345_REG_DATAX0 + i);
+    }
+
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAX0, x, 2, log_job, &log[0]), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAY0, yz, 4, log_job, &log[1]), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_poll(async, SIZE_MAX), 1);
+
+    adxl345_sim_get_counters(sim, &c);
+    TEST_CHECK_EQ(c.transactions, 1);
+    TEST_CHECK_EQ(c.bytes_read, 6);
+    TEST_CHECK_EQ(memcmp(x, expected, 2), 0);
+    TEST_CHECK_EQ(memcmp(yz, &expected[2], 4), 0);
+    TEST_CHECK_EQ((int16_t)(x[0] | x[1] << 8), 256);
+    TEST_CHECK_EQ((int16_t)(yz[0] | yz[1] << 8), -128);
+    TEST_CHECK_EQ((int16_t)(yz[2] | yz[3] << 8), 64);
+    TEST_CHECK(log[0].calls == 1 && log[0].err == ESP_OK);
+    TEST_CHECK(log[1].calls == 1 && log[1].err == ESP_OK);
+
+    adxl345_async_get_stats(async, &stats);
+    TEST_CHECK_EQ(stats.jobs, 2);
+    TEST_CHECK_EQ(stats.transactions, 1);
+    TEST_CHECK_EQ(stats.merged, 1);
+
+    adxl345_async_destroy(async);
+    test_teardown(sim, dev);
+}
+
+/* gaps, another register order or a write in between end the merge */
+static void test_no_merge(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_async_t *async;
+    adxl345_sim_counters_t c;
+    uint8_t buf[4][2];
+    uint8_t rate = ADXL345_DATARATE_100_HZ;
+
+    async_setup(ADXL345_ASYNC_MAX_MERGE, &sim, &dev, &async);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAX0, buf[0], 2, NULL, NULL), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAZ0, buf[1], 2, NULL, NULL), ESP_OK);     // gap
+    TEST_CHECK_EQ(adxl345_async_write(async, dev, ADXL345_REG_BW_RATE, &rate, 1, NULL, NULL), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAY0, buf[2], 2, NULL, NULL), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAX0, buf[3], 2, NULL, NULL), ESP_OK);     // backwards
+    TEST_CHECK_EQ(adxl345_async_poll(async, SIZE_MAX), 5);
+
+    adxl345_sim_get_counters(sim, &c);
+    TEST_CHECK_EQ(c.transactions, 5);
+
+    adxl345_async_destroy(async);
+    test_teardown(sim, dev);
+}
+
+/* max_merge jobs per burst, the rest starts the next one */
+static void test_max_merge(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_async_t *async;
+    adxl345_sim_counters_t c;
+    adxl345_async_stats_t stats;
+    uint8_t data[6];
+
+    async_setup(2, &sim, &dev, &async);
+    for (int i = 0; i < 3; i++) {
+        TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAX0 + 2 * i, &data[2 * i], 2, NULL, NULL), ESP_OK);
+    }
+    TEST_CHECK_EQ(adxl345_async_poll(async, SIZE_MAX), 2);
+
+    adxl345_sim_get_counters(sim, &c);
+    adxl345_async_get_stats(async, &stats);
+    TEST_CHECK_EQ(c.transactions, 2);
+    TEST_CHECK_EQ(stats.jobs, 3);
+    TEST_CHECK_EQ(stats.merged, 1);
+
+    adxl345_async_destroy(async);
+    test_teardown(sim, dev);
+}
+
+/* a burst never gets longer than ADXL345_ASYNC_MAX_BURST */
+static void test_max_burst(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_async_t *async;
+    adxl345_sim_counters_t c;
+    uint8_t a[40], b[25];
+
+    async_setup(ADXL345_ASYNC_MAX_MERGE, &sim, &dev, &async);
+
+    // 40 + 24 = 64 fits
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, 0x00, a, 40, NULL, NULL), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, 40, b, ADXL345_ASYNC_MAX_BURST - 40, NULL, NULL), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_poll(async, SIZE_MAX), 1);
+    adxl345_sim_get_counters(sim, &c);
+    TEST_CHECK_EQ(c.transactions, 1);
+    TEST_CHECK_EQ(c.bytes_read, ADXL345_ASYNC_MAX_BURST);
+    TEST_CHECK_EQ(a[ADXL345_REG_DEVID], ADXL345_REG_RETURN_DEVID);
+
+    // 40 + 25 does not
+    adxl345_sim_reset_counters(sim);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, 0x00, a, 40, NULL, NULL), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, 40, b, ADXL345_ASYNC_MAX_BURST - 39, NULL, NULL), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_poll(async, SIZE_MAX), 2);
+    adxl345_sim_get_counters(sim, &c);
+    TEST_CHECK_EQ(c.transactions, 2);
+
+    adxl345_async_destroy(async);
+    test_teardown(sim, dev);
+}
+
+/* a failed burst fails every job in it, no buffer is touched */
+static void test_merged_error(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_async_t *async;
+    adxl345_async_stats_t stats;
+    job_log_t log[3] = { 0 };
+    uint8_t x[2], y[2], z[2];
+
+    async_setup(ADXL345_ASYNC_MAX_MERGE, &sim, &dev, &async);
+    memset(x, 0xAA, sizeof(x));
+    memset(y, 0xAA, sizeof(y));
+    memset(z, 0xAA, sizeof(z));
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAX0, x, 2, log_job, &log[0]), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAY0, y, 2, log_job, &log[1]), ESP_OK);
+    TEST_CHECK_EQ(adxl345_async_read(async, dev, ADXL345_REG_DATAZ0, z, 2, log_job, &log[2]), ESP_OK);
+
+    adxl345_sim_fail_next(sim, 1, ESP_ERR_TIMEOUT);     // data reads are not retried
+    TEST_CHECK_EQ(adxl345_async_poll(async, SIZE_MAX), 1);
+
+    for (int i = 0; i < 3; i++) {
+        TEST_CHECK_EQ(log[i].calls, 1);
+        TEST_CHECK_EQ(log[i].err, ESP_ERR_TIMEOUT);
+    }
+    TEST_CHECK(x[0] == 0xAA && y[0] == 0xAA && z[0] == 0xAA);
+
+    adxl345_async_get_stats(async, &stats);
+    TEST_CHECK_EQ(stats.jobs, 3);
+    TEST_CHECK_EQ(stats.errors, 3);
+    TEST_CHECK_EQ(stats.transactions, 1);
+
+    adxl345_async_destroy(async);
+    test_teardown(sim, dev);
+}
+
+int main(void)
+{
+    TEST_RUN(test_merge_data);
+    TEST_RUN(test_no_merge);
+    TEST_RUN(test_max_merge);
+    TEST_RUN(test_max_burst);
+    TEST_RUN(test_merged_error);
+
+    return test_result();
+}
@@ -0,0 +1,282 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "adxl345.h"
+#include "adxl345_boot.h"
+#include "adxl345_events.h"
+#include "adxl345_sim.h"
+#include "host_test.h"
+
+/**
+ * Bus level behaviour on the simulator: transaction counts of the burst read,
+ * apply_config, the cold starts and the event setup, and the retry / bus clear / brownout recovery
+ * with injected errors.
+ */
+
+
+static adxl345_sim_counters_t counters(adxl345_sim_t *sim)
+{
+    adxl345_sim_counters_t c;
+
+    adxl345_sim_get_counters(sim, &c);
+    return c;
+}
+
+/* X/Y/Z come in one 6 byte transaction */
+static void test_burst_read(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_xyz_t accel;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    adxl345_sim_advance_us(20000);
+    adxl345_sim_reset_counters(sim);
+
+    TEST_CHECK_EQ(adxl345_get_accel(dev, &accel), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).transactions, 1);
+    TEST_CHECK_EQ(counters(sim).bytes_read, 6);
+    TEST_CHECK_EQ(accel.z, 256);                // lying flat, FULL_RES 3.9 mg/LSB
+
+    test_teardown(sim, dev);
+}
+
+static void test_begin_transactions(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).transactions, 6);
+    test_teardown(sim, dev);
+}
+
+/* 4 burst writes when the config measures, 3 in standby, verify adds 2 reads */
+static void test_apply_config_transactions(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_config_t config = ADXL345_CONFIG_DEFAULT();
+
+    test_setup(NULL, NULL, &sim, &dev);
+
+    config.bw_rate = ADXL345_DATARATE_400_HZ;
+    config.data_format = 0x08;
+    config.fifo_ctl = (ADXL345_FIFO_STREAM << 6) | 16;
+    TEST_CHECK_EQ(adxl345_apply_config(dev, &config, false), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).transactions, 3);
+
+    adxl345_sim_reset_counters(sim);
+    config.power_ctl = 0x08;
+    TEST_CHECK_EQ(adxl345_apply_config(dev, &config, false), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).writes, 4);
+    TEST_CHECK_EQ(counters(sim).reads, 0);
+
+    adxl345_sim_reset_counters(sim);
+    TEST_CHECK_EQ(adxl345_apply_config(dev, &config, true), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).writes, 4);
+    TEST_CHECK_EQ(counters(sim).reads, 2);
+
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_BW_RATE), ADXL345_DATARATE_400_HZ);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_FIFO_CTL), (ADXL345_FIFO_STREAM << 6) | 16);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_POWER_CTL), 0x08);
+
+    test_teardown(sim, dev);
+}
+
+/* chip ID + one write from reset, the first sample adds polls */
+static void test_begin_fast_transactions(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_boot_config_t boot = ADXL345_BOOT_CONFIG_DEFAULT();
+    adxl345_boot_report_t report;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    boot.wait_sample = false;
+    TEST_CHECK_EQ(adxl345_begin_fast(dev, &boot, &report), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).transactions, 2);
+    TEST_CHECK_EQ(report.transactions, 2);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_POWER_CTL), 0x1B);
+    test_teardown(sim, dev);
+
+    test_setup(NULL, NULL, &sim, &dev);
+    boot = (adxl345_boot_config_t) ADXL345_BOOT_CONFIG_DEFAULT();
+    TEST_CHECK_EQ(adxl345_begin_fast(dev, &boot, &report), ESP_OK);
+    TEST_CHECK_EQ(report.transactions, counters(sim).transactions);
+    TEST_CHECK(report.transactions > 2);
+    TEST_CHECK(report.first_sample_us > 0);
+    TEST_CHECK_EQ(report.sample.z, 256);
+    test_teardown(sim, dev);
+}
+
+/* event setup touches only the event block and the event bits of INT_MAP / INT_ENABLE */
+static void test_events_configure_transactions(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_events_config_t events = ADXL345_EVENTS_CONFIG_DEFAULT();
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_fifo(dev, ADXL345_FIFO_STREAM), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_int_enable(dev, ADXL345_INT_WATERMARK), ESP_OK);
+    adxl345_sim_advance_us(100000);
+
+    uint8_t fifo_ctl = adxl345_sim_peek_reg(sim, ADXL345_REG_FIFO_CTL);
+    uint8_t power_ctl = adxl345_sim_peek_reg(sim, ADXL345_REG_POWER_CTL);
+    uint8_t queued = adxl345_sim_fifo_count(sim);
+
+    adxl345_sim_reset_counters(sim);
+    events.events = ADXL345_INT_SINGLE_TAP | ADXL345_INT_FREE_FALL;
+    events.int2_map = ADXL345_INT_FREE_FALL;
+    TEST_CHECK_EQ(adxl345_events_configure(dev, &events), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).writes, 3);
+    TEST_CHECK_EQ(counters(sim).reads, 0);
+
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_FIFO_CTL), fifo_ctl);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_POWER_CTL), power_ctl);
+    TEST_CHECK(adxl345_sim_fifo_count(sim) >= queued);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_INT_ENABLE),
+                  ADXL345_INT_WATERMARK | ADXL345_INT_SINGLE_TAP | ADXL345_INT_FREE_FALL);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_INT_MAP), ADXL345_INT_FREE_FALL);
+    TEST_CHECK_EQ(adxl345_verify_regs(dev), ESP_OK);
+
+    test_teardown(sim, dev);
+}
+
+/* two failures: retried, the bus cleared after the second, then it works */
+static void test_retry_and_clear(void)
+{
+    adxl345_sim_config_t sim_config = ADXL345_SIM_CONFIG_DEFAULT();
+    adxl345_dev_config_t dev_config = ADXL345_DEV_CONFIG_DEFAULT();
+    adxl345_bus_t bus;
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    uint8_t entries;
+
+    // the sim transport can clear the bus, the i2c_manager stand-in can't
+    ESP_ERROR_CHECK(adxl345_sim_create(&sim_config, &sim));
+    adxl345_sim_bus(sim, false, &bus);
+    dev_config.bus = &bus;
+    ESP_ERROR_CHECK(adxl345_create(&dev_config, &dev));
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    adxl345_sim_reset_counters(sim);
+
+    adxl345_sim_fail_next(sim, 2, ESP_FAIL);
+    TEST_CHECK_EQ(adxl345_get_fifo_entries(dev, &entries), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).errors_injected, 2);
+    TEST_CHECK_EQ(counters(sim).bus_clears, 1);
+
+    // out of retries: 1 + 3 attempts, the error comes back
+    adxl345_sim_reset_counters(sim);
+    adxl345_sim_fail_next(sim, 10, ESP_ERR_TIMEOUT);
+    TEST_CHECK_EQ(adxl345_get_fifo_entries(dev, &entries), ESP_ERR_TIMEOUT);
+    TEST_CHECK_EQ(counters(sim).transactions, 4);
+    adxl345_sim_fail_next(sim, 0, ESP_OK);
+
+    // hung bus: only the bus clear frees it
+    adxl345_sim_reset_counters(sim);
+    adxl345_sim_hang_bus(sim);
+    TEST_CHECK_EQ(adxl345_chipid(dev), ESP_OK);
+    TEST_CHECK_EQ(counters(sim).bus_clears, 1);
+
+    test_teardown(sim, dev);
+}
+
+/* a failed data / INT_SOURCE read is not repeated: the FIFO must not lose a sample */
+static void test_no_retry_destructive(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_xyz_t accel;
+    uint8_t int_source;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_fifo(dev, ADXL345_FIFO_STREAM), ESP_OK);
+    adxl345_sim_advance_us(100000);
+    adxl345_sim_reset_counters(sim);
+
+    uint8_t before = adxl345_sim_fifo_count(sim);
+
+    adxl345_sim_fail_next(sim, 1, ESP_FAIL);
+    TEST_CHECK_EQ(adxl345_get_accel(dev, &accel), ESP_FAIL);
+    TEST_CHECK_EQ(counters(sim).transactions, 1);
+    TEST_CHECK_EQ(adxl345_sim_fifo_count(sim), before);
+
+    adxl345_sim_fail_next(sim, 1, ESP_FAIL);
+    TEST_CHECK_EQ(adxl345_get_int_source(dev, &int_source), ESP_FAIL);
+    TEST_CHECK_EQ(counters(sim).transactions, 2);
+
+    test_teardown(sim, dev);
+}
+
+/* brownout: the first transaction after errors finds the reset and writes the config back */
+static void test_brownout_reapply(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_datarate(dev, ADXL345_DATARATE_800_HZ), ESP_OK);
+
+    adxl345_sim_power_cycle(sim);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_POWER_CTL), 0x00);
+
+    adxl345_sim_fail_next(sim, 1, ESP_FAIL);
+    TEST_CHECK_EQ(adxl345_chipid(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_BW_RATE), ADXL345_DATARATE_800_HZ);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_POWER_CTL) & 0x08, 0x08);
+    TEST_CHECK_EQ(adxl345_verify_regs(dev), ESP_OK);
+
+    test_teardown(sim, dev);
+}
+
+/* the check after a retry waits until the FIFO drain is complete */
+static void test_health_check_after_drain(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_raw_xyz_t samples[ADXL345_FIFO_SIZE];
+    size_t count;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_fifo(dev, ADXL345_FIFO_FIFO), ESP_OK);
+    adxl345_sim_advance_us(100000);
+
+    uint8_t before = adxl345_sim_fifo_count(sim);
+
+    adxl345_sim_reset_counters(sim);
+    adxl345_sim_fail_next(sim, 1, ESP_FAIL);       // the FIFO_STATUS read, retried
+    TEST_CHECK_EQ(adxl345_read_fifo(dev, samples, ADXL345_FIFO_SIZE, &count), ESP_OK);
+    TEST_CHECK_EQ(count, before);
+
+    // FIFO_STATUS twice, the pops, then one health check read; nothing written
+    TEST_CHECK_EQ(counters(sim).reads, 2 + before + 1);
+    TEST_CHECK_EQ(counters(sim).writes, 0);
+
+    test_teardown(sim, dev);
+}
+
+int main(void)
+{
+    TEST_RUN(test_burst_read);
+    TEST_RUN(test_begin_transactions);
+    TEST_RUN(test_apply_config_transactions);
+    TEST_RUN(test_begin_fast_transactions);
+    TEST_RUN(test_events_configure_transactions);
+    TEST_RUN(test_retry_and_clear);
+    TEST_RUN(test_no_retry_destructive);
+    TEST_RUN(test_brownout_reapply);
+    TEST_RUN(test_health_check_after_drain);
+
+    return test_result();
+}
@@ -0,0 +1,115 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_decim.h"
+#include "host_test.h"
+
+/**
+ * Full scale input through the CIC + FIR decimator. The FIR overshoots a full scale
+ * step past the Q16.16 range; the output has to saturate and keep its sign, a
+ * wrapped accumulator shows up as extra sign changes.
+ */
+
+
+#define TEST_BATCH      64
+#define TEST_INPUT      4096
+#define TEST_HALF_SCALE 16384
+
+/* x: full scale step, y: full scale square, z: the inverted step */
+static void full_scale_input(size_t i, size_t half_period, adxl345_raw_xyz_t *s)
+{
+    bool high = i >= TEST_INPUT / 2;
+
+    s->x = high ? INT16_MAX : INT16_MIN;
+    s->y = (i / half_period) % 2 ? INT16_MAX : INT16_MIN;
+    s->z = high ? INT16_MIN : INT16_MAX;
+}
+
+/* sign changes between outputs past half scale, skips the start up ripple from a reset state */
+static void count_sign_changes(const int16_t *v, size_t count, int *changes)
+{
+    int sign = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        int s = (v[i] > TEST_HALF_SCALE) - (v[i] < -TEST_HALF_SCALE);
+
+        if (s != 0 && sign != 0 && s != sign) {
+            (*changes)++;
+        }
+        if (s != 0) {
+            sign = s;
+        }
+    }
+}
+
+static void run_full_scale(const adxl345_decim_config_t *config, size_t half_period)
+{
+    adxl345_decim_t *decim;
+    adxl345_raw_xyz_t in[TEST_BATCH];
+    adxl345_raw_xyz_t out[TEST_BATCH];
+    int16_t x[TEST_INPUT], y[TEST_INPUT], z[TEST_INPUT];
+    size_t total = 0;
+    uint32_t ratio;
+    int changes[3] = { 0 };
+
+    TEST_CHECK_EQ(adxl345_decim_create(config, &decim), ESP_OK);
+    ratio = adxl345_decim_ratio(decim);
+    for (size_t i = 0; i < TEST_INPUT; i += TEST_BATCH) {
+        size_t count;
+
+        for (size_t k = 0; k < TEST_BATCH; k++) {
+            full_scale_input(i + k, half_period, &in[k]);
+        }
+        TEST_CHECK_EQ(adxl345_decim_process(decim, in, TEST_BATCH, out, TEST_BATCH, &count), ESP_OK);
+        for (size_t k = 0; k < count; k++) {
+            x[total] = out[k].x;
+            y[total] = out[k].y;
+            z[total] = out[k].z;
+            total++;
+        }
+    }
+    adxl345_decim_destroy(decim);
+
+    TEST_CHECK_EQ(total, TEST_INPUT / ratio);
+    count_sign_changes(x, total, &changes[0]);
+    count_sign_changes(y, total, &changes[1]);
+    count_sign_changes(z, total, &changes[2]);
+
+    // one per edge of the input and not a single one more
+    TEST_CHECK_EQ(changes[0], 1);
+    TEST_CHECK_EQ(changes[1], TEST_INPUT / half_period - 1);
+    TEST_CHECK_EQ(changes[2], 1);
+
+    // the settled step is full scale, not clipped short of it
+    TEST_CHECK_EQ(x[total - 1], INT16_MAX);
+    TEST_CHECK_EQ(z[total - 1], INT16_MIN);
+}
+
+static void test_default_config(void)
+{
+    adxl345_decim_config_t config = ADXL345_DECIM_CONFIG_DEFAULT();
+
+    run_full_scale(&config, 256);
+}
+
+/* no CIC, all the overshoot comes from the FIR */
+static void test_fir_only(void)
+{
+    adxl345_decim_config_t config = ADXL345_DECIM_CONFIG_DEFAULT();
+
+    config.cic_ratio = 1;
+    config.cic_order = 1;
+    config.fir_ratio = 4;
+    run_full_scale(&config, 128);
+}
+
+int main(void)
+{
+    TEST_RUN(test_default_config);
+    TEST_RUN(test_fir_only);
+
+    return test_result();
+}
@@ -0,0 +1,138 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_timer.h"
+
+#include "adxl345.h"
+#include "adxl345_bus.h"
+#include "adxl345_sim.h"
+#include "host_test.h"
+
+/**
+ * FIFO drain, the SPI gap between pops and overrun on the simulator.
+ */
+
+
+/* x ramps 100 mg per 10 ms, so consecutive 100 Hz samples differ */
+static void ramp_signal(void *arg, int64_t time_us, int32_t accel_mg[3])
+{
+    (void)arg;
+    accel_mg[0] = (int32_t)(time_us / 100) % 4000;
+    accel_mg[1] = 0;
+    accel_mg[2] = 1000;
+}
+
+/* every sample out, oldest first, one transaction each plus the entry count */
+static void test_drain(void)
+{
+    adxl345_sim_config_t sim_config = ADXL345_SIM_CONFIG_DEFAULT();
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_raw_xyz_t samples[ADXL345_FIFO_SIZE];
+    adxl345_sim_counters_t c;
+    size_t count;
+
+    sim_config.signal = ramp_signal;
+    test_setup(&sim_config, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_fifo(dev, ADXL345_FIFO_STREAM), ESP_OK);
+    adxl345_sim_advance_us(150000);
+
+    uint8_t queued = adxl345_sim_fifo_count(sim);
+
+    TEST_CHECK(queued >= 10 && queued < ADXL345_FIFO_SIZE);
+    adxl345_sim_reset_counters(sim);
+    TEST_CHECK_EQ(adxl345_read_fifo(dev, samples, ADXL345_FIFO_SIZE, &count), ESP_OK);
+    adxl345_sim_get_counters(sim, &c);
+
+    TEST_CHECK(count >= queued);                // a conversion may land during the drain
+    TEST_CHECK_EQ(c.transactions, 1 + count);
+    TEST_CHECK_EQ(c.bytes_read, 1 + 6 * count);
+    for (size_t i = 1; i < count; i++) {
+        TEST_CHECK(samples[i].x > samples[i - 1].x);
+    }
+
+    // a short array takes what fits, the rest stays queued
+    adxl345_sim_advance_us(100000);
+    queued = adxl345_sim_fifo_count(sim);
+    TEST_CHECK_EQ(adxl345_read_fifo(dev, samples, 4, &count), ESP_OK);
+    TEST_CHECK_EQ(count, 4);
+    TEST_CHECK(adxl345_sim_fifo_count(sim) >= queued - 4);
+
+    test_teardown(sim, dev);
+}
+
+/* FIFO mode stops at 32 and flags OVERRUN until the data is read */
+static void test_overrun(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_raw_xyz_t samples[ADXL345_FIFO_SIZE];
+    adxl345_sim_counters_t c;
+    uint8_t int_source;
+    uint8_t entries;
+    size_t count;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_fifo(dev, ADXL345_FIFO_FIFO), ESP_OK);
+    adxl345_sim_reset_counters(sim);
+    adxl345_sim_advance_us(500000);             // 50 samples at 100 Hz
+
+    adxl345_sim_get_counters(sim, &c);
+    TEST_CHECK(c.overruns > 0);
+    TEST_CHECK_EQ(adxl345_get_fifo_entries(dev, &entries), ESP_OK);
+    TEST_CHECK_EQ(entries, ADXL345_FIFO_SIZE);
+    TEST_CHECK_EQ(adxl345_get_int_source(dev, &int_source), ESP_OK);
+    TEST_CHECK(int_source & ADXL345_INT_OVERRUN);
+
+    TEST_CHECK_EQ(adxl345_read_fifo(dev, samples, ADXL345_FIFO_SIZE, &count), ESP_OK);
+    TEST_CHECK_EQ(count, ADXL345_FIFO_SIZE);
+    TEST_CHECK_EQ(adxl345_get_int_source(dev, &int_source), ESP_OK);
+    TEST_CHECK_EQ(int_source & ADXL345_INT_OVERRUN, 0);
+
+    test_teardown(sim, dev);
+}
+
+/* SPI above 1.6 MHz: 5 us between pops on top of the transactions themselves */
+static void test_spi_gap(void)
+{
+    adxl345_sim_config_t sim_config = ADXL345_SIM_CONFIG_DEFAULT();
+    adxl345_dev_config_t dev_config = ADXL345_DEV_CONFIG_DEFAULT();
+    adxl345_raw_xyz_t samples[ADXL345_FIFO_SIZE];
+    adxl345_sim_counters_t c;
+    adxl345_bus_t bus;
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    size_t count;
+
+    sim_config.bus_hz = ADXL345_SPI_MAX_HZ;
+    ESP_ERROR_CHECK(adxl345_sim_create(&sim_config, &sim));
+    adxl345_sim_bus(sim, true, &bus);
+    dev_config.bus = &bus;
+    ESP_ERROR_CHECK(adxl345_create(&dev_config, &dev));
+    TEST_CHECK_EQ(bus.fifo_gap_us, ADXL345_FIFO_GAP_US);
+
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_fifo(dev, ADXL345_FIFO_FIFO), ESP_OK);
+    adxl345_sim_advance_us(200000);
+    adxl345_sim_reset_counters(sim);
+
+    int64_t start = esp_timer_get_time();
+
+    TEST_CHECK_EQ(adxl345_read_fifo(dev, samples, ADXL345_FIFO_SIZE, &count), ESP_OK);
+    adxl345_sim_get_counters(sim, &c);
+    TEST_CHECK(count > 0);
+    TEST_CHECK((uint64_t)(esp_timer_get_time() - start) * 1000 >= c.bus_time_ns + count * ADXL345_FIFO_GAP_US * 1000ULL);
+
+    test_teardown(sim, dev);
+}
+
+int main(void)
+{
+    TEST_RUN(test_drain);
+    TEST_RUN(test_spi_gap);
+    TEST_RUN(test_overrun);
+
+    return test_result();
+}
@@ -0,0 +1,157 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_filter.h"
+#include "host_test.h"
+
+/**
+ * Golden vectors for the fixed-point filter bank. The target runs the same integer
+ * code, so these outputs are what it has to produce bit for bit; a change here means
+ * host and target builds from before and after the change disagree.
+ *
+ * Bank: first order high pass at ODR/200, then second order low pass at ODR/5, from
+ * the precomputed table. Inputs per frame:
+ *   x: full scale square, 6 frames -32768, 6 frames 32767, the high pass overshoots
+ *      past the Q16.16 range and has to saturate instead of wrapping
+ *   y: LCG noise in -1000..1000
+ *   z: ramp from -1500 counts, 97 per frame
+ */
+
+
+#define TEST_FRAMES     32
+
+/* Q16.16 out of adxl345_filter_process() */
+static const int32_t golden_q16[TEST_FRAMES][3] = {
+    { -436749168, -2265850, -19992790 },
+    { -1458128498, -11869868, -65454958 },
+    { -2146671494, -30828020, -92657596 },
+    { -2147483648, -48063322, -86396982 },
+    { -1963436747, -30440570, -71575510 },
+    { -1846077278, 3990103, -60365333 },
+    { -985764083, 14161728, -52381244 },
+    { 941080714, 7691469, -45090741 },
+    { 2147483647, -10173284, -37626971 },
+    { 2147483647, -26893444, -30159261 },
+    { 1988259118, -32783392, -22913863 },
+    { 1879458488, -24666448, -15935355 },
+    { 1011016435, -6514023, -9190216 },
+    { -932422334, 3747344, -2651815 },
+    { -2147483648, -7065659, 3688469 },
+    { -2147483648, -31309829, 9833785 },
+    { -1988259119, -22624946, 15788628 },
+    { -1879458489, 29154175, 21558904 },
+    { -1011016436, 68101785, 27150630 },
+    { 932422333, 49766106, 32569440 },
+    { 2147483647, 10541746, 37820661 },
+    { 2147483647, 16141939, 42909450 },
+    { 1988259118, 27917547, 47840824 },
+    { 1879458488, -4784521, 52619656 },
+    { 1011016435, -26069392, 57250667 },
+    { -932422334, -18818149, 61738430 },
+    { -2147483648, -19734702, 66087374 },
+    { -2147483648, -773989, 70301793 },
+    { -1988259119, 42338017, 74385850 },
+    { -1879458489, 45813395, 78343577 },
+    { -1011016436, 10696885, 82178880 },
+    { 932422333, -944571, 85895548 },
+};
+
+
+static void golden_input(size_t i, int16_t frame[3], uint32_t *prng)
+{
+    *prng = *prng * 1103515245u + 12345u;
+    frame[0] = (i / 6) % 2 ? 32767 : -32768;
+    frame[1] = (int16_t)((*prng >> 16) % 2001) - 1000;
+    frame[2] = (int16_t)(i * 97 - 1500);
+}
+
+static void golden_bank(adxl345_filter_t *filter)
+{
+    adxl345_biquad_coef_t sections[2];
+
+    TEST_CHECK_EQ(adxl345_filter_coef(ADXL345_FILTER_HIGHPASS_1, ADXL345_FILTER_CUTOFF_ODR_DIV_200, &sections[0]), ESP_OK);
+    TEST_CHECK_EQ(adxl345_filter_coef(ADXL345_FILTER_LOWPASS_2, ADXL345_FILTER_CUTOFF_ODR_DIV_5, &sections[1]), ESP_OK);
+    TEST_CHECK_EQ(adxl345_filter_init(filter, 3, sections, 2), ESP_OK);
+}
+
+static void test_golden_q16(void)
+{
+    adxl345_filter_t filter;
+    uint32_t prng = 1;
+
+    golden_bank(&filter);
+    for (size_t i = 0; i < TEST_FRAMES; i++) {
+        int16_t frame[3];
+        int32_t out[3];
+
+        golden_input(i, frame, &prng);
+        adxl345_filter_process(&filter, frame, out);
+        for (int ch = 0; ch < 3; ch++) {
+            TEST_CHECK_EQ(out[ch], golden_q16[i][ch]);
+        }
+    }
+}
+
+/* the block call rounds the same outputs to counts */
+static void test_golden_xyz(void)
+{
+    adxl345_filter_t filter;
+    adxl345_raw_xyz_t block[TEST_FRAMES];
+    uint32_t prng = 1;
+
+    golden_bank(&filter);
+    for (size_t i = 0; i < TEST_FRAMES; i++) {
+        int16_t frame[3];
+
+        golden_input(i, frame, &prng);
+        block[i] = (adxl345_raw_xyz_t) { .x = frame[0], .y = frame[1], .z = frame[2] };
+    }
+
+    adxl345_filter_process_xyz(&filter, block, TEST_FRAMES, block);
+    for (size_t i = 0; i < TEST_FRAMES; i++) {
+        int16_t expected[3];
+
+        for (int ch = 0; ch < 3; ch++) {
+            int32_t v = (int32_t)(((int64_t)golden_q16[i][ch] + 32768) >> 16);
+
+            expected[ch] = v > INT16_MAX ? INT16_MAX : (int16_t)v;
+        }
+        TEST_CHECK_EQ(block[i].x, expected[0]);
+        TEST_CHECK_EQ(block[i].y, expected[1]);
+        TEST_CHECK_EQ(block[i].z, expected[2]);
+    }
+}
+
+/* a saturated state keeps its sign, the output never flips past full scale */
+static void test_saturation(void)
+{
+    adxl345_filter_t filter;
+    adxl345_biquad_coef_t hp;
+    int32_t out;
+    int16_t in = INT16_MIN;
+
+    TEST_CHECK_EQ(adxl345_filter_coef(ADXL345_FILTER_HIGHPASS_1, ADXL345_FILTER_CUTOFF_ODR_DIV_200, &hp), ESP_OK);
+    TEST_CHECK_EQ(adxl345_filter_init(&filter, 1, &hp, 1), ESP_OK);
+    adxl345_filter_reset(&filter, &in);
+
+    in = INT16_MAX;
+    adxl345_filter_process(&filter, &in, &out);
+    TEST_CHECK_EQ(out, INT32_MAX);
+    adxl345_filter_process(&filter, &in, &out);
+    TEST_CHECK(out > 0);
+
+    in = INT16_MIN;
+    adxl345_filter_process(&filter, &in, &out);
+    TEST_CHECK_EQ(out, INT32_MIN);
+}
+
+int main(void)
+{
+    TEST_RUN(test_golden_q16);
+    TEST_RUN(test_golden_xyz);
+    TEST_RUN(test_saturation);
+
+    return test_result();
+}
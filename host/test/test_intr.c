@@ -0,0 +1,272 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_intr.h"
+#include "adxl345_sim.h"
+#include "host_test.h"
+
+/**
+ * Interrupt acquisition on the simulator. The simulator calls the ISR through
+ * adxl345_sim_intr_shim while an INT line is active; host tasks never run, so the
+ * tests call adxl345_intr_service() where the acquisition task would.
+ * A wrapper around the simulator shim records what the driver does with the lines.
+ */
+
+
+#define TEST_INT1_GPIO  4
+#define TEST_INT2_GPIO  5
+
+typedef struct {
+    uint32_t attached;
+    uint32_t detached;
+    uint32_t isr_calls;             // disable() only comes from the ISR
+    bool masked[2];
+    int64_t isr_time_us;
+} shim_log_t;
+
+typedef struct {
+    uint32_t calls;
+    uint8_t int_source;
+    int64_t timestamp_us;
+    bool stop;                      // stop the acquisition from the callback
+    esp_err_t stop_err;
+} callback_log_t;
+
+static shim_log_t shim_log;
+
+
+static int line_index(int gpio_num)
+{
+    return gpio_num == TEST_INT2_GPIO ? 1 : 0;
+}
+
+static esp_err_t log_attach(int gpio_num, adxl345_intr_handler_t handler, void *arg)
+{
+    shim_log.attached++;
+    return adxl345_sim_intr_shim.attach(gpio_num, handler, arg);
+}
+
+static esp_err_t log_detach(int gpio_num)
+{
+    shim_log.detached++;
+    return adxl345_sim_intr_shim.detach(gpio_num);
+}
+
+static void log_enable(int gpio_num)
+{
+    shim_log.masked[line_index(gpio_num)] = false;
+    adxl345_sim_intr_shim.enable(gpio_num);
+}
+
+static void log_disable(int gpio_num)
+{
+    shim_log.isr_calls++;
+    shim_log.masked[line_index(gpio_num)] = true;
+    shim_log.isr_time_us = adxl345_sim_time_us();
+    adxl345_sim_intr_shim.disable(gpio_num);
+}
+
+static const adxl345_intr_shim_t log_shim = {
+    .attach = log_attach,
+    .detach = log_detach,
+    .enable = log_enable,
+    .disable = log_disable,
+};
+
+/* reads the sample, which clears DATA_READY like a real handler has to */
+static void log_callback(adxl345_dev_t *dev, uint8_t int_source, int64_t timestamp_us, void *arg)
+{
+    callback_log_t *log = (callback_log_t *)arg;
+    adxl345_xyz_t accel;
+
+    log->calls++;
+    log->int_source = int_source;
+    log->timestamp_us = timestamp_us;
+    adxl345_get_accel(dev, &accel);
+    if (log->stop) {
+        log->stop_err = adxl345_intr_stop(dev);
+    }
+}
+
+static void intr_setup(adxl345_sim_t **sim, adxl345_dev_t **dev)
+{
+    adxl345_sim_config_t sim_config = ADXL345_SIM_CONFIG_DEFAULT();
+
+    shim_log = (shim_log_t) { 0 };
+    sim_config.int1_gpio = TEST_INT1_GPIO;
+    sim_config.int2_gpio = TEST_INT2_GPIO;
+    test_setup(&sim_config, NULL, sim, dev);
+    TEST_CHECK_EQ(adxl345_begin(*dev), ESP_OK);
+}
+
+static adxl345_intr_config_t intr_config(uint8_t int_enable, uint8_t int2_map, callback_log_t *log)
+{
+    adxl345_intr_config_t config = ADXL345_INTR_CONFIG_DEFAULT();
+
+    config.int1_gpio = TEST_INT1_GPIO;
+    config.int2_gpio = TEST_INT2_GPIO;
+    config.int_enable = int_enable;
+    config.int2_map = int2_map;
+    config.callback = log_callback;
+    config.arg = log;
+    config.shim = &log_shim;
+    return config;
+}
+
+/* INT_ENABLE and INT_MAP as configured, both lines attached, stop clears it all */
+static void test_routing(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    callback_log_t log = { 0 };
+    adxl345_intr_config_t config = intr_config(ADXL345_INT_DATA_READY | ADXL345_INT_WATERMARK | ADXL345_INT_OVERRUN,
+                                               ADXL345_INT_WATERMARK | ADXL345_INT_OVERRUN, &log);
+
+    intr_setup(&sim, &dev);
+    TEST_CHECK_EQ(adxl345_intr_start(dev, &config), ESP_OK);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_INT_ENABLE), config.int_enable);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_INT_MAP), config.int2_map);
+    TEST_CHECK_EQ(shim_log.attached, 2);
+    TEST_CHECK_EQ(adxl345_intr_start(dev, &config), ESP_ERR_INVALID_STATE);
+
+    TEST_CHECK_EQ(adxl345_intr_stop(dev), ESP_OK);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_INT_ENABLE), 0);
+    TEST_CHECK_EQ(shim_log.detached, 2);
+    TEST_CHECK_EQ(adxl345_intr_stop(dev), ESP_ERR_INVALID_STATE);
+
+    test_teardown(sim, dev);
+}
+
+/* the ISR masks its line until the service call, DATA_READY goes to INT1 only */
+static void test_mask_until_service(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    callback_log_t log = { 0 };
+    adxl345_intr_config_t config = intr_config(ADXL345_INT_DATA_READY, 0, &log);
+
+    intr_setup(&sim, &dev);
+    TEST_CHECK_EQ(adxl345_intr_start(dev, &config), ESP_OK);
+    adxl345_sim_advance_us(15000);                      // first conversion at 100 Hz
+
+    TEST_CHECK_EQ(shim_log.isr_calls, 1);
+    TEST_CHECK(shim_log.masked[0]);
+    TEST_CHECK(!shim_log.masked[1]);
+    TEST_CHECK(adxl345_sim_int_active(sim, ADXL345_INT1));
+    TEST_CHECK(!adxl345_sim_int_active(sim, ADXL345_INT2));
+
+    // a masked level interrupt stays quiet however long the task takes
+    adxl345_sim_advance_us(50000);
+    TEST_CHECK_EQ(shim_log.isr_calls, 1);
+    TEST_CHECK_EQ(log.calls, 0);
+
+    TEST_CHECK_EQ(adxl345_intr_service(dev), ESP_OK);
+    TEST_CHECK_EQ(log.calls, 1);
+    TEST_CHECK(!shim_log.masked[0]);
+    TEST_CHECK(!adxl345_sim_int_active(sim, ADXL345_INT1));
+
+    // the next conversion fires again
+    adxl345_sim_advance_us(10000);
+    TEST_CHECK_EQ(shim_log.isr_calls, 2);
+    TEST_CHECK(shim_log.masked[0]);
+
+    TEST_CHECK_EQ(adxl345_intr_stop(dev), ESP_OK);
+    test_teardown(sim, dev);
+}
+
+/* the callback gets INT_SOURCE as read and the time the ISR ran */
+static void test_int_source(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    callback_log_t log = { 0 };
+    adxl345_intr_config_t config = intr_config(ADXL345_INT_DATA_READY | ADXL345_INT_SINGLE_TAP,
+                                               ADXL345_INT_SINGLE_TAP, &log);
+
+    intr_setup(&sim, &dev);
+    TEST_CHECK_EQ(adxl345_intr_start(dev, &config), ESP_OK);
+    adxl345_sim_advance_us(15000);
+    TEST_CHECK_EQ(adxl345_intr_service(dev), ESP_OK);
+    TEST_CHECK_EQ(log.int_source, ADXL345_INT_DATA_READY);
+    TEST_CHECK_EQ(log.timestamp_us, shim_log.isr_time_us);
+
+    // a tap on INT2 while no new sample is ready
+    adxl345_sim_raise_event(sim, ADXL345_INT_SINGLE_TAP, 0x01);
+    TEST_CHECK(shim_log.masked[1]);
+    TEST_CHECK(!shim_log.masked[0]);
+    TEST_CHECK_EQ(adxl345_intr_service(dev), ESP_OK);
+    TEST_CHECK_EQ(log.calls, 2);
+    TEST_CHECK_EQ(log.int_source, ADXL345_INT_SINGLE_TAP);
+    TEST_CHECK_EQ(log.timestamp_us, shim_log.isr_time_us);
+    TEST_CHECK(!shim_log.masked[1]);
+
+    TEST_CHECK_EQ(adxl345_intr_stop(dev), ESP_OK);
+    test_teardown(sim, dev);
+}
+
+/* adxl345_intr_stop() from the callback: lines detached, no ISR and no service afterwards */
+static void test_stop_from_callback(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    callback_log_t log = { .stop = true };
+    adxl345_intr_config_t config = intr_config(ADXL345_INT_DATA_READY, 0, &log);
+
+    intr_setup(&sim, &dev);
+    TEST_CHECK_EQ(adxl345_intr_start(dev, &config), ESP_OK);
+    adxl345_sim_advance_us(15000);
+    TEST_CHECK_EQ(adxl345_intr_service(dev), ESP_OK);
+
+    TEST_CHECK_EQ(log.calls, 1);
+    TEST_CHECK_EQ(log.stop_err, ESP_OK);
+    TEST_CHECK_EQ(shim_log.detached, 2);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_INT_ENABLE), 0);
+
+    adxl345_sim_advance_us(50000);
+    TEST_CHECK_EQ(shim_log.isr_calls, 1);
+    TEST_CHECK_EQ(adxl345_intr_service(dev), ESP_ERR_INVALID_STATE);
+    TEST_CHECK_EQ(log.calls, 1);
+
+    // and it starts again
+    log.stop = false;
+    TEST_CHECK_EQ(adxl345_intr_start(dev, &config), ESP_OK);
+    adxl345_sim_advance_us(10000);
+    TEST_CHECK_EQ(shim_log.isr_calls, 2);
+    TEST_CHECK_EQ(adxl345_intr_service(dev), ESP_OK);
+    TEST_CHECK_EQ(log.calls, 2);
+
+    TEST_CHECK_EQ(adxl345_intr_stop(dev), ESP_OK);
+    test_teardown(sim, dev);
+}
+
+/* adxl345_destroy() with the acquisition running detaches the ISRs first */
+static void test_destroy_running(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    callback_log_t log = { 0 };
+    adxl345_intr_config_t config = intr_config(ADXL345_INT_DATA_READY, 0, &log);
+
+    intr_setup(&sim, &dev);
+    TEST_CHECK_EQ(adxl345_intr_start(dev, &config), ESP_OK);
+    adxl345_destroy(dev);
+    TEST_CHECK_EQ(shim_log.detached, 2);
+
+    adxl345_sim_advance_us(50000);
+    TEST_CHECK_EQ(shim_log.isr_calls, 0);
+    adxl345_sim_destroy(sim);
+}
+
+int main(void)
+{
+    TEST_RUN(test_routing);
+    TEST_RUN(test_mask_until_service);
+    TEST_RUN(test_int_source);
+    TEST_RUN(test_stop_from_callback);
+    TEST_RUN(test_destroy_running);
+
+    return test_result();
+}
@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_sched.h"
+#include "adxl345_sim.h"
+#include "host_test.h"
+
+/**
+ * ENERGY policy of the scheduler, fed with made up batches: the RMS around the
+ * running mean, ACTIVE above enter_rms_mg, back to IDLE after hold_ms below
+ * exit_rms_mg, and gravity on any axis never counts.
+ */
+
+
+#define TEST_BATCH      32
+
+/* full res, 3.9 mg/LSB: +-amp counts around gravity on z, alternating every sample */
+static void feed_square(adxl345_sched_t *sched, int16_t amp, size_t batches)
+{
+    adxl345_raw_xyz_t batch[TEST_BATCH];
+
+    for (size_t b = 0; b < batches; b++) {
+        for (size_t i = 0; i < TEST_BATCH; i++) {
+            batch[i] = (adxl345_raw_xyz_t) { .x = 0, .y = 0, .z = (int16_t)(256 + (i % 2 ? amp : -amp)) };
+        }
+        TEST_CHECK_EQ(adxl345_sched_feed(sched, batch, TEST_BATCH), ESP_OK);
+        adxl345_sim_advance_us(100000);
+    }
+}
+
+static void sched_setup(adxl345_sim_t **sim, adxl345_dev_t **dev, adxl345_sched_t **sched)
+{
+    adxl345_sched_config_t config = ADXL345_SCHED_CONFIG_DEFAULT();
+
+    test_setup(NULL, NULL, sim, dev);
+    TEST_CHECK_EQ(adxl345_begin(*dev), ESP_OK);
+    config.policy = ADXL345_SCHED_POLICY_ENERGY;
+    config.hold_ms = 500;
+    TEST_CHECK_EQ(adxl345_sched_create(*dev, &config, sched), ESP_OK);
+    TEST_CHECK_EQ(adxl345_sched_start(*sched), ESP_OK);
+}
+
+/* 64 counts = 250 mg of square wave is an RMS of 250 mg */
+static void test_rms(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_sched_t *sched;
+    adxl345_sched_stats_t stats;
+
+    sched_setup(&sim, &dev, &sched);
+    feed_square(sched, 0, 4);
+    adxl345_sched_get_stats(sched, &stats);
+    TEST_CHECK_EQ(stats.rms_mg, 0);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_IDLE);
+
+    feed_square(sched, 64, 4);
+    adxl345_sched_get_stats(sched, &stats);
+    TEST_CHECK(stats.rms_mg >= 240 && stats.rms_mg <= 260);
+
+    adxl345_sched_destroy(sched);
+    test_teardown(sim, dev);
+}
+
+/* 20 and 50 mg are about 5 and 13 counts: 4 counts stays IDLE, 16 goes ACTIVE */
+static void test_hysteresis(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_sched_t *sched;
+    adxl345_sched_stats_t stats;
+
+    sched_setup(&sim, &dev, &sched);
+    feed_square(sched, 4, 4);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_IDLE);
+
+    feed_square(sched, 16, 1);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_ACTIVE);
+    TEST_CHECK_EQ(adxl345_sim_peek_reg(sim, ADXL345_REG_BW_RATE), ADXL345_DATARATE_800_HZ);
+
+    // between exit and enter: stays ACTIVE past the hold time
+    feed_square(sched, 8, 10);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_ACTIVE);
+
+    // quiet: IDLE once hold_ms passed, not before
+    feed_square(sched, 0, 3);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_ACTIVE);
+    feed_square(sched, 0, 5);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_IDLE);
+
+    adxl345_sched_get_stats(sched, &stats);
+    TEST_CHECK_EQ(stats.switches, 2);
+
+    adxl345_sched_destroy(sched);
+    test_teardown(sim, dev);
+}
+
+/* the thresholds follow a data format change: 4 counts at 16 g 10 bit is 125 mg */
+static void test_range_change(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_sched_t *sched;
+
+    sched_setup(&sim, &dev, &sched);
+    feed_square(sched, 4, 4);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_IDLE);
+
+    TEST_CHECK_EQ(adxl345_set_range(dev, 16), ESP_OK);
+    TEST_CHECK_EQ(adxl345_set_fullres_mode(dev, false), ESP_OK);
+    feed_square(sched, 4, 1);
+    TEST_CHECK_EQ(adxl345_sched_get_mode(sched), ADXL345_SCHED_ACTIVE);
+
+    adxl345_sched_destroy(sched);
+    test_teardown(sim, dev);
+}
+
+int main(void)
+{
+    TEST_RUN(test_rms);
+    TEST_RUN(test_hysteresis);
+    TEST_RUN(test_range_change);
+
+    return test_result();
+}
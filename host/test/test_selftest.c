@@ -0,0 +1,113 @@
+#include <stdio.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_selftest.h"
+#include "adxl345_sim.h"
+#include "host_test.h"
+
+/**
+ * Self-test limits from the datasheet supply table and the verdict on the simulator.
+ */
+
+
+/* Table 14 points, interpolated between them and clamped outside 2.0..3.6 V */
+static void test_limits(void)
+{
+    adxl345_xyz_i32_t min;
+    adxl345_xyz_i32_t max;
+
+    adxl345_selftest_limits(2500, &min, &max);
+    TEST_CHECK_EQ(min.x, ADXL345_SELFTEST_X_MIN);
+    TEST_CHECK_EQ(max.z, ADXL345_SELFTEST_Z_MAX);
+
+    adxl345_selftest_limits(3300, &min, &max);          // 1.77 / 1.47
+    TEST_CHECK_EQ(min.x, 89);
+    TEST_CHECK_EQ(max.x, 956);
+    TEST_CHECK_EQ(min.y, -956);
+    TEST_CHECK_EQ(max.y, -89);
+    TEST_CHECK_EQ(min.z, 110);
+    TEST_CHECK_EQ(max.z, 1286);
+
+    adxl345_selftest_limits(3600, &min, &max);          // 2.11 / 1.69
+    TEST_CHECK_EQ(max.x, 1139);
+    TEST_CHECK_EQ(max.z, 1479);
+
+    adxl345_selftest_limits(2000, &min, &max);          // 0.64 / 0.80
+    TEST_CHECK_EQ(min.x, 32);
+    TEST_CHECK_EQ(min.z, 60);
+
+    adxl345_selftest_limits(2900, &min, &max);          // half way 2.5..3.3 V: 1.39 / 1.24
+    TEST_CHECK_EQ(min.x, 70);
+    TEST_CHECK_EQ(max.z, 1085);
+
+    adxl345_xyz_i32_t clamp_min;
+    adxl345_xyz_i32_t clamp_max;
+
+    adxl345_selftest_limits(1800, &min, &max);
+    adxl345_selftest_limits(2000, &clamp_min, &clamp_max);
+    TEST_CHECK_EQ(min.x, clamp_min.x);
+    TEST_CHECK_EQ(max.z, clamp_max.z);
+    adxl345_selftest_limits(5000, &min, &max);
+    adxl345_selftest_limits(3600, &clamp_min, &clamp_max);
+    TEST_CHECK_EQ(max.x, clamp_max.x);
+    TEST_CHECK_EQ(min.z, clamp_min.z);
+}
+
+static void test_pass(void)
+{
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_selftest_result_t result;
+    adxl345_config_t before;
+    adxl345_config_t after;
+
+    test_setup(NULL, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+    adxl345_get_config(dev, &before);
+
+    TEST_CHECK_EQ(adxl345_selftest_run(dev, NULL, &result), ESP_OK);
+    TEST_CHECK(result.pass);
+    TEST_CHECK(result.delta.x >= 250 && result.delta.x <= 260);      // 1000 mg at 3.9 mg/LSB
+    TEST_CHECK(result.delta.y <= -250 && result.delta.y >= -260);
+
+    // configuration restored, on the sensor too
+    adxl345_get_config(dev, &after);
+    TEST_CHECK_EQ(after.data_format, before.data_format);
+    TEST_CHECK_EQ(after.bw_rate, before.bw_rate);
+    TEST_CHECK_EQ(adxl345_verify_regs(dev), ESP_OK);
+
+    test_teardown(sim, dev);
+}
+
+/* a proof mass that doesn't move fails, and the result says which axes */
+static void test_fail(void)
+{
+    adxl345_sim_config_t sim_config = ADXL345_SIM_CONFIG_DEFAULT();
+    adxl345_sim_t *sim;
+    adxl345_dev_t *dev;
+    adxl345_selftest_result_t result;
+
+    sim_config.selftest_mg[0] = 0;
+    sim_config.selftest_mg[2] = 6000;                   // past the 3.3 V Z limit
+    test_setup(&sim_config, NULL, &sim, &dev);
+    TEST_CHECK_EQ(adxl345_begin(dev), ESP_OK);
+
+    TEST_CHECK_EQ(adxl345_selftest_run(dev, NULL, &result), ESP_FAIL);
+    TEST_CHECK(!result.pass);
+    TEST_CHECK(result.delta.x < result.min.x);
+    TEST_CHECK(result.delta.y >= result.min.y && result.delta.y <= result.max.y);
+    TEST_CHECK(result.delta.z > result.max.z);
+
+    test_teardown(sim, dev);
+}
+
+int main(void)
+{
+    TEST_RUN(test_limits);
+    TEST_RUN(test_pass);
+    TEST_RUN(test_fail);
+
+    return test_result();
+}
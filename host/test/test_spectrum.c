@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <math.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_spectrum.h"
+#include "host_test.h"
+
+/**
+ * Known tones through the spectrum engine, FFT and Goertzel, float and Q15.
+ * Magnitudes are peak amplitudes in counts, so a tone of amplitude A has to come
+ * out as A in its bin whatever the window and the block floating point scaling do.
+ *   x: 1000 counts at 400 Hz on top of 256 counts of gravity
+ *   y: nothing
+ *   z: 50 counts at 125 Hz, small next to x, the Q15 scaling must keep it
+ * 400 Hz and 125 Hz are bins 32 and 10 at 3200 Hz / 256.
+ */
+
+
+#define TEST_RATE_HZ    3200.0f
+#define TEST_FRAME      256
+#define TEST_X_HZ       400.0f
+#define TEST_X_AMP      1000.0f
+#define TEST_Z_HZ       125.0f
+#define TEST_Z_AMP      50.0f
+#define TEST_X_BIN      32
+#define TEST_Z_BIN      10
+
+typedef struct {
+    bool q15;
+    uint32_t frames[3];
+    float mag[3][TEST_FRAME / 2 + 1];   // last frame per axis
+    uint16_t bins;
+    float bin_hz;
+} spectrum_log_t;
+
+static void log_spectrum(const adxl345_spectrum_t *spectrum, void *arg)
+{
+    spectrum_log_t *log = (spectrum_log_t *)arg;
+
+    log->frames[spectrum->axis]++;
+    log->bins = spectrum->bins;
+    log->bin_hz = spectrum->bin_hz;
+    for (uint16_t i = 0; i < spectrum->bins; i++) {
+        log->mag[spectrum->axis][i] = log->q15 ? spectrum->mag_q16[i] / 65536.0f : spectrum->mag[i];
+    }
+}
+
+static void feed_tones(adxl345_spectrum_engine_t *engine, size_t count)
+{
+    adxl345_raw_xyz_t s;
+
+    for (size_t i = 0; i < count; i++) {
+        float t = i / TEST_RATE_HZ;
+
+        s.x = (int16_t)lroundf(256.0f + TEST_X_AMP * sinf(2.0f * (float)M_PI * TEST_X_HZ * t));
+        s.y = 0;
+        s.z = (int16_t)lroundf(TEST_Z_AMP * sinf(2.0f * (float)M_PI * TEST_Z_HZ * t));
+        TEST_CHECK_EQ(adxl345_spectrum_feed(engine, &s, 1), ESP_OK);
+    }
+}
+
+static bool near(float value, float expected, float tolerance)
+{
+    return fabsf(value - expected) <= tolerance;
+}
+
+/* the tone in its bin, nothing above the noise a few bins away from it */
+static void check_fft_axis(const float *mag, uint16_t bins, uint16_t tone_bin, float amp, float floor)
+{
+    TEST_CHECK(near(mag[tone_bin], amp, amp * 0.01f));
+    for (uint16_t i = 0; i < bins; i++) {
+        if (i + 2 < tone_bin || i > tone_bin + 2) {
+            TEST_CHECK(mag[i] < floor);
+        }
+    }
+}
+
+static void run_fft(adxl345_spectrum_format_t format)
+{
+    adxl345_spectrum_config_t config = ADXL345_SPECTRUM_CONFIG_DEFAULT();
+    adxl345_spectrum_engine_t *engine;
+    spectrum_log_t log = { .q15 = format == ADXL345_SPECTRUM_Q15 };
+
+    config.format = format;
+    config.frame_size = TEST_FRAME;
+    config.hop = TEST_FRAME / 2;
+    config.sample_rate_hz = TEST_RATE_HZ;
+    config.callback = log_spectrum;
+    config.arg = &log;
+    TEST_CHECK_EQ(adxl345_spectrum_create(&config, &engine), ESP_OK);
+
+    feed_tones(engine, 2 * TEST_FRAME);
+    adxl345_spectrum_destroy(engine);
+
+    // frames end at 256, 384 and 512 samples
+    TEST_CHECK_EQ(log.frames[0], 3);
+    TEST_CHECK_EQ(log.frames[1], 3);
+    TEST_CHECK_EQ(log.frames[2], 3);
+    TEST_CHECK_EQ(log.bins, TEST_FRAME / 2 + 1);
+    TEST_CHECK(near(log.bin_hz, TEST_RATE_HZ / TEST_FRAME, 1e-3f));
+
+    check_fft_axis(log.mag[0], log.bins, TEST_X_BIN, TEST_X_AMP, 10.0f);
+    check_fft_axis(log.mag[2], log.bins, TEST_Z_BIN, TEST_Z_AMP, 2.0f);
+    for (uint16_t i = 0; i < log.bins; i++) {
+        TEST_CHECK(log.mag[1][i] < 1.0f);
+    }
+}
+
+static void run_goertzel(adxl345_spectrum_format_t format)
+{
+    static const float targets[] = { TEST_Z_HZ, TEST_X_HZ, 1000.0f };
+    adxl345_spectrum_config_t config = ADXL345_SPECTRUM_CONFIG_DEFAULT();
+    adxl345_spectrum_engine_t *engine;
+    spectrum_log_t log = { .q15 = format == ADXL345_SPECTRUM_Q15 };
+
+    config.mode = ADXL345_SPECTRUM_GOERTZEL;
+    config.format = format;
+    config.frame_size = TEST_FRAME;
+    config.hop = TEST_FRAME;
+    config.sample_rate_hz = TEST_RATE_HZ;
+    config.targets_hz = targets;
+    config.target_count = 3;
+    config.callback = log_spectrum;
+    config.arg = &log;
+    TEST_CHECK_EQ(adxl345_spectrum_create(&config, &engine), ESP_OK);
+
+    feed_tones(engine, 2 * TEST_FRAME);
+    adxl345_spectrum_destroy(engine);
+
+    TEST_CHECK_EQ(log.frames[0], 2);
+    TEST_CHECK_EQ(log.bins, 3);
+    TEST_CHECK(near(log.bin_hz, 0.0f, 0.0f));
+
+    TEST_CHECK(near(log.mag[0][1], TEST_X_AMP, TEST_X_AMP * 0.01f));
+    TEST_CHECK(log.mag[0][0] < 10.0f);
+    TEST_CHECK(log.mag[0][2] < 10.0f);
+    TEST_CHECK(near(log.mag[2][0], TEST_Z_AMP, TEST_Z_AMP * 0.01f));
+    TEST_CHECK(log.mag[2][1] < 2.0f);
+    TEST_CHECK(log.mag[1][1] < 1.0f);
+}
+
+static void test_fft_float(void)
+{
+    run_fft(ADXL345_SPECTRUM_FLOAT);
+}
+
+static void test_fft_q15(void)
+{
+    run_fft(ADXL345_SPECTRUM_Q15);
+}
+
+static void test_goertzel_float(void)
+{
+    run_goertzel(ADXL345_SPECTRUM_FLOAT);
+}
+
+static void test_goertzel_q15(void)
+{
+    run_goertzel(ADXL345_SPECTRUM_Q15);
+}
+
+int main(void)
+{
+    TEST_RUN(test_fft_float);
+    TEST_RUN(test_fft_q15);
+    TEST_RUN(test_goertzel_float);
+    TEST_RUN(test_goertzel_q15);
+
+    return test_result();
+}
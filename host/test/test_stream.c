@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "esp_err.h"
+
+#include "adxl345.h"
+#include "adxl345_stream.h"
+#include "host_test.h"
+
+/**
+ * Stream frames: encode / decode round trip, resync and corruption.
+ */
+
+
+#define TEST_SAMPLES    200
+
+static adxl345_raw_xyz_t in[TEST_SAMPLES];
+static adxl345_raw_xyz_t out[ADXL345_STREAM_MAX_SAMPLES];
+static uint8_t buf[2 * ADXL345_STREAM_FRAME_MAX(TEST_SAMPLES) + 8];
+
+
+static void fill_samples(void)
+{
+    uint32_t prng = 12345;
+
+    for (size_t i = 0; i < TEST_SAMPLES; i++) {
+        prng = prng * 1103515245u + 12345u;
+        in[i].x = (int16_t)(i * 7 - 300);
+        in[i].y = (int16_t)(prng >> 16);        // anything, full 16 bit deltas
+        in[i].z = 256 + (int16_t)(i % 3);
+    }
+    in[10] = (adxl345_raw_xyz_t) { .x = INT16_MIN, .y = INT16_MAX, .z = 0 };
+    in[11] = (adxl345_raw_xyz_t) { .x = INT16_MAX, .y = INT16_MIN, .z = -1 };
+}
+
+static void test_round_trip(void)
+{
+    const adxl345_stream_header_t header = {
+        .device_id = 3,
+        .rate = ADXL345_DATARATE_3200_HZ,
+        .data_format = 0x0B,
+        .seq = 65535,
+        .count = TEST_SAMPLES,
+        .base_us = 1234567890123LL,
+    };
+    adxl345_stream_header_t decoded;
+    size_t len;
+    size_t used;
+
+    fill_samples();
+    TEST_CHECK_EQ(adxl345_stream_encode_frame(&header, in, buf, sizeof(buf), &len), ESP_OK);
+    TEST_CHECK(len <= ADXL345_STREAM_FRAME_MAX(TEST_SAMPLES));
+
+    TEST_CHECK_EQ(adxl345_stream_decode(buf, len, &decoded, out, ADXL345_STREAM_MAX_SAMPLES, &used), ESP_OK);
+    TEST_CHECK_EQ(used, len);
+    TEST_CHECK_EQ(decoded.device_id, header.device_id);
+    TEST_CHECK_EQ(decoded.rate, header.rate);
+    TEST_CHECK_EQ(decoded.data_format, header.data_format);
+    TEST_CHECK_EQ(decoded.seq, header.seq);
+    TEST_CHECK_EQ(decoded.count, header.count);
+    TEST_CHECK_EQ(decoded.base_us, header.base_us);
+    TEST_CHECK(memcmp(in, out, sizeof(in)) == 0);
+    TEST_CHECK_EQ(adxl345_stream_sample_period_ns(&decoded), 312500);
+}
+
+/* garbage in front is skipped, a torn frame waits for more, a flipped bit is caught */
+static void test_resync_and_crc(void)
+{
+    const adxl345_stream_header_t header = {
+        .device_id = 1,
+        .rate = ADXL345_DATARATE_100_HZ,
+        .data_format = 0x08,
+        .count = 16,
+    };
+    adxl345_stream_header_t decoded;
+    size_t len;
+    size_t used;
+
+    fill_samples();
+    buf[0] = 0x00;
+    buf[1] = 0x13;
+    buf[2] = 0x37;
+    TEST_CHECK_EQ(adxl345_stream_encode_frame(&header, in, &buf[3], sizeof(buf) - 3, &len), ESP_OK);
+
+    TEST_CHECK_EQ(adxl345_stream_decode(buf, 3 + len, &decoded, out, ADXL345_STREAM_MAX_SAMPLES, &used), ESP_ERR_NOT_FOUND);
+    TEST_CHECK_EQ(used, 3);
+
+    TEST_CHECK_EQ(adxl345_stream_decode(&buf[3], len - 1, &decoded, out, ADXL345_STREAM_MAX_SAMPLES, &used), ESP_ERR_INVALID_SIZE);
+    TEST_CHECK_EQ(used, 0);
+
+    buf[3 + ADXL345_STREAM_HEADER_LEN + 2] ^= 0x04;
+    TEST_CHECK_EQ(adxl345_stream_decode(&buf[3], len, &decoded, out, ADXL345_STREAM_MAX_SAMPLES, &used), ESP_ERR_INVALID_CRC);
+    TEST_CHECK(used > 0);
+}
+
+int main(void)
+{
+    TEST_RUN(test_round_trip);
+    TEST_RUN(test_resync_and_crc);
+
+    return test_result();
+}
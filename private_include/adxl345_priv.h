@@ -0,0 +1,94 @@
+/**
+ * Driver internals shared between the adxl345 source files, not part of the public API.
+ */
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include "i2c_manager.h"
+#include "sdkconfig.h"
+#include "adxl345.h"
+#include "adxl345_filter.h"
+#include "adxl345_bus.h"
+#include "adxl345_stats.h"
+
+struct adxl345_intr_ctx;
+struct adxl345_events_ctx;
+
+/* Shadow copy of the registers THRESH_TAP (0x1D) up to FIFO_CTL (0x38), indexed by register address */
+#define ADXL345_SHADOW_FIRST        ADXL345_REG_THRESH_TAP
+#define ADXL345_SHADOW_LAST         ADXL345_REG_FIFO_CTL
+#define ADXL345_SHADOW_SIZE         (ADXL345_SHADOW_LAST - ADXL345_SHADOW_FIRST + 1)
+#define ADXL345_IS_SHADOWED(reg)    ((reg) >= ADXL345_SHADOW_FIRST && (reg) <= ADXL345_SHADOW_LAST)
+#define ADXL345_SHADOW(dev, reg)    ((dev)->regs[(reg) - ADXL345_SHADOW_FIRST])
+
+/**
+ * @brief Device instance, see adxl345_create()
+ */
+struct adxl345_dev_t {
+    i2c_port_t i2c_port;                ///< I2C_NUM_0 or I2C_NUM_1
+    uint8_t i2c_address;                ///< 0x53 (ALT low) or 0x1D (ALT high)
+    adxl345_bus_t bus;                  ///< transport, every register access goes through it
+    bool bus_owned;                     ///< bus was created by adxl345_create(), delete it in adxl345_destroy()
+    SemaphoreHandle_t lock;             ///< recursive, see ADXL345_LOCK()
+    adxl345_recovery_config_t recovery; ///< retries, bus clear, config re-apply
+    bool checking;                      ///< adxl345_check_health() running, no nested checks
+    bool health_pending;                ///< a transaction needed retries, check when the lock is released
+    uint32_t lock_depth;                ///< ADXL345_LOCK() nesting of the owning task
+    struct adxl345_intr_ctx *intr;      ///< interrupt acquisition, NULL when not started
+    struct adxl345_events_ctx *events;  ///< event engine, NULL when not started
+    uint8_t regs[ADXL345_SHADOW_SIZE];  ///< last value written to / read from the sensor, see ADXL345_SHADOW()
+    adxl345_filter_t iir;               ///< adxl345_get_accel_iir() state, full precision per axis
+    float iir_alpha;                    ///< alpha iir was set up with, negative before the first call
+#ifdef CONFIG_ADXL345_STATS_ENABLED
+    adxl345_stats_t stats;              ///< see adxl345_stats.h
+#endif
+};
+
+/*
+ * Per-device lock. Held for every bus transaction and around sequences that have to
+ * stay together on one sensor (read-modify-write of the shadow copy, a FIFO drain,
+ * a whole config). Recursive, so a locked function can call the others. Sensors
+ * don't share it: tasks on different sensors never wait on each other here.
+ * Releasing the outermost hold runs a deferred adxl345_check_health().
+ */
+#define ADXL345_LOCK(dev)           adxl345_lock(dev)
+#define ADXL345_UNLOCK(dev)         adxl345_unlock(dev)
+void adxl345_lock(adxl345_dev_t *dev);
+void adxl345_unlock(adxl345_dev_t *dev);
+
+/* Statistics hooks, empty without CONFIG_ADXL345_STATS_ENABLED */
+#ifdef CONFIG_ADXL345_STATS_ENABLED
+#include "esp_timer.h"
+void adxl345_stats_bus(adxl345_dev_t *dev, bool write, uint8_t reg, size_t len, esp_err_t err, int64_t start_us);
+void adxl345_stats_latency(adxl345_dev_t *dev, adxl345_stats_op_t op, int64_t start_us);
+#define ADXL345_STATS_START(t)                          int64_t t = esp_timer_get_time()
+#define ADXL345_STATS_BUS(dev, write, reg, len, err, t) adxl345_stats_bus(dev, write, reg, len, err, t)
+#define ADXL345_STATS_LATENCY(dev, op, t)               adxl345_stats_latency(dev, op, t)
+#define ADXL345_STATS_ADD(dev, field, n)                ((dev)->stats.field += (n))
+#else
+#define ADXL345_STATS_START(t)
+#define ADXL345_STATS_BUS(dev, write, reg, len, err, t) do { } while (0)
+#define ADXL345_STATS_LATENCY(dev, op, t)               do { } while (0)
+#define ADXL345_STATS_ADD(dev, field, n)                do { } while (0)
+#endif
+
+/* register access with logging and shadow update, adxl345.c */
+esp_err_t adxl345_read_regs(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t *rx, size_t len);
+esp_err_t adxl345_write_regs(adxl345_dev_t *dev, uint8_t reg_addr, const uint8_t *tx, size_t len);
+esp_err_t adxl345_update_reg(adxl345_dev_t *dev, uint8_t reg_addr, uint8_t mask, uint8_t value);
+bool adxl345_reg_writable(uint8_t reg_addr);
+void adxl345_wait_us(uint32_t us);
+
+/* FIFO averaged batch for calibration and self-test, adxl345_calib.c */
+esp_err_t adxl345_fifo_average(adxl345_dev_t *dev, uint16_t samples, uint8_t discard, adxl345_xyz_i32_t *avg);
+
+#ifdef __cplusplus
+}
+#endif